@@ -1,85 +1,125 @@
 @include "header.partial.frag"
 
+// debug keyword: output only the BRDF (without lights, shadows and ambient)
+@keyword "OUTPUT_BRDF"
+
 // Material struct
 @has "material"
 
 // extra uniforms
 @has "extra_uniforms"
 
+#ifdef DEFERRED
+// the material of the pixel replaces the material uniforms, filled by loadDeferredMaterial
+// from the G-buffer surface and the material table
+Material g_material;
+#define u_material g_material
+@has "deferred_material"
+#endif
+
+// contribution of one light, visibility scales the light (shadow factor)
+vec3 directLighting(Light light, float visibility, vec3 normal, vec3 viewDir){
+    // light direction: from fragment to light position
+    vec3 lightDir = normalize(light.position.xyz - fs_in.fragPos);
+
+    // check if light is directional
+    if(light.type == 0){
+        lightDir = normalize(light.position.xyz); // the direction is the light "position"
+    }
+
+    // check if light is behind
+    if(dot(normalize(fs_in.normal), lightDir) < 0.0f) return vec3(0.0f);
+
+    // calculate geometryTerm using light direction and the normal
+    float geometryTerm = max(0.0f, dot(normal, lightDir));
+
+    // gamma correct the light color
+    vec3 lightCol = u_gammaCorrect ? toLinear(light.color) : light.color;
+
+    // get the BRDF result for this light
+    vec3 brdfResult = BRDF(geometryTerm, lightDir, normal, viewDir);
+
+#ifdef OUTPUT_BRDF
+    return brdfResult;
+#else
+    return
+        visibility *                                          // shadow factor
+        light.intensity * lightCol * geometryTerm *           // light amount at this fragment
+        brdfResult *                                          // BRDF
+        lightAttenuation(light, fs_in.fragPos) *              // attenuation
+        spotlightFactor(light, lightDir);                     // spotlightFactor
+#endif
+}
+
 /*
     The lighting equation: L_out(x) = Integral( L_in * geometryTerm * BRDF(out,in) )d_in + emission
 */
 
 void main()
 {
+#ifdef DEFERRED
+    // nothing was drawn in the background (keep the clear color)
+    if(!readGBuffer(fs_in)) discard;
+    // unlit materials output their emission
+    if(fs_in.materialId == UNLIT_MATERIAL){
+        FragColor = vec4(u_gammaCorrect ? toLinear(fs_in.albedo) : fs_in.albedo, 1.0f);
+        return;
+    }
+    loadDeferredMaterial();
+#endif
+
     vec3 normal = normalize(fs_in.normal);
     // view direction: from fragment to viewer position
     vec3 viewDir = normalize(u_viewPos - fs_in.fragPos);
 
     // is we use normal mapping get the normal from the texture
-    if(u_hasNormTexture){
-        normal = texture(u_NormalTex, fs_in.texCoords).rgb * 2.0f - 1.0f;
-        normal = normalize(fs_in.TBN * normal);
-    }
+#ifdef HAS_NORMAL_TEXTURE
+    normal = texture(u_NormalTex, fs_in.texCoords).rgb * 2.0f - 1.0f;
+    normal = normalize(fs_in.TBN * normal);
+#endif
 
     // the current contribution of all lights for this fragment
     vec3 result = vec3(0.0f);
 
-    // go through each light and calculate the contribution
-    for(int i=0;i<u_numLights;++i){
-        // if light is disabled => skip
-        if(u_lights[i].enabled == false){
-            continue;
-        }
-        // light direction: from fragment to light position
-        vec3 lightDir = normalize(u_lights[i].position.xyz - fs_in.fragPos);    
-        
-        // check if light is directional
-        if(u_lights[i].type == 0){
-            lightDir = normalize(u_lights[i].position.xyz); // the direction is the light "position"
-        }
-
-        // check if light is behind
-        if(dot(normalize(fs_in.normal), lightDir) < 0.0f) continue;
-        
-        // calculate geometryTerm using light direction and the normal
-        float geometryTerm = max(0.0f, dot(normal, lightDir));
-
-        // gamma correct the light color
-        vec3 lightCol = u_gammaCorrect ? toLinear(u_lights[i].color) : u_lights[i].color;
-
-        // get the BRDF result for this light
-        vec3 brdfResult = BRDF(geometryTerm, lightDir, normal, viewDir);
-        
-        result +=  
-            u_outputOnlyBRDF * brdfResult + (1 - u_outputOnlyBRDF) * // (branchless toggle for showing the brdf only)
-            getShadow(i) *                                           // check if fragment is in shadow
-            u_lights[i].intensity * lightCol * geometryTerm *        // light amount at this fragment
-            brdfResult *                                             // BRDF
-            lightAttenuation(u_lights[i], fs_in.fragPos) *           // attenuation
-            spotlightFactor(u_lights[i], lightDir);                  // spotlightFactor
+    // go through each light reaching the object and calculate the contribution
+    // (disabled and out of range lights are not in the list)
+    for(int k=0;k<u_numLights;++k){
+        int i = u_lightIndices[k];
+        result += directLighting(u_lights[i], getShadow(i), normal, viewDir);
     }
+
+#if defined(CLUSTERED_LIGHTS) && !defined(OUTPUT_BRDF)
+    // add the clustered lights that reach this fragment (no shadows, faded out at their range)
+    uvec2 cluster = getCluster(fs_in.fragPos);
+    for(uint i=0u;i<cluster.y;++i){
+        Light light = getClusterLight(cluster.x + i);
+        result += directLighting(light, clusterLightWindow(light, fs_in.fragPos), normal, viewDir);
+    }
+#endif
     
+#ifndef OUTPUT_BRDF
     // add ambient light at the end (if not outputting only bdrf)
-    result += (1 - u_outputOnlyBRDF) * indirectLighting();
-
-    // add emission
-    if(u_hasEmissiveTexture){
-        // use emission from texture
-        result += texture(u_EmissiveTex, fs_in.texCoords).rgb;
-    } else {
-        // gamma correct emission color
-        result += u_gammaCorrect ? toLinear(u_emission) : u_emission;
-    }
+    result += indirectLighting();
+#endif
+
+    // add emission (deferred: only unlit materials are emissive)
+#if defined(DEFERRED)
+#elif defined(HAS_EMISSIVE_TEXTURE)
+    // use emission from texture
+    result += texture(u_EmissiveTex, fs_in.texCoords).rgb;
+#else
+    // gamma correct emission color
+    result += u_gammaCorrect ? toLinear(u_emission) : u_emission;
+#endif
     
     // handle opacity texture
-    if(u_hasOpacityTexture){
-        // get opacity from red channel
-        float opacity = texture(u_OpacityTex, fs_in.texCoords).r;
-        FragColor = vec4(result, opacity);
-    } else {
-        FragColor = vec4(result, 1.0f);
-    }
+#ifdef HAS_OPACITY_TEXTURE
+    // get opacity from red channel
+    float opacity = texture(u_OpacityTex, fs_in.texCoords).r;
+    FragColor = vec4(result, opacity);
+#else
+    FragColor = vec4(result, 1.0f);
+#endif
 }
 
 @has "BRDF_implementation"
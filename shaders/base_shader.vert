@@ -1,5 +1,6 @@
 #version 330 
-const int MAX_LIGHTS = 5;
+@include "lights.partial.glsl"
+
 layout (location = 0) in vec3 in_Position;
 layout (location = 1) in vec2 in_TexCoords;
 layout (location = 2) in vec3 in_Normal;
@@ -18,24 +19,6 @@ out VERTEX_TO_FRAGMENT{
     vec4 fragPosLightSpace[MAX_LIGHTS]; // the fragment position in lightspace, for every light (for shadows)
 }vs_out;
 
-struct Light{
-   int type;        // 0 == directional | 1 == spotlight | 2 == pointlight
-   vec4 position;   // light position in world space    
-   float intensity; // 0 = no light
-   vec3 color;
-   bool enabled;        // flag if light is active
-   vec3 attenuation;    // distance attenuation: constant, linear, quadratic
-   vec3 target;         // spotlight target in world space
-   float cutOff;        // cos value of spotlight inner cut off angle
-   float outerCutOff;   // cos value of spotlight outer cut off angle, inner < outer
-   bool shadow;         // enable/disable using shadows
-   mat4 lightSpaceMatrix; // used to transform fragment from world space to light space
-   float farPlane;        // used for shadows
-   sampler2D shadowMap;   // shadow map texture for directional / spotlight
-   samplerCube shadowMapCube; // shadow map texture for point light
-};
-
-uniform Light u_lights[MAX_LIGHTS]; 
 // scale texture coords by these
 uniform float u_textureScaleX = 1.0f;
 uniform float u_textureScaleY = 1.0f;
@@ -0,0 +1,88 @@
+#version 330 core
+// bloom mip chain (see PostprocessPipeline::renderBloom), drawn with postprocess.vert to one level of the chain
+// default: 13 tap downsample of the larger level ("Next Generation Post Processing in Call of Duty: Advanced Warfare")
+// BLOOM_PREFILTER: first downsample, reads the HDR color and keeps only the part above the threshold
+// BLOOM_UPSAMPLE: 3x3 tent filter of the smaller level, added (blending) to the level below it
+@keyword "BLOOM_PREFILTER"
+@keyword "BLOOM_UPSAMPLE"
+
+out vec4 outColor;
+in vec2 texCoords;
+
+uniform sampler2D u_texture;     // HDR color or a level of the chain (bilinear filtering)
+uniform float u_threshold = 1.0f; // luminance where bloom starts (soft knee below it)
+uniform float u_radius = 1.0f;    // tent filter radius in texels of the smaller level
+
+vec3 sampleOffset(vec2 texelSize, float x, float y){
+    return texture(u_texture, texCoords + texelSize * vec2(x, y)).rgb;
+}
+
+#ifdef BLOOM_PREFILTER
+// soft threshold with a knee of half the threshold, the brightest channel decides
+vec3 prefilter(vec3 color){
+    float brightness = max(color.r, max(color.g, color.b));
+    float knee = 0.5f * u_threshold;
+    float soft = clamp(brightness - u_threshold + knee, 0.0f, 2.0f * knee);
+    soft = soft * soft / (4.0f * knee + 0.00001f);
+    return color * max(soft, brightness - u_threshold) / max(brightness, 0.00001f);
+}
+
+// weight of a group of samples, single bright pixels don't flicker (Karis average)
+float karisWeight(vec3 color){
+    return 1.0f / (1.0f + dot(color, vec3(0.2126f, 0.7152f, 0.0722f)));
+}
+#endif
+
+void main(){
+    vec2 texelSize = 1.0f / vec2(textureSize(u_texture, 0));
+#ifdef BLOOM_UPSAMPLE
+    // 3x3 tent
+    vec2 radius = texelSize * u_radius;
+    vec3 color = 4.0f * texture(u_texture, texCoords).rgb;
+    color += 2.0f * (sampleOffset(radius, 0.0f, 1.0f) + sampleOffset(radius, 1.0f, 0.0f) + sampleOffset(radius, 0.0f, -1.0f) + sampleOffset(radius, -1.0f, 0.0f));
+    color += sampleOffset(radius, 1.0f, 1.0f) + sampleOffset(radius, 1.0f, -1.0f) + sampleOffset(radius, -1.0f, 1.0f) + sampleOffset(radius, -1.0f, -1.0f);
+    outColor = vec4(color / 16.0f, 1.0f);
+#else
+    // 13 bilinear taps = 36 texels: 4 overlapping 2x2 boxes around the center, 1 box in the middle
+    vec3 a = sampleOffset(texelSize, -2.0f, 2.0f);
+    vec3 b = sampleOffset(texelSize, 0.0f, 2.0f);
+    vec3 c = sampleOffset(texelSize, 2.0f, 2.0f);
+    vec3 d = sampleOffset(texelSize, -2.0f, 0.0f);
+    vec3 e = sampleOffset(texelSize, 0.0f, 0.0f);
+    vec3 f = sampleOffset(texelSize, 2.0f, 0.0f);
+    vec3 g = sampleOffset(texelSize, -2.0f, -2.0f);
+    vec3 h = sampleOffset(texelSize, 0.0f, -2.0f);
+    vec3 i = sampleOffset(texelSize, 2.0f, -2.0f);
+    vec3 j = sampleOffset(texelSize, -1.0f, 1.0f);
+    vec3 k = sampleOffset(texelSize, 1.0f, 1.0f);
+    vec3 l = sampleOffset(texelSize, -1.0f, -1.0f);
+    vec3 m = sampleOffset(texelSize, 1.0f, -1.0f);
+
+    // the 5 boxes (weights 0.5 for the middle one, 0.125 for the others)
+    vec3 boxes[5] = vec3[](
+        (j + k + l + m) * 0.25f,
+        (a + b + d + e) * 0.25f,
+        (b + c + e + f) * 0.25f,
+        (d + e + g + h) * 0.25f,
+        (e + f + h + i) * 0.25f
+    );
+    float weights[5] = float[](0.5f, 0.125f, 0.125f, 0.125f, 0.125f);
+#ifdef BLOOM_PREFILTER
+    vec3 color = vec3(0.0f);
+    float weightSum = 0.0f;
+    for(int n = 0; n < 5; ++n){
+        vec3 box = prefilter(boxes[n]);
+        float weight = weights[n] * karisWeight(box);
+        color += box * weight;
+        weightSum += weight;
+    }
+    color /= weightSum;
+#else
+    vec3 color = vec3(0.0f);
+    for(int n = 0; n < 5; ++n){
+        color += boxes[n] * weights[n];
+    }
+#endif
+    outColor = vec4(color, 1.0f);
+#endif
+}
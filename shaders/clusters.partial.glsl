@@ -0,0 +1,52 @@
+// clustered point lights and spotlights without shadows (see src/Light/ClusteredLights.h)
+// the lights of every view space cluster are assigned on the CPU, a fragment only loops over the lights of its cluster
+@keyword "CLUSTERED_LIGHTS"
+#ifdef CLUSTERED_LIGHTS
+uniform samplerBuffer u_clusterLights;   // 4 texels per light: position + range, color + intensity, attenuation + cutOff, direction + outerCutOff
+uniform usamplerBuffer u_clusterItems;   // (offset, count) of every cluster followed by the light indices
+uniform vec4 u_clusterParams;            // tile width, tile height (pixels), depth slice scale, depth slice bias
+uniform vec3 u_clusterCount;             // number of clusters in x, y, z
+uniform mat4 u_viewMatrix = mat4(1.0f);
+
+// (offset of the first light index, number of lights) of the cluster containing the fragment
+uvec2 getCluster(vec3 fragPos){
+    float depth = -(u_viewMatrix * vec4(fragPos, 1.0f)).z;
+    // exponential depth slices: slice = log(depth) * scale + bias
+    int slice = int(floor(log(max(depth, 0.0001f)) * u_clusterParams.z + u_clusterParams.w));
+    ivec3 count = ivec3(u_clusterCount);
+    ivec3 cluster = clamp(ivec3(ivec2(gl_FragCoord.xy / u_clusterParams.xy), slice), ivec3(0), count - 1);
+    int index = cluster.x + count.x * (cluster.y + count.y * cluster.z);
+    return uvec2(texelFetch(u_clusterItems, 2 * index).r, texelFetch(u_clusterItems, 2 * index + 1).r);
+}
+
+// light with the index stored at position item of the index list (the range is stored in farPlane)
+Light getClusterLight(uint item){
+    int index = 4 * int(texelFetch(u_clusterItems, int(item)).r);
+    vec4 positionRange = texelFetch(u_clusterLights, index);
+    vec4 colorIntensity = texelFetch(u_clusterLights, index + 1);
+    vec4 attenuationCutOff = texelFetch(u_clusterLights, index + 2);
+    vec4 directionOuterCutOff = texelFetch(u_clusterLights, index + 3);
+
+    Light light;
+    light.lightSpaceMatrix = mat4(1.0f);
+    light.position = vec4(positionRange.xyz, 1.0f);
+    light.color = colorIntensity.rgb;
+    light.intensity = colorIntensity.a;
+    light.attenuation = attenuationCutOff.xyz;
+    light.cutOff = attenuationCutOff.w;
+    light.target = positionRange.xyz + directionOuterCutOff.xyz;
+    light.outerCutOff = directionOuterCutOff.w;
+    light.type = 1; // point lights have cut off angles that include every direction
+    light.enabled = true;
+    light.shadow = false;
+    light.farPlane = positionRange.w;
+    return light;
+}
+
+// fades the light to 0 at its range so there is no visible edge at the cluster borders
+float clusterLightWindow(Light light, vec3 fragPos){
+    float ratio = distance(light.position.xyz, fragPos) / light.farPlane;
+    float window = clamp(1.0f - ratio * ratio * ratio * ratio, 0.0f, 1.0f);
+    return window * window;
+}
+#endif
@@ -13,13 +13,31 @@ uniform Material u_material;
 @endsection
 
 @section "extra_uniforms"
-uniform int u_Gindex = 0; // which geometry function is used
-uniform int u_Dindex = 0; // which microfacet normal distribution is used
+// microfacet normal distribution (Beckmann if none is set)
+@keyword "DISTRIBUTION_GGX"
+@keyword "DISTRIBUTION_PHONG"
+// geometry function (Cook-Torrance if none is set)
+@keyword "GEOMETRY_BECKMANN_UNCORRELATED"
+@keyword "GEOMETRY_GGX_UNCORRELATED"
+@keyword "GEOMETRY_BECKMANN"
+@keyword "GEOMETRY_GGX"
+// debug keywords: output only the D, F or G function (used with OUTPUT_BRDF)
+@keyword "OUTPUT_D"
+@keyword "OUTPUT_F"
+@keyword "OUTPUT_G"
+@endsection
 
-uniform bool u_outputDFG = false; // flag if should output N G or F functions to debug/view
-uniform int u_outputD = 0; // output only D function
-uniform int u_outputF = 0; // output only G function
-uniform int u_outputG = 0; // output only F function
+@section "deferred_material"
+// Cook-Torrance material of the pixel
+void loadDeferredMaterial(){
+    vec4 ia_ka = materialParameter(fs_in, 0);
+    g_material.albedo = fs_in.albedo;
+    g_material.roughness = fs_in.roughness;
+    g_material.f0 = fs_in.f0;
+    g_material.metallic = fs_in.metallic;
+    g_material.ia = ia_ka.rgb;
+    g_material.ka = ia_ka.a;
+}
 @endsection
 
 @section "BRDF_implementation"
@@ -46,16 +64,18 @@ float D_GGX(float NH);
 // phong version
 float D_Phong(float NH);
 
+// roughness from the material or the roughness texture
+float getRoughness();
+
 vec3 BRDF(float geometryTerm, vec3 lightDir, vec3 normal, vec3 viewDir){
     // calculate diffuse/albedo term
 
     // get the diffuse color from texture and do gamma correction
-    vec3 diffuse;
-    if(u_hasDiffTexture){
-        diffuse = texture(u_DiffuseTex, fs_in.texCoords).rgb;
-    } else {
-        diffuse = u_gammaCorrect ? toLinear(u_material.albedo) : u_material.albedo;
-    }
+#ifdef HAS_DIFFUSE_TEXTURE
+    vec3 diffuse = texture(u_DiffuseTex, fs_in.texCoords).rgb;
+#else
+    vec3 diffuse = u_gammaCorrect ? toLinear(u_material.albedo) : u_material.albedo;
+#endif
 
     // get the halfway direction vector between light direction and view direction
     vec3 halfway = normalize(lightDir + viewDir);
@@ -79,40 +99,46 @@ vec3 BRDF(float geometryTerm, vec3 lightDir, vec3 normal, vec3 viewDir){
     vec3 fresnel = F_Schlick(F0, VH);
 
 
-    // D - Slope distribution function
-    float slope_distribution;
-    // distribution function is chosen from UI
-    switch(u_Dindex){ 
-        case 0: slope_distribution = D_Beckmann(NH); break;
-        case 1: slope_distribution = D_GGX(NH); break;
-        case 2: slope_distribution = D_Phong(NH);
-    }
+    // D - Slope distribution function (chosen from UI)
+#if defined(DISTRIBUTION_GGX)
+    float slope_distribution = D_GGX(NH);
+#elif defined(DISTRIBUTION_PHONG)
+    float slope_distribution = D_Phong(NH);
+#else
+    float slope_distribution = D_Beckmann(NH);
+#endif
 
-    // G - Geometrical attenuation function
-    float geometrical_attenuation;
-    // Geometrical function is chosen from UI
-    switch(u_Gindex){
-        case 0: geometrical_attenuation = G_Cook(VH, NH, NV, NL); break;
-        case 1: geometrical_attenuation = G2_U_Beckmann(NV, NL); break;
-        case 2: geometrical_attenuation = G2_U_GGX(NV, NL); break;
-        case 3: geometrical_attenuation = G2_Beckmann(NV, NL); break;
-        case 4: geometrical_attenuation = G2_GGX(NV, NL); break;
-    }
+    // G - Geometrical attenuation function (chosen from UI)
+#if defined(GEOMETRY_BECKMANN_UNCORRELATED)
+    float geometrical_attenuation = G2_U_Beckmann(NV, NL);
+#elif defined(GEOMETRY_GGX_UNCORRELATED)
+    float geometrical_attenuation = G2_U_GGX(NV, NL);
+#elif defined(GEOMETRY_BECKMANN)
+    float geometrical_attenuation = G2_Beckmann(NV, NL);
+#elif defined(GEOMETRY_GGX)
+    float geometrical_attenuation = G2_GGX(NV, NL);
+#else
+    float geometrical_attenuation = G_Cook(VH, NH, NV, NL);
+#endif
 
-    // if flag is set => ouput only F D or G function
-    if(u_outputDFG){
-        vec3 result = vec3(0.0f);
-        result += u_outputD * vec3(slope_distribution);
-        result += u_outputG * vec3(geometrical_attenuation);
-        result += u_outputF * fresnel;
-        return result;
-    }
+    // if set => ouput only F D or G function
+#if defined(OUTPUT_D)
+    return vec3(slope_distribution);
+#elif defined(OUTPUT_F)
+    return fresnel;
+#elif defined(OUTPUT_G)
+    return vec3(geometrical_attenuation);
+#endif
 
     // formula is FDG / (4 * NL * NV) from cook-torrance paper
     vec3 specular =  (fresnel * slope_distribution * geometrical_attenuation) / (4 * NL * NV);
 
     // get metallic ratio
-    float metallic = u_hasMetallicTexture ? texture(u_MetallicTex, fs_in.texCoords).r : u_material.metallic;
+#ifdef HAS_METALLIC_TEXTURE
+    float metallic = texture(u_MetallicTex, fs_in.texCoords).r;
+#else
+    float metallic = u_material.metallic;
+#endif
     // use at least 0.005 to have some fresnel reflections
     metallic = max(metallic, 0.005); 
     
@@ -120,6 +146,14 @@ vec3 BRDF(float geometryTerm, vec3 lightDir, vec3 normal, vec3 viewDir){
     return mix(diffuse, specular, metallic); 
 }
 
+float getRoughness(){
+#ifdef HAS_ROUGHNESS_TEXTURE
+    return texture(u_RoughTex, fs_in.texCoords).r;
+#else
+    return u_material.roughness;
+#endif
+}
+
 // uses Schlick approximation from "An Inexpensive BRDF Model for Physically-based Rendering"
 vec3 F_Schlick(vec3 f0, float VH){
     return f0 + (1 - f0) * pow(1 - VH, 5);
@@ -136,7 +170,7 @@ float G2_U_Beckmann(float NV, float NL){
     // uncorrelated G2 function = G1(V) * G1(L)
 
     // get roughness value (from texture if used)
-    float alpha = u_hasRoughTexture ? texture(u_RoughTex, fs_in.texCoords).r : u_material.roughness;
+    float alpha = getRoughness();
 
     // compute G1(V) and G1(L):
     
@@ -160,7 +194,7 @@ float G2_U_Beckmann(float NV, float NL){
 // G2 smith height correlated, Beckmann distribution using approximation
 float G2_Beckmann(float NV, float NL){
     // get roughness value (from texture if used)
-    float alpha = u_hasRoughTexture ? texture(u_RoughTex, fs_in.texCoords).r : u_material.roughness;
+    float alpha = getRoughness();
 
     // calculate 'a' and Lambda(a) values for L and V
     float a_V = NV / (alpha * sqrt(1-NV*NV));
@@ -177,7 +211,7 @@ float G2_U_GGX(float NV, float NL){
     // uncorrelated G2 function = G1(V) * G1(L)
     
     // get roughness value (from texture if used)
-    float alpha = u_hasRoughTexture ? texture(u_RoughTex, fs_in.texCoords).r : u_material.roughness;
+    float alpha = getRoughness();
     float sq_alpha = alpha * alpha; // square value to appear more linear
     // compute G1(V) and G1(L)
     float G1_V = 2 * NV / (NV + sqrt(NV*NV + sq_alpha * (1 - NV * NV)));
@@ -188,7 +222,7 @@ float G2_U_GGX(float NV, float NL){
 // G2 smith height correlated, GGX distribution
 float G2_GGX(float NV, float NL){
     // get roughness value (from texture if used)
-    float alpha = u_hasRoughTexture ? texture(u_RoughTex, fs_in.texCoords).r : u_material.roughness;
+    float alpha = getRoughness();
     float sq_alpha = alpha * alpha; // square value to appear more linear
     // use compact formula after substitutions and calculations
     return 2 * NL * NV / (NL * sqrt(sq_alpha + NV * (NV - alpha * NV)) + NV * sqrt(sq_alpha + NL * (NL - alpha * NL)));
@@ -198,7 +232,7 @@ float G2_GGX(float NV, float NL){
 // beckmann version, used in cook-torrance paper
 float D_Beckmann(float NH){
     // get roughness value (from texture if used)
-    float alpha = u_hasRoughTexture ? texture(u_RoughTex, fs_in.texCoords).r : u_material.roughness;
+    float alpha = getRoughness();
     float a = exp((NH * NH - 1) / (NH * NH * alpha * alpha));
     float b = pow(alpha, 2) * pow(NH, 4);
     return a / b; // dont divide by PI to ignore normalization
@@ -206,7 +240,7 @@ float D_Beckmann(float NH){
 // GGX distribution
 float D_GGX(float NH){
     // get roughness value (from texture if used)
-    float alpha = u_hasRoughTexture ? texture(u_RoughTex, fs_in.texCoords).r : u_material.roughness;
+    float alpha = getRoughness();
     alpha = alpha * alpha;
     return alpha * alpha / (pow((pow(NH, 4) * (alpha * alpha - 1) + 1), 2)); // dont divide by PI to ignore normalization
 }
@@ -214,7 +248,7 @@ float D_GGX(float NH){
 // phong distribution
 float D_Phong(float NH){
     // get roughness value (from texture if used)
-    float alpha = u_hasRoughTexture ? texture(u_RoughTex, fs_in.texCoords).r : u_material.roughness;
+    float alpha = getRoughness();
     // remap phong roughness to [0,1]
     alpha = 2 / (alpha * alpha) - 2;
     return (alpha + 2) / 2 * pow(NH, alpha); // dont divide by PI to ignore normalization
@@ -0,0 +1,24 @@
+#version 330 core
+@include "lights.partial.glsl"
+
+// drawn (with base_shader.vert) while the shader of an object is still compiling
+
+out vec4 FragColor;
+
+in VERTEX_TO_FRAGMENT{
+    vec3 fragPos;
+    vec3 normal;
+    vec2 texCoords;
+    mat3 TBN;
+    vec4 fragPosLightSpace[MAX_LIGHTS];
+}fs_in;
+
+uniform vec3 u_viewPos; // viewer position in world space
+
+void main()
+{
+    // plain grey, lit from the viewer so the shapes are visible
+    vec3 viewDir = normalize(u_viewPos - fs_in.fragPos);
+    float light = max(0.0f, dot(normalize(fs_in.normal), viewDir));
+    FragColor = vec4(vec3(0.02f + 0.2f * light), 1.0f);
+}
@@ -0,0 +1,84 @@
+#version 330 core
+@include "gbuffer.partial.glsl"
+
+// G-buffer of the deferred renderer, the same for all lighting models (see src/GBuffer.h)
+layout (location = 0) out vec4 gAlbedo;
+layout (location = 1) out vec4 gNormal;
+layout (location = 2) out vec4 gF0;
+
+in VERTEX_TO_FRAGMENT{
+    vec3 normal;
+    vec2 texCoords;
+    mat3 TBN;
+}fs_in;
+
+uniform bool u_gammaCorrect = false; // flag to enable/disable gamma correction
+
+// surface of the material (Material::getDeferredData)
+struct Surface{
+    vec3 albedo;
+    float roughness;
+    vec3 f0;
+    float metallic;
+};
+uniform Surface u_surface;
+uniform int u_materialId;  // row of the material table, UNLIT_MATERIAL = output the emission
+uniform vec3 u_emission;   // emission color of unlit materials
+
+// texture keywords, enabled by Mesh::draw for the textures of the mesh
+@keyword "HAS_DIFFUSE_TEXTURE"
+@keyword "HAS_SPECULAR_TEXTURE"
+@keyword "HAS_ROUGHNESS_TEXTURE"
+@keyword "HAS_NORMAL_TEXTURE"
+@keyword "HAS_METALLIC_TEXTURE"
+#ifdef HAS_DIFFUSE_TEXTURE
+uniform sampler2D u_DiffuseTex;
+#endif
+#ifdef HAS_SPECULAR_TEXTURE
+uniform sampler2D u_SpecularTex;
+#endif
+#ifdef HAS_NORMAL_TEXTURE
+uniform sampler2D u_NormalTex;
+#endif
+#ifdef HAS_ROUGHNESS_TEXTURE
+uniform sampler2D u_RoughTex;
+#endif
+#ifdef HAS_METALLIC_TEXTURE
+uniform sampler2D u_MetallicTex;
+#endif
+
+void main()
+{
+    vec3 normal = normalize(fs_in.normal);
+#ifdef HAS_NORMAL_TEXTURE
+    normal = texture(u_NormalTex, fs_in.texCoords).rgb * 2.0f - 1.0f;
+    normal = normalize(fs_in.TBN * normal);
+#endif
+
+    // the lighting shaders gamma correct the albedo like a material color,
+    // diffuse textures are srgb (already linear) => store them with the gamma applied
+    vec3 albedo = u_materialId == UNLIT_MATERIAL ? u_emission : u_surface.albedo;
+#ifdef HAS_DIFFUSE_TEXTURE
+    if(u_materialId != UNLIT_MATERIAL){
+        albedo = texture(u_DiffuseTex, fs_in.texCoords).rgb;
+        albedo = u_gammaCorrect ? pow(albedo, vec3(1.0f / 2.2f)) : albedo;
+    }
+#endif
+
+    float roughness = u_surface.roughness;
+#ifdef HAS_ROUGHNESS_TEXTURE
+    roughness = texture(u_RoughTex, fs_in.texCoords).r;
+#endif
+    float metallic = u_surface.metallic;
+#ifdef HAS_METALLIC_TEXTURE
+    metallic = texture(u_MetallicTex, fs_in.texCoords).r;
+#endif
+    vec3 f0 = u_surface.f0;
+#ifdef HAS_SPECULAR_TEXTURE
+    f0 = texture(u_SpecularTex, fs_in.texCoords).rgb;
+#endif
+
+    gAlbedo = vec4(albedo, float(u_materialId) / 255.0f);
+    gNormal = vec4(encodeNormal(normal), roughness, metallic);
+    gF0 = vec4(f0, 0.0f);
+}
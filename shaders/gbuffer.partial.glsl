@@ -0,0 +1,72 @@
+// G-buffer of the deferred renderer (see src/GBuffer.h), written by gbuffer.frag and read by the lighting shaders with DEFERRED
+//   0: RGBA8   albedo, material id / 255
+//   1: RGBA16F octahedral normal, roughness, metallic
+//   2: RGBA16F f0 (specular coefficient for Phong/Blinn-Phong)
+//   depth: hardware depth, the world position is reconstructed from it
+const int MAX_MATERIALS = 32;      // must be the same as GBuffer::MAX_MATERIALS
+const int MATERIAL_PARAMETERS = 2; // must be the same as Material::DEFERRED_PARAMETERS
+const int UNLIT_MATERIAL = 0;      // the albedo is the output color (light meshes)
+
+// octahedral mapping of a unit vector to [-1,1]^2
+vec2 encodeNormal(vec3 n){
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 signs = vec2(n.x >= 0.0f ? 1.0f : -1.0f, n.y >= 0.0f ? 1.0f : -1.0f);
+    return n.z >= 0.0f ? n.xy : (1.0f - abs(n.yx)) * signs;
+}
+
+vec3 decodeNormal(vec2 e){
+    vec3 n = vec3(e, 1.0f - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0f);
+    n.xy += vec2(n.x >= 0.0f ? -t : t, n.y >= 0.0f ? -t : t);
+    return normalize(n);
+}
+
+#ifdef DEFERRED
+in vec2 texCoords; // full screen quad (postprocess.vert)
+
+uniform sampler2D u_gAlbedo;
+uniform sampler2D u_gNormal;
+uniform sampler2D u_gF0;
+uniform sampler2D u_gDepth;
+uniform mat4 u_inverseViewProjMatrix;
+// parameters of the lighting model of every material id (Material::getDeferredData)
+uniform vec4 u_materialTable[MAX_MATERIALS * MATERIAL_PARAMETERS];
+
+// surface at a pixel, replaces the vertex shader output of the forward shaders
+struct GBufferSample{
+    vec3 fragPos;
+    vec3 normal;
+    vec2 texCoords;
+    vec3 albedo;
+    float roughness;
+    float metallic;
+    vec3 f0;
+    int materialId;
+};
+
+// parameter i of the material of a sample
+vec4 materialParameter(GBufferSample s, int i){
+    return u_materialTable[s.materialId * MATERIAL_PARAMETERS + i];
+}
+
+// false for the background (nothing was drawn at the pixel)
+bool readGBuffer(out GBufferSample s){
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    float depth = texelFetch(u_gDepth, pixel, 0).r;
+    s.texCoords = texCoords;
+    if(depth == 1.0f) return false;
+    // world position from the depth
+    vec4 position = u_inverseViewProjMatrix * vec4(vec3(texCoords, depth) * 2.0f - 1.0f, 1.0f);
+    s.fragPos = position.xyz / position.w;
+
+    vec4 albedo = texelFetch(u_gAlbedo, pixel, 0);
+    vec4 normal = texelFetch(u_gNormal, pixel, 0);
+    s.albedo = albedo.rgb;
+    s.materialId = int(albedo.a * 255.0f + 0.5f);
+    s.normal = decodeNormal(normal.xy);
+    s.roughness = normal.z;
+    s.metallic = normal.w;
+    s.f0 = texelFetch(u_gF0, pixel, 0).rgb;
+    return true;
+}
+#endif
@@ -0,0 +1,30 @@
+#version 330 
+layout (location = 0) in vec3 in_Position;
+layout (location = 1) in vec2 in_TexCoords;
+layout (location = 2) in vec3 in_Normal;
+layout (location = 3) in vec3 in_Tangent;
+
+uniform mat4 u_modelMatrix = mat4(1.0f);
+uniform mat4 u_viewMatrix = mat4(1.0f);
+uniform mat4 u_projMatrix = mat4(1.0f);
+
+// only the surface attributes, the lighting pass reconstructs the position (no light space positions)
+out VERTEX_TO_FRAGMENT{
+    vec3 normal;
+    vec2 texCoords;
+    mat3 TBN;       // matrix to transform normal from tangent space to world space
+}vs_out;
+
+// scale texture coords by these
+uniform float u_textureScaleX = 1.0f;
+uniform float u_textureScaleY = 1.0f;
+
+void main()
+{
+    gl_Position = u_projMatrix * u_viewMatrix * u_modelMatrix * vec4(in_Position, 1.0f);
+    vec3 normal = mat3(u_modelMatrix) * normalize(in_Normal);
+    vec3 tangent = mat3(u_modelMatrix) * normalize(in_Tangent);
+    vs_out.TBN = mat3(tangent, cross(normal, tangent), normal);
+    vs_out.normal = normal;
+    vs_out.texCoords = vec2(u_textureScaleX, u_textureScaleY) * in_TexCoords;
+}
@@ -1,10 +1,19 @@
 #version 330 core
-const int MAX_LIGHTS = 5;
+@include "lights.partial.glsl"
+@include "clusters.partial.glsl"
+@include "shadows.partial.glsl"
+
 const float PI = 3.14159265359;
 const float SQRT_PI = 1.77245385091;
 
 out vec4 FragColor;
 
+// DEFERRED: lighting pass of the deferred renderer, the surface is read from the G-buffer (drawn with a full screen quad)
+@keyword "DEFERRED"
+@include "gbuffer.partial.glsl"
+#ifdef DEFERRED
+GBufferSample fs_in;
+#else
 in VERTEX_TO_FRAGMENT{
     vec3 fragPos;
     vec3 normal;
@@ -12,50 +21,46 @@ in VERTEX_TO_FRAGMENT{
     mat3 TBN;
     vec4 fragPosLightSpace[MAX_LIGHTS];
 }fs_in;
-
-struct Light{
-   int type;        // 0 == directional | 1 == spotlight | 2 == pointlight
-   vec4 position;   // light position in world space    
-   float intensity; // 0 = no light
-   vec3 color;
-   bool enabled;        // flag if light is active
-   vec3 attenuation;    // distance attenuation: constant, linear, quadratic
-   vec3 target;         // spotlight target in world space
-   float cutOff;        // cos value of spotlight inner cut off angle
-   float outerCutOff;   // cos value of spotlight outer cut off angle, inner < outer
-   bool shadow;         // enable/disable using shadows
-   mat4 lightSpaceMatrix; // used to transform fragment from world space to light space
-   float farPlane;        // used for shadows
-   sampler2D shadowMap;   // shadow map texture for directional / spotlight
-   samplerCube shadowMapCube; // shadow map texture for point light
-};
+#endif
 
 uniform vec3 u_viewPos;                 // viewer position in world space
-uniform int u_numLights;                // number of lights
-uniform Light u_lights[MAX_LIGHTS]; 
+uniform int u_numLights;                // number of lights reaching the object
+uniform int u_lightIndices[MAX_LIGHTS];  // indices of the lights reaching the object (LightUniformBuffer::setObjectLights)
 
 uniform bool  u_gammaCorrect = false; // flag to enable/disable gamma correction
 
-// flags for textures
-uniform bool u_hasDiffTexture = false;
-uniform bool u_hasSpecTexture = false;
-uniform bool u_hasRoughTexture = false;
-uniform bool u_hasNormTexture = false;
-uniform bool u_hasMetallicTexture = false;
-uniform bool u_hasEmissiveTexture = false;
-uniform bool u_hasOpacityTexture = false;
+// texture keywords, enabled by Mesh::draw for the textures of the mesh
+@keyword "HAS_DIFFUSE_TEXTURE"
+@keyword "HAS_SPECULAR_TEXTURE"
+@keyword "HAS_ROUGHNESS_TEXTURE"
+@keyword "HAS_NORMAL_TEXTURE"
+@keyword "HAS_METALLIC_TEXTURE"
+@keyword "HAS_EMISSIVE_TEXTURE"
+@keyword "HAS_OPACITY_TEXTURE"
+#ifdef HAS_DIFFUSE_TEXTURE
 uniform sampler2D u_DiffuseTex;
+#endif
+#ifdef HAS_SPECULAR_TEXTURE
 uniform sampler2D u_SpecularTex;
+#endif
+#ifdef HAS_NORMAL_TEXTURE
 uniform sampler2D u_NormalTex;
+#endif
+#ifdef HAS_ROUGHNESS_TEXTURE
 uniform sampler2D u_RoughTex;
+#endif
+#ifdef HAS_METALLIC_TEXTURE
 uniform sampler2D u_MetallicTex;
+#endif
+#ifdef HAS_EMISSIVE_TEXTURE
 uniform sampler2D u_EmissiveTex;
+#endif
+#ifdef HAS_OPACITY_TEXTURE
 uniform sampler2D u_OpacityTex;
+#endif
 
 uniform vec3 u_emission; // emission color
 
-uniform int u_outputOnlyBRDF = 0; // flag to output only the BRDF
-
 vec3 BRDF(float geometryTerm, vec3 lightDir, vec3 normal, vec3 viewDir);
 
 // helper function to convert to linear from SRGB (raise to 2.2)
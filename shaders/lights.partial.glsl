@@ -0,0 +1,33 @@
+const int MAX_LIGHTS = 5; // must be the same as LightUniformBuffer::MAX_LIGHTS
+const int MAX_CASCADES = 4; // must be the same as Light::MAX_CASCADES
+
+// std140 layout, must match Light::UniformData
+struct Light{
+   mat4 lightSpaceMatrix; // used to transform fragment from world space to light space
+   vec4 position;   // light position in world space (w == 0 for directional)
+   vec3 color;
+   float intensity; // 0 = no light
+   vec3 attenuation;    // distance attenuation: constant, linear, quadratic
+   float cutOff;        // cos value of spotlight inner cut off angle
+   vec3 target;         // spotlight target in world space
+   float outerCutOff;   // cos value of spotlight outer cut off angle, inner < outer
+   int type;        // 0 == directional | 1 == spotlight | 2 == pointlight
+   bool enabled;        // flag if light is active
+   bool shadow;         // enable/disable using shadows
+   float farPlane;        // used for shadows
+   vec4 shadowRect;       // tile in the shadow atlas: xy = uv offset, zw = uv size of one face (0 = no tile)
+   // directional light cascades: light space coords of cascade i = coords of cascade 0 (lightSpaceMatrix) * scale + offset
+   vec4 cascadeScale[MAX_CASCADES];
+   vec4 cascadeOffset[MAX_CASCADES];
+   int cascadeCount;      // 0 = lightSpaceMatrix only
+   float nearPlane;       // used for hardware depth shadows (perspective projections)
+   float shadowFilterRadius; // PCF radius in shadow map texels (smallest penumbra of PCSS)
+   float shadowLightSize;    // PCSS: size of the light in world units (directional lights: penumbra per unit of distance)
+   vec4 shadowPosition;      // position of the light when its shadow map was rendered (used by the shadow lookups)
+   vec4 facePositions[6];    // point lights: position of the light when each cube face was last rendered
+};
+
+// shared by all lighting shaders, updated only when a light changes
+layout (std140) uniform Lights{
+   Light u_lights[MAX_LIGHTS];
+};
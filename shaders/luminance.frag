@@ -0,0 +1,15 @@
+#version 330 core
+// log luminance of the HDR color for the auto exposure (see PostprocessPipeline::measureExposure),
+// drawn to a small texture whose last mip level is the average over the screen
+out float logLuminance;
+in vec2 texCoords;
+
+uniform sampler2D u_texture; // HDR color (bilinear filtering)
+
+void main(){
+    vec3 color = texture(u_texture, texCoords).rgb;
+    // luminance https://www.itu.int/dms_pubrec/itu-r/rec/bt/R-REC-BT.709-6-201506-I!!PDF-E.pdf p. 4
+    float luminance = dot(vec3(0.2126, 0.7152, 0.0722), color);
+    // the average of the logarithm (geometric mean) isn't dominated by a few bright pixels
+    logLuminance = log(max(luminance, 0.0001f));
+}
@@ -17,17 +17,33 @@ uniform Material u_material;
 uniform bool u_modifiedSpecular;
 @endsection
 
+@section "deferred_material"
+// Phong material of the pixel: the shininess is stored as roughness and the specular coefficient as f0
+bool g_modifiedSpecular;
+#define u_modifiedSpecular g_modifiedSpecular
+void loadDeferredMaterial(){
+    vec4 kd_ka = materialParameter(fs_in, 0);
+    vec4 ia_modifiedSpecular = materialParameter(fs_in, 1);
+    g_material.kd = kd_ka.rgb;
+    g_material.diffuseColor = fs_in.albedo;
+    g_material.ks = fs_in.f0;
+    g_material.alpha = 2.0f * pow(max(fs_in.roughness, 0.001f), -2.0f);
+    g_material.ka = kd_ka.a;
+    g_material.ia = ia_modifiedSpecular.rgb;
+    g_modifiedSpecular = ia_modifiedSpecular.a > 0.5f;
+}
+@endsection
+
 @section "BRDF_implementation"
 // Phong BRDF function
 vec3 BRDF(float geometryTerm, vec3 lightDir, vec3 normal, vec3 viewDir){
 
-    vec3 diffuseCol;
-    if(u_hasDiffTexture){
-        // get the diffuse color from texture and do gamma correction
-        diffuseCol = texture(u_DiffuseTex, fs_in.texCoords).rgb;
-    } else {
-        diffuseCol = u_gammaCorrect ? toLinear(u_material.diffuseColor) : u_material.diffuseColor;
-    }
+#ifdef HAS_DIFFUSE_TEXTURE
+    // get the diffuse color from texture
+    vec3 diffuseCol = texture(u_DiffuseTex, fs_in.texCoords).rgb;
+#else
+    vec3 diffuseCol = u_gammaCorrect ? toLinear(u_material.diffuseColor) : u_material.diffuseColor;
+#endif
     // calculate diffuse term
     vec3 diffuse = u_material.kd * diffuseCol;
 
@@ -36,9 +52,17 @@ vec3 BRDF(float geometryTerm, vec3 lightDir, vec3 normal, vec3 viewDir){
     // get the angle between the reflection and viewing direction
     float cosPhi = max(0.0f, dot(viewDir, reflectDir));
     // calculate/ get the specular coefficient (from texture)
-    vec3 specFactor = u_hasSpecTexture ? texture(u_SpecularTex, fs_in.texCoords).rgb : u_material.ks;
+#ifdef HAS_SPECULAR_TEXTURE
+    vec3 specFactor = texture(u_SpecularTex, fs_in.texCoords).rgb;
+#else
+    vec3 specFactor = u_material.ks;
+#endif
     // approximate shininess from the roughness texture if it is used
-    float alpha = u_hasRoughTexture ? 2 * pow(texture(u_RoughTex, fs_in.texCoords).r, -2) : u_material.alpha;
+#ifdef HAS_ROUGHNESS_TEXTURE
+    float alpha = 2 * pow(texture(u_RoughTex, fs_in.texCoords).r, -2);
+#else
+    float alpha = u_material.alpha;
+#endif
     
     // calculate specular term
     vec3 specular = specFactor * pow(cosPhi, alpha);
@@ -1,4 +1,5 @@
 #version 330
+@include "upscale.partial.glsl"
 
 out vec4 outColor;
 in vec2 texCoords;
@@ -12,6 +13,12 @@ uniform bool  u_gammaCorrect = false; // flag to enable/disable gamma correction
 // value for White in reinhard mapping (smallest luminance mapped to pure white)
 uniform float u_reinhardWhite = 4; 
 
+uniform bool u_bloom = false;          // flag if the bloom was rendered (PostprocessPipeline::renderBloom)
+uniform sampler2D u_bloomTex;          // first level of the bloom chain (sum of all levels)
+uniform float u_bloomIntensity = 0.05f;
+
+uniform float u_exposure = 1.0f; // scale of the HDR color (auto exposure)
+
 vec3 reinhard_tonemap(vec3 col){
     // get luminance https://www.itu.int/dms_pubrec/itu-r/rec/bt/R-REC-BT.709-6-201506-I!!PDF-E.pdf p. 4
     float luminance = dot(vec3(0.2126, 0.7152, 0.0722), col);
@@ -23,7 +30,13 @@ vec3 reinhard_tonemap(vec3 col){
 
 void main(){
     // get color to output
-	vec3 color = texture(u_texture, texCoords).rgb;
+	vec3 color = sampleUpscaled(u_texture, texCoords);
+
+    // add the bloom before tonemapping
+    if(u_bloom){
+        color += texture(u_bloomTex, texCoords).rgb * u_bloomIntensity;
+    }
+    color *= u_exposure;
 
     if(u_hdr){
         color = reinhard_tonemap(color);
@@ -0,0 +1,29 @@
+#version 330 core
+@include "lights.partial.glsl"
+@include "shadows.partial.glsl"
+
+// visibility of the first lights (see src/Light/ShadowMask.h), filtered with the keywords of the shadow atlas
+layout (location = 0) out vec4 visibility;
+// distance from the camera, used for the bilateral upsampling in the lighting pass
+layout (location = 1) out float viewDistance;
+
+in VERTEX_TO_FRAGMENT{
+    vec3 fragPos;
+    vec3 normal;
+    vec2 texCoords;
+    mat3 TBN;
+    vec4 fragPosLightSpace[MAX_LIGHTS];
+}fs_in;
+
+uniform vec3 u_viewPos; // viewer position in world space
+
+void main()
+{
+    visibility = vec4(1.0f);
+    for(int i = 0; i < SHADOW_MASK_LIGHTS; ++i){
+        if(u_lights[i].enabled && u_lights[i].shadow && u_lights[i].shadowRect.z != 0.0f){
+            visibility[i] = shadowAtlasVisibility(u_lights[i], fs_in.fragPos, fs_in.fragPosLightSpace[i]);
+        }
+    }
+    viewDistance = distance(u_viewPos, fs_in.fragPos);
+}
@@ -0,0 +1,52 @@
+#version 330 core
+// converts the shadow maps of a cell of the shadow atlas to moments (VSM/EVSM) with a separable gaussian blur,
+// drawn with postprocess.vert and the viewport set to the cell (see ShadowAtlas::resolveMoments)
+// DEPTH_INPUT: first pass, reads the depth of the atlas and blurs horizontally, else blurs the moments vertically
+@keyword "DEPTH_INPUT"
+// SHADOW_COMPARE: the atlas stores hardware depth
+@keyword "SHADOW_COMPARE"
+@keyword "SHADOW_EVSM"
+@include "shadow_moments.partial.glsl"
+
+uniform sampler2D u_texture;   // depth of the atlas (sampler without compare) or moments of the first pass
+uniform vec4 u_cell;           // the cell in pixels (x, y, width, height), the blur doesn't read other cells
+uniform float u_blurRadius;    // radius of the gaussian in texels (Light.shadowFilterRadius)
+uniform int u_lightType;
+uniform float u_nearPlane;
+uniform float u_farPlane;
+
+// the largest blur radius in texels
+const int MAX_BLUR_RADIUS = 16;
+
+out vec4 moments;
+
+vec4 fetchMoments(ivec2 texel){
+#ifdef DEPTH_INPUT
+    float depth = texelFetch(u_texture, texel, 0).r;
+    return shadowMoments(shadowLinearDepth(u_lightType, u_nearPlane, u_farPlane, depth));
+#else
+    return texelFetch(u_texture, texel, 0);
+#endif
+}
+
+void main()
+{
+#ifdef DEPTH_INPUT
+    ivec2 axis = ivec2(1, 0);
+#else
+    ivec2 axis = ivec2(0, 1);
+#endif
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    ivec2 cellMin = ivec2(u_cell.xy);
+    ivec2 cellMax = ivec2(u_cell.xy + u_cell.zw) - 1;
+    int radius = min(int(ceil(u_blurRadius)), MAX_BLUR_RADIUS);
+    float sigma = max(0.5f * u_blurRadius, 0.5f);
+    vec4 sum = vec4(0.0f);
+    float weightSum = 0.0f;
+    for(int i = -radius; i <= radius; ++i){
+        float weight = exp(-0.5f * float(i * i) / (sigma * sigma));
+        sum += fetchMoments(clamp(texel + axis * i, cellMin, cellMax)) * weight;
+        weightSum += weight;
+    }
+    moments = sum / weightSum;
+}
@@ -0,0 +1,33 @@
+// moments of the shadow maps for VSM/EVSM (see src/Light/ShadowAtlas.h), shared by shadow_moments.frag which writes
+// them and shadows.partial.glsl which reads them. SHADOW_COMPARE and SHADOW_EVSM are declared by the including shader.
+
+// exponents of the EVSM warp (positive, negative), small enough that the second moment fits in RGBA16F
+const vec2 EVSM_EXPONENTS = vec2(5.0f, 5.0f);
+
+// linear depth in [0,1] of a depth of the shadow atlas (orthographic depth for directional lights,
+// hardware depth with SHADOW_COMPARE, else squared distance / farPlane^2)
+float shadowLinearDepth(int type, float nearPlane, float farPlane, float depth){
+    if(type == 0) return depth;
+#ifdef SHADOW_COMPARE
+    float ndc = depth * 2.0f - 1.0f;
+    return 2.0f * nearPlane / (farPlane + nearPlane - ndc * (farPlane - nearPlane));
+#else
+    return sqrt(max(depth, 0.0f));
+#endif
+}
+
+// EVSM: linear depth warped by exp(c * x) and -exp(-c * x), x in [-1,1]
+vec2 evsmWarp(float depth){
+    float x = depth * 2.0f - 1.0f;
+    return vec2(exp(EVSM_EXPONENTS.x * x), -exp(-EVSM_EXPONENTS.y * x));
+}
+
+// moments stored for a linear depth: VSM (depth, depth^2), EVSM (positive, positive^2, negative, negative^2)
+vec4 shadowMoments(float depth){
+#ifdef SHADOW_EVSM
+    vec2 warped = evsmWarp(depth);
+    return vec4(warped.x, warped.x * warped.x, warped.y, warped.y * warped.y);
+#else
+    return vec4(depth, depth * depth, 0.0f, 0.0f);
+#endif
+}
@@ -0,0 +1,10 @@
+#version 330 core
+layout (location = 0) in vec3 in_Position;
+
+uniform mat4 u_modelMatrix = mat4(1.0f); // map to world space
+
+void main()
+{
+    // world space position, projected to every cube face in the geometry shader
+    gl_Position = u_modelMatrix * vec4(in_Position, 1.0);
+}
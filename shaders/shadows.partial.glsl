@@ -0,0 +1,321 @@
+// shadow atlas (see src/Light/ShadowAtlas.h): one depth texture with a tile for every light casting shadows,
+// Light.shadowRect is the uv rect of the tile (of one face for point lights, the 6 faces are stored in a 3x2 block)
+// SHADOW_COMPARE: the shadow maps store hardware depth and the sampler compares it (GL_COMPARE_REF_TO_TEXTURE)
+@keyword "SHADOW_COMPARE"
+// filtering (none = one hard tap): rotated Poisson disk PCF with Light.shadowFilterRadius texels,
+// or PCSS (blocker search, then PCF with the penumbra of Light.shadowLightSize)
+@keyword "SHADOW_PCF"
+@keyword "SHADOW_PCSS"
+// SHADOW_MASK: the shadows of the first lights are read from a screen space mask (see src/Light/ShadowMask.h)
+@keyword "SHADOW_MASK"
+// filterable shadow maps: blurred and mipmapped moments of the atlas, variance (VSM) or exponential variance (EVSM)
+@keyword "SHADOW_VSM"
+@keyword "SHADOW_EVSM"
+@include "shadow_moments.partial.glsl"
+
+#if defined(SHADOW_VSM) || defined(SHADOW_EVSM)
+#define SHADOW_MOMENTS
+#endif
+
+#ifdef SHADOW_COMPARE
+// hardware depth, compare with bilinear filtering (4 texel PCF)
+uniform sampler2DShadow u_shadowAtlas;
+#else
+// squared distance / farPlane^2 for point lights and spotlights, orthographic depth for directional lights
+uniform sampler2D u_shadowAtlas;
+#endif
+
+// subtracted from the depth of the fragment (in the range of the squared distance and of the orthographic depth)
+const float SHADOW_BIAS = 0.001f;
+
+// position of a fragment in the shadow map of a light
+struct ShadowCoords {
+    vec2 coords;          // uv in the atlas
+    vec4 bounds;          // uv rect of the cell (min, max), kept half a texel inside so filtering doesn't read other cells
+    float depth;          // depth of the fragment in the range of the shadow map (bias included)
+    float depthRange;     // directional lights: world units per unit of depth
+    float texelsPerUnit;  // shadow map texels per world unit at the fragment
+};
+
+// uv rect of a cell of the tile in the atlas (min, max), half a texel inside the cell
+vec4 shadowCellBounds(vec4 rect, vec2 cell){
+    vec2 halfTexel = 0.5f / vec2(textureSize(u_shadowAtlas, 0));
+    vec2 cellMin = rect.xy + cell * rect.zw;
+    return vec4(cellMin + halfTexel, cellMin + rect.zw - halfTexel);
+}
+
+// depth of a perspective projection (hardware depth) at view depth z
+float perspectiveDepth(float z, float near, float far){
+    return ((far + near) / (far - near) - 2.0f * far * near / ((far - near) * z)) * 0.5f + 0.5f;
+}
+
+// depth of the fragment for a point light or spotlight (bias included): z = depth along the axis of the face/spotlight
+float radialShadowDepth(Light light, vec3 dir, float z){
+    float dist2 = dot(dir, dir) / (light.farPlane * light.farPlane);
+#ifdef SHADOW_COMPARE
+    // the bias of the squared distance as a factor of the distance: (d * (1 - b / 2d^2))^2 ~ d^2 - b
+    return perspectiveDepth(z * max(0.0f, 1.0f - 0.5f * SHADOW_BIAS / dist2), light.nearPlane, light.farPlane);
+#else
+    return dist2 - SHADOW_BIAS;
+#endif
+}
+
+// distance from the light in world units for a depth of the shadow map
+// (along the axis of the face/spotlight with hardware depth, directional lights: from the near plane)
+float shadowDepthToDistance(Light light, ShadowCoords shadow, float depth){
+    if(light.type == 0) return depth * shadow.depthRange;
+    return shadowLinearDepth(light.type, light.nearPlane, light.farPlane, depth) * light.farPlane;
+}
+
+// cube map face of a direction (major axis, OpenGL face orientation): st = coords on the face in [-ma, ma]
+int cubeFace(vec3 dir, out vec2 st, out float ma){
+    vec3 absDir = abs(dir);
+    if(absDir.x >= absDir.y && absDir.x >= absDir.z){
+        st = vec2(dir.x > 0.0f ? -dir.z : dir.z, -dir.y);
+        ma = absDir.x;
+        return dir.x > 0.0f ? 0 : 1;
+    }
+    if(absDir.y >= absDir.z){
+        st = vec2(dir.x, dir.y > 0.0f ? dir.z : -dir.z);
+        ma = absDir.y;
+        return dir.y > 0.0f ? 2 : 3;
+    }
+    st = vec2(dir.z > 0.0f ? dir.x : -dir.x, -dir.y);
+    ma = absDir.z;
+    return dir.z > 0.0f ? 4 : 5;
+}
+
+// find the fragment in the shadow map of the light.
+// False if the fragment is outside the shadow maps (beyond the far plane or the cascades)
+bool shadowAtlasLookup(Light light, vec3 fragPos, vec4 fragPosLightSpace, out ShadowCoords shadow){
+    float cellTexels = light.shadowRect.z * float(textureSize(u_shadowAtlas, 0).x);
+    // defined on every path (the gradients of the coords are taken before checking the result)
+    shadow.coords = vec2(0.0f);
+    shadow.depthRange = 0.0f;
+    // point light: select the face like a cube map lookup. The faces can be rendered in different frames (update
+    // budget of the atlas), so the face found from the latest position is read from the position it was rendered at
+    if(light.type == 2){
+        vec2 st;
+        float ma;
+        vec3 dir = fragPos - light.facePositions[cubeFace(fragPos - light.shadowPosition.xyz, st, ma)].xyz;
+        int face = cubeFace(dir, st, ma);
+        shadow.depth = radialShadowDepth(light, dir, ma);
+        shadow.bounds = shadowCellBounds(light.shadowRect, vec2(face % 3, face / 3));
+        shadow.coords = clamp(light.shadowRect.xy + vec2(face % 3, face / 3) * light.shadowRect.zw + (st / ma * 0.5f + 0.5f) * light.shadowRect.zw,
+            shadow.bounds.xy, shadow.bounds.zw);
+        // 90 degrees field of view: the face is 2 * ma wide
+        shadow.texelsPerUnit = cellTexels * 0.5f / ma;
+        return dot(dir, dir) <= light.farPlane * light.farPlane;
+    }
+
+    // directional light / spotlight: lightspace coords in clip space
+    vec3 coords = fragPosLightSpace.xyz / fragPosLightSpace.w;
+    // x scale of the projection (the rows of the view matrix have length 1)
+    float projectionScale = length(vec3(light.lightSpaceMatrix[0][0], light.lightSpaceMatrix[1][0], light.lightSpaceMatrix[2][0]));
+    int cell = 0;
+    if(light.type == 0){
+        // directional light: first cascade (in 2 columns) that contains the fragment
+        cell = -1;
+        vec3 scale = vec3(1.0f);
+        for(int i = 0; i < light.cascadeCount; ++i){
+            vec3 cascadeCoords = coords * light.cascadeScale[i].xyz + light.cascadeOffset[i].xyz;
+            if(all(lessThan(abs(cascadeCoords.xy), vec2(0.99f)))){
+                coords = cascadeCoords;
+                scale = light.cascadeScale[i].xyz;
+                cell = i;
+                break;
+            }
+        }
+        // not fitted to the camera: single map
+        if(light.cascadeCount == 0) cell = 0;
+        // beyond the shadow distance => no shadow
+        if(cell < 0) return false;
+        // orthographic depth is the hardware depth
+        shadow.depth = coords.z * 0.5f + 0.5f - SHADOW_BIAS;
+        // depth [0,1] = 2 units of the z row of the projection
+        float depthScale = length(vec3(light.lightSpaceMatrix[0][2], light.lightSpaceMatrix[1][2], light.lightSpaceMatrix[2][2]));
+        shadow.depthRange = 2.0f / (depthScale * scale.z);
+        shadow.texelsPerUnit = cellTexels * 0.5f * projectionScale * scale.x;
+        if(coords.z > 1.0f) return false;
+    }
+    else {
+        vec3 dir = fragPos - light.shadowPosition.xyz;
+        shadow.depth = radialShadowDepth(light, dir, fragPosLightSpace.w);
+        shadow.texelsPerUnit = cellTexels * 0.5f * projectionScale / fragPosLightSpace.w;
+        if(dot(dir, dir) > light.farPlane * light.farPlane) return false;
+    }
+    shadow.bounds = shadowCellBounds(light.shadowRect, vec2(cell % 2, cell / 2));
+    shadow.coords = clamp(light.shadowRect.xy + vec2(cell % 2, cell / 2) * light.shadowRect.zw + (coords.xy * 0.5f + 0.5f) * light.shadowRect.zw,
+        shadow.bounds.xy, shadow.bounds.zw);
+    return true;
+}
+
+// 1 if the fragment at depth is lit at the atlas coords
+float shadowCompare(vec2 coords, float depth){
+#ifdef SHADOW_COMPARE
+    return texture(u_shadowAtlas, vec3(coords, depth));
+#else
+    return depth > texture(u_shadowAtlas, coords).r ? 0.0f : 1.0f;
+#endif
+}
+
+#if defined(SHADOW_PCF) || defined(SHADOW_PCSS)
+uniform int u_shadowSamples = 16; // taps of the Poisson disk (at most 32)
+
+// the largest PCF radius (and blocker search radius) of PCSS in texels
+const float PCSS_MAX_RADIUS = 32.0f;
+
+// Poisson disk in the unit circle, every prefix is evenly spread (fewer samples = first taps)
+const vec2 POISSON_DISK[32] = vec2[](
+    vec2(-0.0680f, -0.0323f), vec2(0.8196f, 0.5646f), vec2(0.7873f, -0.6015f), vec2(-0.4101f, 0.9039f),
+    vec2(-0.9913f, -0.0184f), vec2(-0.2233f, -0.9321f), vec2(0.2813f, 0.9128f), vec2(0.9056f, -0.0385f),
+    vec2(-0.7638f, -0.5586f), vec2(-0.5608f, 0.3438f), vec2(0.3539f, 0.3049f), vec2(0.2238f, -0.5920f),
+    vec2(-0.1135f, 0.4655f), vec2(-0.3058f, -0.4312f), vec2(0.3921f, -0.1879f), vec2(-0.5586f, -0.0696f),
+    vec2(0.1783f, -0.9779f), vec2(0.5059f, -0.8521f), vec2(-0.7269f, 0.6859f), vec2(-0.9073f, 0.3313f),
+    vec2(0.4687f, 0.6252f), vec2(-0.0780f, 0.8139f), vec2(0.6867f, 0.2253f), vec2(-0.5394f, -0.7747f),
+    vec2(0.7072f, -0.2847f), vec2(0.0052f, -0.3871f), vec2(0.1579f, 0.6173f), vec2(-0.7911f, -0.2508f),
+    vec2(-0.3331f, 0.1326f), vec2(0.5057f, -0.5530f), vec2(-0.4279f, 0.6106f), vec2(-0.1054f, -0.6621f)
+);
+
+// per pixel rotation of the disk (interleaved gradient noise), turns banding into noise
+mat2 shadowDiskRotation(){
+    float angle = 6.28318530718f * fract(52.9829189f * fract(dot(gl_FragCoord.xy, vec2(0.06711056f, 0.00583715f))));
+    float s = sin(angle), c = cos(angle);
+    return mat2(c, s, -s, c);
+}
+
+// average of the compares in a disk of radius texels
+float shadowPCF(ShadowCoords shadow, float radius, mat2 rotation){
+    vec2 texel = 1.0f / vec2(textureSize(u_shadowAtlas, 0));
+    int samples = clamp(u_shadowSamples, 1, 32);
+    float lit = 0.0f;
+    for(int i = 0; i < samples; ++i){
+        vec2 coords = clamp(shadow.coords + rotation * POISSON_DISK[i] * radius * texel, shadow.bounds.xy, shadow.bounds.zw);
+        lit += shadowCompare(coords, shadow.depth);
+    }
+    return lit / float(samples);
+}
+#endif
+
+#ifdef SHADOW_PCSS
+#ifdef SHADOW_COMPARE
+// the blocker search reads the depth (same texture, sampler object without compare)
+uniform sampler2D u_shadowAtlasDepth;
+#define SHADOW_DEPTH_SAMPLER u_shadowAtlasDepth
+#else
+#define SHADOW_DEPTH_SAMPLER u_shadowAtlas
+#endif
+
+// percentage closer soft shadows: the penumbra grows with the distance between the blockers and the fragment
+// (perspective lights: light size / blocker distance, directional lights: light size per unit of distance)
+float shadowPCSS(Light light, ShadowCoords shadow){
+    mat2 rotation = shadowDiskRotation();
+    vec2 texel = 1.0f / vec2(textureSize(u_shadowAtlas, 0));
+    // blocker search in the region where a blocker between the light and the fragment can be
+    float searchDistance = light.type == 0 ? shadowDepthToDistance(light, shadow, shadow.depth) : 1.0f;
+    float searchRadius = clamp(light.shadowLightSize * searchDistance * shadow.texelsPerUnit, light.shadowFilterRadius, PCSS_MAX_RADIUS);
+    int samples = clamp(u_shadowSamples, 1, 32);
+    float blockerDepth = 0.0f;
+    float blockers = 0.0f;
+    for(int i = 0; i < samples; ++i){
+        vec2 coords = clamp(shadow.coords + rotation * POISSON_DISK[i] * searchRadius * texel, shadow.bounds.xy, shadow.bounds.zw);
+        float depth = texture(SHADOW_DEPTH_SAMPLER, coords).r;
+        if(depth < shadow.depth){
+            blockerDepth += depth;
+            blockers += 1.0f;
+        }
+    }
+    if(blockers == 0.0f) return 1.0f;
+
+    float receiverDistance = shadowDepthToDistance(light, shadow, shadow.depth);
+    float blockerDistance = shadowDepthToDistance(light, shadow, blockerDepth / blockers);
+    float penumbra = (receiverDistance - blockerDistance) * light.shadowLightSize / (light.type == 0 ? 1.0f : max(blockerDistance, 0.0001f));
+    return shadowPCF(shadow, clamp(penumbra * shadow.texelsPerUnit, light.shadowFilterRadius, PCSS_MAX_RADIUS), rotation);
+}
+#endif
+
+#ifdef SHADOW_MOMENTS
+uniform sampler2D u_shadowMoments; // moments of the atlas (same layout), trilinear and anisotropic filtering
+
+// smallest variance, avoids acne on flat receivers (in units of linear depth^2, scaled by the warp for EVSM)
+const float VSM_MIN_VARIANCE = 0.00001f;
+// cuts the tail of the Chebyshev bound (0 = none), hides light bleeding where shadows overlap
+const float VSM_BLEEDING_REDUCTION = 0.2f;
+
+// probability that a fragment at depth is lit (Chebyshev upper bound) for the mean depth and mean squared depth
+float chebyshevUpperBound(vec2 moments, float depth, float minVariance){
+    if(depth <= moments.x) return 1.0f;
+    float variance = max(moments.y - moments.x * moments.x, minVariance);
+    float d = depth - moments.x;
+    float p = variance / (variance + d * d);
+    return clamp((p - VSM_BLEEDING_REDUCTION) / (1.0f - VSM_BLEEDING_REDUCTION), 0.0f, 1.0f);
+}
+
+// visibility from the filtered moments (dx, dy = gradients of the atlas coords)
+float shadowMomentsVisibility(Light light, ShadowCoords shadow, vec2 dx, vec2 dy){
+    // the coords jump between cells (cube faces, cascades): use the finest level there
+    if(max(length(dx), length(dy)) > 0.25f * light.shadowRect.z){
+        dx = vec2(0.0f);
+        dy = vec2(0.0f);
+    }
+    vec4 moments = textureGrad(u_shadowMoments, shadow.coords, dx, dy);
+    float depth = shadowLinearDepth(light.type, light.nearPlane, light.farPlane, shadow.depth);
+#ifdef SHADOW_EVSM
+    vec2 warped = evsmWarp(depth);
+    vec2 minVariance = VSM_MIN_VARIANCE * EVSM_EXPONENTS * EVSM_EXPONENTS * warped * warped;
+    return min(chebyshevUpperBound(moments.xy, warped.x, minVariance.x), chebyshevUpperBound(moments.zw, warped.y, minVariance.y));
+#else
+    return chebyshevUpperBound(moments.xy, depth, VSM_MIN_VARIANCE);
+#endif
+}
+#endif
+
+// visibility of the fragment from the light: 0 = in shadow, 1 = lit
+float shadowAtlasVisibility(Light light, vec3 fragPos, vec4 fragPosLightSpace){
+    ShadowCoords shadow;
+    bool inside = shadowAtlasLookup(light, fragPos, fragPosLightSpace, shadow);
+#ifdef SHADOW_MOMENTS
+    // before the branch, derivatives are undefined in non uniform control flow
+    vec2 dx = dFdx(shadow.coords);
+    vec2 dy = dFdy(shadow.coords);
+#endif
+    if(!inside) return 1.0f;
+#if defined(SHADOW_MOMENTS)
+    return shadowMomentsVisibility(light, shadow, dx, dy);
+#elif defined(SHADOW_PCSS)
+    return shadowPCSS(light, shadow);
+#elif defined(SHADOW_PCF)
+    return shadowPCF(shadow, light.shadowFilterRadius, shadowDiskRotation());
+#else
+    return shadowCompare(shadow.coords, shadow.depth);
+#endif
+}
+
+// lights in the screen space mask (rgba), must be the same as ShadowMask::LIGHTS
+const int SHADOW_MASK_LIGHTS = 4;
+
+#ifdef SHADOW_MASK
+uniform sampler2D u_shadowMask;         // visibility of the first lights (rgba) at reduced resolution
+uniform sampler2D u_shadowMaskDistance; // distance of the mask texels from the camera
+uniform vec4 u_shadowMaskScale;         // xy = mask size / framebuffer size
+
+// bilateral upsampling of the mask: the 4 nearest texels weighted by distance and by how close their depth is
+float shadowMaskVisibility(int index, float viewDistance){
+    vec2 coords = gl_FragCoord.xy * u_shadowMaskScale.xy - 0.5f;
+    ivec2 base = ivec2(floor(coords));
+    vec2 f = coords - vec2(base);
+    ivec2 size = textureSize(u_shadowMask, 0);
+    float visibility = 0.0f;
+    float weightSum = 0.0f;
+    for(int i = 0; i < 4; ++i){
+        ivec2 offset = ivec2(i & 1, i >> 1);
+        ivec2 texel = clamp(base + offset, ivec2(0), size - 1);
+        vec2 bilinear = mix(1.0f - f, f, vec2(offset));
+        float depthDifference = abs(texelFetch(u_shadowMaskDistance, texel, 0).r - viewDistance) / viewDistance;
+        float weight = (bilinear.x * bilinear.y + 0.001f) / (depthDifference + 0.001f);
+        visibility += texelFetch(u_shadowMask, texel, 0)[index] * weight;
+        weightSum += weight;
+    }
+    return visibility / weightSum;
+}
+#endif
@@ -0,0 +1,46 @@
+#version 330 core
+// resolve of the temporal anti-aliasing (TemporalAA::resolve): the new frame is blended into the reprojected history,
+// the history is clamped to the colors around the pixel in the new frame (no ghosting of moving objects and
+// disocclusions). Drawn at the screen size, the frame can be smaller (dynamic resolution)
+@include "temporal.partial.glsl"
+
+out vec4 outColor;
+in vec2 texCoords;
+
+uniform sampler2D u_colorTex;     // HDR color of the frame (bilinear filtering)
+uniform vec2 u_jitter;            // jitter of the frame in uv units
+uniform float u_feedback = 0.9f;  // weight of the history
+
+float luminance(vec3 color){
+    return dot(color, vec3(0.2126f, 0.7152f, 0.0722f));
+}
+
+void main(){
+    // the frame without the jitter
+    vec2 uv = texCoords + u_jitter;
+    vec3 current = texture(u_colorTex, uv).rgb;
+
+    vec2 prevUV;
+    if(!reproject(texCoords, prevUV)){
+        outColor = vec4(current, 1.0f);
+        return;
+    }
+
+    // range of the 3x3 neighbourhood in the frame
+    vec2 texelSize = 1.0f / vec2(textureSize(u_colorTex, 0));
+    vec3 minColor = current;
+    vec3 maxColor = current;
+    for(int x = -1; x <= 1; ++x){
+        for(int y = -1; y <= 1; ++y){
+            vec3 color = texture(u_colorTex, uv + texelSize * vec2(x, y)).rgb;
+            minColor = min(minColor, color);
+            maxColor = max(maxColor, color);
+        }
+    }
+    vec3 history = clamp(texture(u_historyTex, prevUV).rgb, minColor, maxColor);
+
+    // weights of the tonemapped colors, bright pixels don't flicker
+    float currentWeight = (1.0f - u_feedback) / (1.0f + luminance(current));
+    float historyWeight = u_feedback / (1.0f + luminance(history));
+    outColor = vec4((current * currentWeight + history * historyWeight) / (currentWeight + historyWeight), 1.0f);
+}
@@ -0,0 +1,21 @@
+#version 330 core
+// velocity buffer of the temporal anti-aliasing (TemporalAA::resolve): screen space motion of every pixel since the
+// previous frame, from its depth and the view-projections (camera motion only, moving objects are handled by the
+// neighbourhood clamp of the resolve)
+
+out vec2 outVelocity;
+in vec2 texCoords;
+
+uniform sampler2D u_depthTex;
+uniform mat4 u_inverseViewProjMatrix; // jittered, the depth was rendered with it
+uniform mat4 u_viewProjMatrix;        // without jitter
+uniform mat4 u_prevViewProjMatrix;    // previous frame without jitter
+
+void main(){
+    float depth = texelFetch(u_depthTex, ivec2(gl_FragCoord.xy), 0).r;
+    // homogeneous position, not divided by w: the background of the infinite projection is a point at infinity (w = 0)
+    vec4 position = u_inverseViewProjMatrix * vec4(vec3(texCoords, depth) * 2.0f - 1.0f, 1.0f);
+    vec4 current = u_viewProjMatrix * position;
+    vec4 previous = u_prevViewProjMatrix * position;
+    outVelocity = (current.xy / current.w - previous.xy / previous.w) * 0.5f;
+}
@@ -0,0 +1,10 @@
+// reprojection into the history of the previous frames (TemporalAA::bindHistory)
+uniform sampler2D u_historyTex;  // latest resolved color (screen size, bilinear filtering)
+uniform sampler2D u_velocityTex; // motion of the pixels since the previous frame in uv units
+uniform bool u_historyValid = false;
+
+// position of a pixel in the previous frame, false if there is no history or it was outside the screen
+bool reproject(vec2 uv, out vec2 prevUV){
+    prevUV = uv - texture(u_velocityTex, uv).rg;
+    return u_historyValid && all(greaterThanEqual(prevUV, vec2(0.0f))) && all(lessThanEqual(prevUV, vec2(1.0f)));
+}
@@ -1,11 +1,20 @@
 #version 330 core
-const int MAX_LIGHTS = 5;
+@include "lights.partial.glsl"
+@include "clusters.partial.glsl"
+@include "shadows.partial.glsl"
+
 const float PI = 3.14159265359;
 const float SQRT_PI = 1.77245385091;
 
 layout (location = 0) out vec4 fragColor;
 layout (location = 1) out vec4 distance_normal;
 
+// DEFERRED: lighting pass of the deferred renderer, the surface is read from the G-buffer (drawn with a full screen quad)
+@keyword "DEFERRED"
+@include "gbuffer.partial.glsl"
+#ifdef DEFERRED
+GBufferSample fs_in;
+#else
 in VERTEX_TO_FRAGMENT{
     vec3 fragPos;
     vec3 normal;
@@ -13,27 +22,11 @@ in VERTEX_TO_FRAGMENT{
     mat3 TBN;
     vec4 fragPosLightSpace[MAX_LIGHTS];
 }fs_in;
-
-struct Light{
-   int type; // 0 == directional | 1 == spotlight | 2 == pointlight
-   vec4 position;       // w == 0 for directional
-   float intensity;     // 0 to 1
-   vec3 color;
-   bool enabled;
-   vec3 attenuation;    // constant, linear, quadratic
-   vec3 target;         // for spotlight
-   float cutOff;        // cos value ---> 1 if not spotlight
-   float outerCutOff;   // cos value
-   bool shadow;         // if casting shadow
-   mat4 lightSpaceMatrix;
-   float farPlane;
-   sampler2D shadowMap;
-   samplerCube shadowMapCube;
-};
+#endif
 
 uniform vec3 u_viewPos;                 // viewer position in world space
-uniform int u_numLights;                // number of lights
-uniform Light u_lights[MAX_LIGHTS]; 
+uniform int u_numLights;                // number of lights reaching the object
+uniform int u_lightIndices[MAX_LIGHTS];  // indices of the lights reaching the object (LightUniformBuffer::setObjectLights)
 
 uniform bool  u_gammaCorrect = false; // flag to enable/disable gamma correction
 
@@ -55,9 +48,64 @@ struct Material{
    vec3 ambientColor;
 };
 uniform Material u_material;
+#ifdef DEFERRED
+// the material of the pixel (G-buffer albedo, ambient color from the material table)
+Material g_material;
+#define u_material g_material
+#endif
+
+// count a light as fully/partially lit and accumulate its color (visibility = shadow factor)
+void toonLighting(Light light, float visibility, vec3 normal, inout vec3 diffuseColor, inout int isFullyLit, inout int isPartiallyLit){
+    // light direction: from fragment to light position
+    vec3 lightDir = normalize(light.position.xyz - fs_in.fragPos);
+
+    // check if light is directional
+    if(light.type == 0){
+        lightDir = normalize(light.position.xyz); // the direction is the light "position"
+    }
+
+    // check if light is behind
+    if(dot(normalize(fs_in.normal), lightDir) < 0.0f) return;
+
+    // calculate geometryTerm using light direction and the normal
+    float geometryTerm = max(0.0f, dot(normal, lightDir));
+
+
+    // gamma correct the light color
+    vec3 lightCol = u_gammaCorrect ? toLinear(light.color) : light.color;
+
+    vec3 currentResult = visibility *
+        light.intensity * lightCol * geometryTerm *       // light amount at this fragment
+        diffuseColor *
+        spotlightFactor(light, lightDir);                 // spotlightFactor
+
+    // check if fragment is lit at all (shadow of spotlight factor or intensity == 0)
+    bool isLit = dot(vec3(1.0f), currentResult) > 0;
+    if(!isLit) return; // if not lit skip
+
+    // check if it is partially/fully lit based on geometry term
+    if(geometryTerm < 0.5f) isPartiallyLit++;
+    else if(geometryTerm > 0.5f) isFullyLit++;
+
+    // accumulate light color and intensity
+    diffuseColor *= light.intensity * lightCol;
+}
 
 void main()
 {
+#ifdef DEFERRED
+    // nothing was drawn in the background (keep the clear color)
+    if(!readGBuffer(fs_in)) discard;
+    // unlit materials output their emission
+    if(fs_in.materialId == UNLIT_MATERIAL){
+        fragColor = vec4(u_gammaCorrect ? toLinear(fs_in.albedo) : fs_in.albedo, 1.0f);
+        distance_normal = vec4(fs_in.normal * 0.5f + 0.5f, distance(u_viewPos, fs_in.fragPos) / 50);
+        return;
+    }
+    g_material.diffuseColor = fs_in.albedo;
+    g_material.ambientColor = materialParameter(fs_in, 0).rgb;
+#endif
+
     vec3 ambientColor = u_gammaCorrect ? toLinear(u_material.ambientColor) : u_material.ambientColor;
     vec3 diffuseColor = u_gammaCorrect ? toLinear(u_material.diffuseColor) : u_material.diffuseColor;
 
@@ -68,47 +116,22 @@ void main()
     // count how many lights fully lit/partially lit fragment
     int isFullyLit = 0;
     int isPartiallyLit = 0;
-    // go through each light and calculate the contribution
-    for(int i=0;i<u_numLights;++i){
-        // if light is disabled => skip
-        if(u_lights[i].enabled == false){
-            continue;
-        }
-        // light direction: from fragment to light position
-        vec3 lightDir = normalize(u_lights[i].position.xyz - fs_in.fragPos);    
-        
-        // check if light is directional
-        if(u_lights[i].type == 0){
-            lightDir = normalize(u_lights[i].position.xyz); // the direction is the light "position"
-        }
-
-        // check if light is behind
-        if(dot(normalize(fs_in.normal), lightDir) < 0.0f) continue;
-        
-        // calculate geometryTerm using light direction and the normal
-        float geometryTerm = max(0.0f, dot(normal, lightDir));
-
-
-        // gamma correct the light color
-        vec3 lightCol = u_gammaCorrect ? toLinear(u_lights[i].color) : u_lights[i].color;
-
-        vec3 currentResult = getShadow(i) *
-            u_lights[i].intensity * lightCol * geometryTerm *       // light amount at this fragment
-            diffuseColor *
-            spotlightFactor(u_lights[i], lightDir);                 // spotlightFactor
-        
-        // check if fragment is lit at all (shadow of spotlight factor or intensity == 0)
-        bool isLit = dot(vec3(1.0f), currentResult) > 0;
-        if(!isLit) continue; // if not lit skip
-
-        // check if it is partially/fully lit based on geometry term
-        if(geometryTerm < 0.5f) isPartiallyLit++;
-        else if(geometryTerm > 0.5f) isFullyLit++;
-
-        // accumulate light color and intensity
-        diffuseColor *= u_lights[i].intensity * lightCol;
+    // go through each light reaching the object and calculate the contribution
+    // (disabled and out of range lights are not in the list)
+    for(int k=0;k<u_numLights;++k){
+        int i = u_lightIndices[k];
+        toonLighting(u_lights[i], getShadow(i), normal, diffuseColor, isFullyLit, isPartiallyLit);
     }
 
+#ifdef CLUSTERED_LIGHTS
+    // clustered lights light the fragment inside their range
+    uvec2 cluster = getCluster(fs_in.fragPos);
+    for(uint i=0u;i<cluster.y;++i){
+        Light light = getClusterLight(cluster.x + i);
+        toonLighting(light, clusterLightWindow(light, fs_in.fragPos), normal, diffuseColor, isFullyLit, isPartiallyLit);
+    }
+#endif
+
     // if not lit at all output ambient color 
     if(isFullyLit + isPartiallyLit == 0){
         fragColor = vec4(ambientColor, 1.0f);    
@@ -131,7 +154,7 @@ vec3 toLinear(vec3 color){
 
 float spotlightFactor(Light light, vec3 lightDir){
     if(light.type != 1){
-        return 1;
+        return 1.0f;
     }
     // get the spotlight direction: from the light to the target
 	vec3 spotDir = normalize(light.target - light.position.xyz);
@@ -142,44 +165,16 @@ float spotlightFactor(Light light, vec3 lightDir){
 }
 
 float getShadow(int index){
-    if(u_lights[index].shadow == false) return 1.0f;
-
-    float shadowMapDepth;
-
-    // if light is pointlight sample cubemap
-    if(u_lights[index].type == 2){
-        vec3 lightToFrag = fs_in.fragPos - u_lights[index].position.xyz;
-        switch(index){
-            case 0: shadowMapDepth = texture(u_lights[0].shadowMapCube, lightToFrag).r; break;
-            case 1: shadowMapDepth = texture(u_lights[1].shadowMapCube, lightToFrag).r; break;
-            case 2: shadowMapDepth = texture(u_lights[2].shadowMapCube, lightToFrag).r; break;
-            case 3: shadowMapDepth = texture(u_lights[3].shadowMapCube, lightToFrag).r; break;
-            case 4: shadowMapDepth = texture(u_lights[4].shadowMapCube, lightToFrag).r; break;
-        }
-    }
-    else {
-        vec3 fragPosLightSpace = fs_in.fragPosLightSpace[index].xyz / fs_in.fragPosLightSpace[index].w;
-        vec3 fragPosLightTexCoords = fragPosLightSpace * 0.5 + 0.5;
-        switch(index){
-            case 0: shadowMapDepth = texture(u_lights[0].shadowMap, fragPosLightTexCoords.xy).r; break;
-            case 1: shadowMapDepth = texture(u_lights[1].shadowMap, fragPosLightTexCoords.xy).r; break;
-            case 2: shadowMapDepth = texture(u_lights[2].shadowMap, fragPosLightTexCoords.xy).r; break;
-            case 3: shadowMapDepth = texture(u_lights[3].shadowMap, fragPosLightTexCoords.xy).r; break;
-            case 4: shadowMapDepth = texture(u_lights[4].shadowMap, fragPosLightTexCoords.xy).r; break;
-        }
-    }
-    vec3 currentDist = fs_in.fragPos.xyz - u_lights[index].position.xyz;
-
-    // use squared distance instead of distance to avoid square root
-    // so we have a*a / farplane * farplane instead of sqrt(a*a) / farplane
-    float currentDepth = dot(currentDist, currentDist) / pow(u_lights[index].farPlane, 2);
-    float bias = 0.001f;
-    // add some bias to the depth from the shadowmap texture
-    bool in_shadow = currentDepth > shadowMapDepth + bias ? true : false;
-    
-    if(currentDepth > 1) { // if outside the far plane => no shadow
-        in_shadow = false;
-    }
-   
-    return in_shadow == true ? 0.0f : 1.0f;
+    if(u_lights[index].shadow == false || u_lights[index].shadowRect.z == 0.0f) return 1.0f;
+
+#ifdef SHADOW_MASK
+    // the first lights are filtered at reduced resolution in the screen space mask
+    if(index < SHADOW_MASK_LIGHTS) return shadowMaskVisibility(index, distance(u_viewPos, fs_in.fragPos));
+#endif
+    // compare the depth of the fragment with the shadow map in the shadow atlas
+#ifdef DEFERRED
+    return shadowAtlasVisibility(u_lights[index], fs_in.fragPos, u_lights[index].lightSpaceMatrix * vec4(fs_in.fragPos, 1.0f));
+#else
+    return shadowAtlasVisibility(u_lights[index], fs_in.fragPos, fs_in.fragPosLightSpace[index]);
+#endif
 }
\ No newline at end of file
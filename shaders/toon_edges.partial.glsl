@@ -0,0 +1,42 @@
+// toon outlines: edges of the normals found with the Sobel operator
+// https://citeseerx.ist.psu.edu/document?repid=rep1&type=pdf&doi=676679e17b9033b8a1eb1c2618cb5bd9e3c4504c
+// distNormalTex: normal (rgb) and distance scaled by the far plane (a), textureSize: its size in pixels
+// returns 0 on an edge, 1 elsewhere
+float toonEdge(sampler2D distNormalTex, vec2 uv, vec2 textureSize){
+    float dist = texture(distNormalTex, uv).a; // get fragment distance (scaled by farplane)
+
+    // make texture sampling offsets smaller with distance
+    float xOffset = 3.0f / (textureSize.x + 3.0f * dist * textureSize.x);
+    float yOffset = 3.0f / (textureSize.y + 3.0f * dist * textureSize.y);
+
+    float[9] xOffsets = float[](-xOffset, 0, xOffset, -xOffset, 0, xOffset, -xOffset, 0, xOffset);
+    float[9] yOffsets = float[](yOffset, yOffset, yOffset, 0, 0, 0, -yOffset, -yOffset, -yOffset);
+
+    // vertical sobel kernel
+     const float kernelV[9] = float[](
+        1, 2, 1,
+        0,  0, 0,
+        -1, -2, -1
+    );
+
+    // horizontal sobel kernel
+    const float kernelH[9] = float[](
+        -1, 0, 1,
+        -2,  0, 2,
+        -1, 0, 1
+    );
+
+    vec3 Gx = vec3(0.0);
+    vec3 Gy = vec3(0.0);
+    // apply sobel convolution
+    for(int i = 0; i < 9; i++)
+    {
+        vec3 normal = vec3(texture(distNormalTex, uv + vec2(xOffsets[i], yOffsets[i])).rgb);
+        Gx += normal * kernelH[i]; // horizontal
+        Gy += normal * kernelV[i]; // vertical
+    }
+    vec3 G = abs(Gx) + abs(Gy); // combine results
+
+    // assume if one of the channels is >= ~0.6 then there is an edge
+    return (G.x > 0.6 || G.y > 0.6 || G.z > 0.6) ? 0.0f : 1.0f;
+}
@@ -0,0 +1,20 @@
+#version 330
+@include "toon_edges.partial.glsl"
+
+// toon outlines drawn into the HDR color at the render size, before the temporal anti-aliasing resolve
+// (the jittered edges are accumulated with the color instead of being detected again on the resolved frame)
+
+out vec4 outColor;
+in vec2 texCoords;
+
+uniform sampler2D u_colorTex;
+uniform sampler2D u_distNormalTex;
+
+// size of the textures (render size)
+uniform float u_textureWidth = 1280;
+uniform float u_textureHeight = 720;
+
+void main(){
+    vec4 color = texture(u_colorTex, texCoords);
+    outColor = vec4(color.rgb * toonEdge(u_distNormalTex, texCoords, vec2(u_textureWidth, u_textureHeight)), color.a);
+}
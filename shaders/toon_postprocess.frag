@@ -1,4 +1,6 @@
 #version 330
+@include "upscale.partial.glsl"
+@include "toon_edges.partial.glsl"
 
 out vec4 outColor;
 in vec2 texCoords;
@@ -13,6 +15,12 @@ uniform bool  u_gammaCorrect = false; // flag to enable/disable gamma correction
 // value for White in reinhard mapping (smallest luminance mapped to pure white)
 uniform float u_reinhardWhite = 4; 
 
+uniform bool u_bloom = false;          // flag if the bloom was rendered (PostprocessPipeline::renderBloom)
+uniform sampler2D u_bloomTex;          // first level of the bloom chain (sum of all levels)
+uniform float u_bloomIntensity = 0.05f;
+
+uniform float u_exposure = 1.0f; // scale of the HDR color (auto exposure)
+
 vec3 reinhard_tonemap(vec3 col){
     // get luminance https://www.itu.int/dms_pubrec/itu-r/rec/bt/R-REC-BT.709-6-201506-I!!PDF-E.pdf p. 4
     float luminance = dot(vec3(0.2126, 0.7152, 0.0722), col);
@@ -22,12 +30,18 @@ vec3 reinhard_tonemap(vec3 col){
     return col * (scaled_luminance / luminance);
 }
 
+// size of the textures (render size, smaller than the screen with dynamic resolution)
 uniform float u_textureWidth = 1280;
 uniform float u_textureHeight = 720;
 
 void main(){
-	vec3 color = texture(u_colorTex, texCoords).rgb; // get fragment color
-    float dist = texture(u_distNormalTex, texCoords).a; // get fragment distance (scaled by farplane)
+	vec3 color = sampleUpscaled(u_colorTex, texCoords); // get fragment color
+
+    // add the bloom before tonemapping
+    if(u_bloom){
+        color += texture(u_bloomTex, texCoords).rgb * u_bloomIntensity;
+    }
+    color *= u_exposure;
 
     if(u_hdr){
         color = reinhard_tonemap(color);
@@ -37,47 +51,7 @@ void main(){
         color = pow(color , vec3(1.0 / 2.2));
     }
 
-    // make texture sampling offsets smaller with distance
-    float xOffset = 3.0f / (u_textureWidth + 3.0f * dist * u_textureWidth); 
-    float yOffset = 3.0f / (u_textureHeight + 3.0f * dist * u_textureHeight);
-
-    float[9] xOffsets = float[](-xOffset, 0, xOffset, -xOffset, 0, xOffset, -xOffset, 0, xOffset);
-    float[9] yOffsets = float[](yOffset, yOffset, yOffset, 0, 0, 0, -yOffset, -yOffset, -yOffset);
-
-    // use Sobel operator to detect edges: https://citeseerx.ist.psu.edu/document?repid=rep1&type=pdf&doi=676679e17b9033b8a1eb1c2618cb5bd9e3c4504c
-
-    // vertical sobel kernel
-     const float kernelV[9] = float[](
-        1, 2, 1,
-        0,  0, 0,
-        -1, -2, -1
-    );
-
-    // horizontal sobel kernel
-    const float kernelH[9] = float[](
-        -1, 0, 1,
-        -2,  0, 2,
-        -1, 0, 1
-    );
-
-    vec3 Gx = vec3(0.0);
-    vec3 Gy = vec3(0.0);
-    // apply sobel convolution
-    for(int i = 0; i < 9; i++)
-    {
-        vec3 normal = vec3(texture(u_distNormalTex, texCoords + vec2(xOffsets[i], yOffsets[i])).rgb);
-        Gx += normal * kernelH[i]; // horizontal
-        Gy += normal * kernelV[i]; // vertical
-    }
-    vec3 G = abs(Gx) + abs(Gy); // combine results
-    
-    // assume if one of the channels is >= ~0.6 then there is an edge
-    float edge = 0;
-    if(G.x > 0.6 || G.y > 0.6 || G.z > 0.6){
-        edge = 0;
-    } else {
-        edge = 1;
-    }
+    float edge = toonEdge(u_distNormalTex, texCoords, vec2(u_textureWidth, u_textureHeight));
 
     outColor = vec4(color * edge, 1.0f);
 }
\ No newline at end of file
@@ -0,0 +1,20 @@
+// upscale of the HDR color rendered at a lower resolution (DynamicResolution): bilinear filtering (sampler of
+// PostprocessPipeline) and a sharpening limited to the range of the 4 neighbours, so edges don't get halos
+uniform float u_sharpness = 0.0f; // 0 when the color has the size of the screen
+
+vec3 sampleUpscaled(sampler2D tex, vec2 uv){
+    vec3 color = texture(tex, uv).rgb;
+    if(u_sharpness <= 0.0f){
+        return color;
+    }
+    vec2 texelSize = 1.0f / vec2(textureSize(tex, 0));
+    vec3 n = texture(tex, uv + vec2(0.0f, texelSize.y)).rgb;
+    vec3 e = texture(tex, uv + vec2(texelSize.x, 0.0f)).rgb;
+    vec3 s = texture(tex, uv - vec2(0.0f, texelSize.y)).rgb;
+    vec3 w = texture(tex, uv - vec2(texelSize.x, 0.0f)).rgb;
+    vec3 minColor = min(color, min(min(n, e), min(s, w)));
+    vec3 maxColor = max(color, max(max(n, e), max(s, w)));
+    // unsharp mask: move away from the average of the neighbours
+    vec3 sharpened = color + (color - 0.25f * (n + e + s + w)) * 2.0f * u_sharpness;
+    return clamp(sharpened, minColor, maxColor);
+}
@@ -1,34 +1,51 @@
 #include "App.h"
 
-App::App() {
-    /****************************
-    *		setup GLFW
-    *****************************/
-
-    if (!glfwInit()) {
-        throw std::runtime_error("Error initializing GLFW");
+App::App(unsigned int width, unsigned int height, bool headless, HeadlessContext::Backend context) : m_windowWidth(width), m_windowHeight(height)
+{
+    if (headless) {
+        m_headlessContext = std::make_unique<HeadlessContext>(m_windowWidth, m_windowHeight, context);
+        // core profile context, load all entry points
+        glewExperimental = GL_TRUE;
     }
+    else {
+        /****************************
+        *		setup GLFW
+        *****************************/
 
-    // set GLSL version
-    const char* glsl_version = nullptr;
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        if (!glfwInit()) {
+            throw std::runtime_error("Error initializing GLFW");
+        }
 
-    // create window 
-    m_window = glfwCreateWindow(m_windowWidth, m_windowHeight, "Lighting demo", NULL, NULL);
+        // set GLSL version
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 
-    glfwMakeContextCurrent(m_window);
+        // create window 
+        m_window = glfwCreateWindow(m_windowWidth, m_windowHeight, "Lighting demo", NULL, NULL);
+
+        glfwMakeContextCurrent(m_window);
+    }
 
     /****************************
     *		setup GLEW
     *****************************/
     GLenum err = glewInit();
+    // an EGL context has no GLX display, GLEW checks it after loading the GL entry points
+    if (err == GLEW_ERROR_NO_GLX_DISPLAY && m_headlessContext && m_headlessContext->getBackend() == HeadlessContext::Backend::EGL) {
+        err = GLEW_OK;
+    }
     if (GLEW_OK != err)
     {
         /* Problem: glewInit failed, something is seriously wrong. */
         fprintf(stderr, "Error: %s\n", glewGetErrorString(err));
     }
 
+    // no input and no UI when running headless
+    if (headless) {
+        m_scene = std::make_unique<SceneMenu>(m_scene, m_windowWidth, m_windowHeight);
+        return;
+    }
+
     /***************************
     *  register event callbacks
     ***************************/
@@ -47,9 +64,11 @@ App::App() {
     io.ConfigFlags |= ImGuiConfigFlags_DockingEnable;     // Enable Docking
     io.ConfigFlags |= ImGuiConfigFlags_ViewportsEnable;   // Enable Multi-Viewport / Platform Windows
     ImGui::StyleColorsDark();
+    EventManager::setImGuiIO(&io);
 
     // Setup Platform/Renderer backends
     ImGui_ImplGlfw_InitForOpenGL(m_window, true);
+    const char* glsl_version = nullptr;
     ImGui_ImplOpenGL3_Init(glsl_version);
 
     m_scene = std::make_unique<SceneMenu>(m_scene, m_windowWidth, m_windowHeight);
@@ -101,6 +120,14 @@ void App::run()
 }
 
 App::~App() {
+    // delete the scene while the context is still current
+    m_scene.reset();
+
+    // headless context is destroyed by its own destructor
+    if (m_headlessContext) {
+        return;
+    }
+
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
@@ -109,6 +136,33 @@ App::~App() {
     glfwTerminate();
 }
 
+int App::runBenchmark(const Benchmark::Options& options)
+{
+    m_scene = SceneMenu::createScene(options.scene, m_scene, m_windowWidth, m_windowHeight);
+    if (m_scene == nullptr) {
+        printf("Error: unknown scene '%s'\n", options.scene.c_str());
+        Benchmark::printUsage("Lighting Demo");
+        return 1;
+    }
+
+    Benchmark benchmark(options);
+    benchmark.run(*m_scene, [this]() {
+        if (m_headlessContext) {
+            m_headlessContext->swapBuffers();
+        }
+        else {
+            glfwPollEvents();
+            glfwSwapBuffers(m_window);
+        }
+    });
+
+    if (!benchmark.save()) {
+        return 1;
+    }
+    printf("Benchmark results written to '%s'\n", options.output.c_str());
+    return 0;
+}
+
 
 void App::handleEvent(const Event& e)
 {
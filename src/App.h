@@ -2,6 +2,8 @@
 #include "Scene/Scene.h"
 #include "Scene/SceneMenu.h"
 #include "Event/EventManager.h"
+#include "HeadlessContext.h"
+#include "Benchmark.h"
 #include "imgui.h"
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_opengl3.h"
@@ -21,6 +23,9 @@ private:
 
 	std::unique_ptr<Scene> m_scene;
 
+	// context used instead of the window when running headless
+	std::unique_ptr<HeadlessContext> m_headlessContext;
+
 	/// <summary>
 	/// Handles events (sets window height/width)
 	/// </summary>
@@ -28,8 +33,20 @@ private:
 
 	static void glfw_error_callback(int error, const char* description);
 public:
-	App();
+	/// <summary>
+	/// Create the window (or a headless context), initialize GLEW and ImGui
+	/// </summary>
+	/// <param name="headless">: if true no window is created and ImGui is not initialized</param>
+	/// <param name="context">: backend of the headless context</param>
+	App(unsigned int width = 1280, unsigned int height = 720, bool headless = false,
+		HeadlessContext::Backend context = HeadlessContext::Backend::AUTO);
 	~App();
 	void run();
+
+	/// <summary>
+	/// Render the scene from the options for a fixed number of frames and save the frame times.
+	/// Returns the process exit code.
+	/// </summary>
+	int runBenchmark(const Benchmark::Options& options);
 };
 
@@ -0,0 +1,245 @@
+#include "Benchmark.h"
+#include <chrono>
+#include <fstream>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+	// summary of one column of frame times
+	struct Summary {
+		double mean = 0.0, median = 0.0, p95 = 0.0, p99 = 0.0, min = 0.0, max = 0.0;
+	};
+
+	Summary summarize(std::vector<double> values) {
+		Summary s;
+		if (values.empty()) return s;
+		std::sort(values.begin(), values.end());
+		// nearest-rank percentile
+		auto percentile = [&values](double p) {
+			size_t index = (size_t)std::ceil(p * values.size());
+			return values[std::min(values.size() - 1, index == 0 ? 0 : index - 1)];
+		};
+		for (double v : values) s.mean += v;
+		s.mean /= values.size();
+		s.median = percentile(0.5);
+		s.p95 = percentile(0.95);
+		s.p99 = percentile(0.99);
+		s.min = values.front();
+		s.max = values.back();
+		return s;
+	}
+
+	void writeSummary(std::ostream& out, const char* name, const Summary& s) {
+		out << "    \"" << name << "\": { \"mean\": " << s.mean << ", \"median\": " << s.median
+			<< ", \"p95\": " << s.p95 << ", \"p99\": " << s.p99
+			<< ", \"min\": " << s.min << ", \"max\": " << s.max << " }";
+	}
+}
+
+bool Benchmark::parseArgs(int argc, char** argv, Options& options)
+{
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		// all options except --headless need a value
+		if (arg == "--headless") {
+			options.headless = true;
+			continue;
+		}
+		if (i + 1 >= argc) {
+			printUsage(argv[0]);
+			return false;
+		}
+		std::string value = argv[++i];
+		try {
+			if (arg == "--scene") {
+				options.scene = value;
+				options.enabled = true;
+			}
+			else if (arg == "--size") {
+				// WIDTHxHEIGHT
+				size_t x = value.find('x');
+				if (x == std::string::npos) throw std::invalid_argument(value);
+				options.width = std::stoul(value.substr(0, x));
+				options.height = std::stoul(value.substr(x + 1));
+			}
+			else if (arg == "--warmup") {
+				options.warmupFrames = std::stoul(value);
+			}
+			else if (arg == "--frames") {
+				options.frames = std::stoul(value);
+			}
+			else if (arg == "--output") {
+				options.output = value;
+			}
+			else if (arg == "--context") {
+				if (value == "auto") options.context = HeadlessContext::Backend::AUTO;
+				else if (value == "egl") options.context = HeadlessContext::Backend::EGL;
+				else if (value == "window") options.context = HeadlessContext::Backend::WINDOW;
+				else throw std::invalid_argument(value);
+			}
+			else {
+				printUsage(argv[0]);
+				return false;
+			}
+		}
+		catch (std::exception&) {
+			printf("Invalid value '%s' for %s\n", value.c_str(), arg.c_str());
+			printUsage(argv[0]);
+			return false;
+		}
+	}
+	if (options.headless && !options.enabled) {
+		printf("--headless requires --scene\n");
+		printUsage(argv[0]);
+		return false;
+	}
+	if (options.width == 0 || options.height == 0 || options.frames == 0) {
+		printUsage(argv[0]);
+		return false;
+	}
+	return true;
+}
+
+void Benchmark::printUsage(const char* program)
+{
+	printf("Usage: %s [--scene box|texture|model] [--headless] [--context auto|egl|window] [--size WIDTHxHEIGHT]\n"
+		"          [--warmup N] [--frames N] [--output results.json|results.csv]\n"
+		"Without --scene the interactive application is started.\n", program);
+}
+
+void Benchmark::run(Scene& scene, const std::function<void()>& present)
+{
+	using Clock = std::chrono::steady_clock;
+	auto toMs = [](Clock::duration d) { return std::chrono::duration<double, std::milli>(d).count(); };
+
+	m_renderer = (const char*)glGetString(GL_RENDERER);
+	m_frameTimes.assign(m_options.frames, FrameTime());
+
+	// warm up: shader compilation, texture uploads, first shadow maps
+	for (unsigned int i = 0; i < m_options.warmupFrames; ++i) {
+		scene.onRender();
+		present();
+	}
+	glFinish();
+	// per-pass totals only cover the measured frames
+	PassProfiler& profiler = scene.getProfiler();
+	profiler.reset();
+
+	// two timestamps per frame, results are read after the run so there is no stall between frames
+	// (GL_TIME_ELAPSED can't be used here, the scene already times its passes with it and those queries can't be nested)
+	std::vector<unsigned int> queries(2 * m_options.frames);
+	glGenQueries((GLsizei)queries.size(), queries.data());
+
+	for (unsigned int i = 0; i < m_options.frames; ++i) {
+		Clock::time_point frameStart = Clock::now();
+		glQueryCounter(queries[2 * i], GL_TIMESTAMP);
+		scene.onRender();
+		glQueryCounter(queries[2 * i + 1], GL_TIMESTAMP);
+		Clock::time_point submitEnd = Clock::now();
+		present();
+		m_frameTimes[i].cpu = toMs(submitEnd - frameStart);
+		m_frameTimes[i].frame = toMs(Clock::now() - frameStart);
+	}
+	glFinish();
+
+	for (unsigned int i = 0; i < m_options.frames; ++i) {
+		GLuint64 start = 0, end = 0;
+		glGetQueryObjectui64v(queries[2 * i], GL_QUERY_RESULT, &start);
+		glGetQueryObjectui64v(queries[2 * i + 1], GL_QUERY_RESULT, &end);
+		m_frameTimes[i].gpu = (end - start) / 1e6;
+	}
+	glDeleteQueries((GLsizei)queries.size(), queries.data());
+
+	// collect the pass queries of the last frames (everything finished, so all results are available)
+	for (int i = 0; i < PassProfiler::QUERY_BUFFERS; ++i) {
+		profiler.beginFrame();
+	}
+	m_passTimes.clear();
+	for (const auto& pass : profiler.getPasses()) {
+		PassTime passTime;
+		passTime.name = pass.name;
+		passTime.cpu = pass.cpuSamples > 0 ? pass.cpuTotal / pass.cpuSamples : 0.0;
+		passTime.gpu = pass.gpuSamples > 0 ? pass.gpuTotal / pass.gpuSamples : 0.0;
+		m_passTimes.push_back(passTime);
+	}
+}
+
+bool Benchmark::save() const
+{
+	std::ofstream file(m_options.output);
+	if (!file) {
+		printf("Error: could not open '%s' for writing\n", m_options.output.c_str());
+		return false;
+	}
+	// use CSV if the file ends with .csv, JSON otherwise
+	const std::string& path = m_options.output;
+	bool csv = path.size() >= 4 && path.compare(path.size() - 4, 4, ".csv") == 0;
+	return csv ? saveCSV(file) : saveJSON(file);
+}
+
+bool Benchmark::saveJSON(std::ostream& out) const
+{
+	std::vector<double> cpu, gpu, frame;
+	for (const auto& t : m_frameTimes) {
+		cpu.push_back(t.cpu);
+		gpu.push_back(t.gpu);
+		frame.push_back(t.frame);
+	}
+
+	out << "{\n";
+	out << "  \"scene\": \"" << m_options.scene << "\",\n";
+	out << "  \"renderer\": \"" << m_renderer << "\",\n";
+	out << "  \"width\": " << m_options.width << ",\n";
+	out << "  \"height\": " << m_options.height << ",\n";
+	out << "  \"headless\": " << (m_options.headless ? "true" : "false") << ",\n";
+	out << "  \"warmupFrames\": " << m_options.warmupFrames << ",\n";
+	out << "  \"frames\": " << m_options.frames << ",\n";
+	out << "  \"summaryMs\": {\n";
+	writeSummary(out, "cpu", summarize(cpu));
+	out << ",\n";
+	writeSummary(out, "gpu", summarize(gpu));
+	out << ",\n";
+	writeSummary(out, "frame", summarize(frame));
+	out << "\n  },\n";
+	out << "  \"passesMs\": [\n";
+	for (size_t i = 0; i < m_passTimes.size(); ++i) {
+		out << "    { \"name\": \"" << m_passTimes[i].name << "\", \"cpu\": " << m_passTimes[i].cpu
+			<< ", \"gpu\": " << m_passTimes[i].gpu << " }" << (i + 1 < m_passTimes.size() ? ",\n" : "\n");
+	}
+	out << "  ],\n";
+	out << "  \"frameTimesMs\": [\n";
+	for (size_t i = 0; i < m_frameTimes.size(); ++i) {
+		out << "    { \"cpu\": " << m_frameTimes[i].cpu << ", \"gpu\": " << m_frameTimes[i].gpu
+			<< ", \"frame\": " << m_frameTimes[i].frame << " }" << (i + 1 < m_frameTimes.size() ? ",\n" : "\n");
+	}
+	out << "  ]\n}\n";
+	return (bool)out;
+}
+
+bool Benchmark::saveCSV(std::ostream& out) const
+{
+	std::vector<double> cpu, gpu, frame;
+	for (const auto& t : m_frameTimes) {
+		cpu.push_back(t.cpu);
+		gpu.push_back(t.gpu);
+		frame.push_back(t.frame);
+	}
+
+	// three tables separated by an empty line: frame times, summary, passes
+	out << "frame,cpu_ms,gpu_ms,frame_ms\n";
+	for (size_t i = 0; i < m_frameTimes.size(); ++i) {
+		out << i << "," << m_frameTimes[i].cpu << "," << m_frameTimes[i].gpu << "," << m_frameTimes[i].frame << "\n";
+	}
+	out << "\nmetric,mean_ms,median_ms,p95_ms,p99_ms,min_ms,max_ms\n";
+	const char* names[] = { "cpu", "gpu", "frame" };
+	const std::vector<double>* values[] = { &cpu, &gpu, &frame };
+	for (int i = 0; i < 3; ++i) {
+		Summary s = summarize(*values[i]);
+		out << names[i] << "," << s.mean << "," << s.median << "," << s.p95 << "," << s.p99 << "," << s.min << "," << s.max << "\n";
+	}
+	out << "\npass,cpu_ms,gpu_ms\n";
+	for (const auto& pass : m_passTimes) {
+		out << "\"" << pass.name << "\"," << pass.cpu << "," << pass.gpu << "\n";
+	}
+	return (bool)out;
+}
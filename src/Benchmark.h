@@ -0,0 +1,82 @@
+#pragma once
+#include "GL/glew.h"
+#include "Scene/Scene.h"
+#include "HeadlessContext.h"
+#include <string>
+#include <vector>
+#include <functional>
+
+/// <summary>
+/// Renders a scene for a fixed number of frames and records per-frame CPU/GPU times.
+/// </summary>
+class Benchmark
+{
+public:
+	/// <summary>
+	/// Options read from the command line
+	/// </summary>
+	struct Options {
+		bool enabled = false;     // true if a scene was given (run benchmark instead of the interactive app)
+		bool headless = false;    // render without a visible window
+		HeadlessContext::Backend context = HeadlessContext::Backend::AUTO; // context used when headless
+		std::string scene;        // name of the scene: box | texture | model
+		unsigned int width = 1280;
+		unsigned int height = 720;
+		unsigned int warmupFrames = 30;  // frames rendered before measuring
+		unsigned int frames = 300;       // measured frames
+		std::string output = "benchmark.json"; // .json or .csv
+	};
+
+	/// <summary>
+	/// Times of one measured frame in milliseconds
+	/// </summary>
+	struct FrameTime {
+		double cpu = 0.0;   // time spent in Scene::onRender (command submission)
+		double gpu = 0.0;   // GPU time of the frame (GL_TIMESTAMP queries at the start and end of the frame)
+		double frame = 0.0; // wall time of the whole frame, including present
+	};
+
+	/// <summary>
+	/// Average times of one render pass over the measured frames in milliseconds
+	/// </summary>
+	struct PassTime {
+		std::string name;
+		double cpu = 0.0;
+		double gpu = 0.0;
+	};
+
+	/// <summary>
+	/// Parse command line arguments. Returns false (and prints usage) if the arguments are invalid.
+	/// </summary>
+	static bool parseArgs(int argc, char** argv, Options& options);
+
+	/// <summary>
+	/// Print the command line usage
+	/// </summary>
+	static void printUsage(const char* program);
+
+	Benchmark(const Options& options) : m_options(options) {}
+
+	/// <summary>
+	/// Render warm-up frames then measured frames.
+	/// </summary>
+	/// <param name="scene">: scene to render</param>
+	/// <param name="present">: called after every frame (swap buffers / poll events)</param>
+	void run(Scene& scene, const std::function<void()>& present);
+
+	/// <summary>
+	/// Write results to the output file (JSON or CSV based on the extension). Returns false on failure.
+	/// </summary>
+	bool save() const;
+
+	const std::vector<FrameTime>& getFrameTimes() const { return m_frameTimes; }
+	const std::vector<PassTime>& getPassTimes() const { return m_passTimes; }
+private:
+	Options m_options;
+	std::vector<FrameTime> m_frameTimes;
+	std::vector<PassTime> m_passTimes;
+	std::string m_renderer;
+
+	bool saveJSON(std::ostream& out) const;
+	bool saveCSV(std::ostream& out) const;
+};
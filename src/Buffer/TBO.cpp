@@ -0,0 +1,36 @@
+#include "TBO.h"
+
+TBO::~TBO()
+{
+	glDeleteTextures(1, &m_textureId);
+	glDeleteBuffers(1, &m_id);
+}
+
+void TBO::create()
+{
+	// create only if not already created
+	if (m_id != 0) {
+		return;
+	}
+	glGenBuffers(1, &m_id);
+	glGenTextures(1, &m_textureId);
+	// the texture keeps referencing the buffer when its storage is reallocated
+	glBindBuffer(GL_TEXTURE_BUFFER, m_id);
+	glBindTexture(GL_TEXTURE_BUFFER, m_textureId);
+	glTexBuffer(GL_TEXTURE_BUFFER, m_format, m_id);
+}
+
+void TBO::bufferData(const void* data, unsigned int size)
+{
+	create(); // create if not already
+	glBindBuffer(GL_TEXTURE_BUFFER, m_id);
+	// orphan the old storage, the GPU may still read it for the previous frame
+	glBufferData(GL_TEXTURE_BUFFER, size, nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_TEXTURE_BUFFER, 0, size, data);
+}
+
+void TBO::bind(unsigned int slot) const
+{
+	glActiveTexture(GL_TEXTURE0 + slot);
+	glBindTexture(GL_TEXTURE_BUFFER, m_textureId);
+}
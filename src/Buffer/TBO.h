@@ -0,0 +1,28 @@
+#pragma once
+#include "GL/glew.h"
+
+/// <summary>
+/// Texture buffer: a buffer object read in shaders with texelFetch through a samplerBuffer
+/// </summary>
+class TBO
+{
+private:
+	unsigned int m_id = 0;        // buffer
+	unsigned int m_textureId = 0; // buffer texture
+	// format of the texels (e.g. GL_RGBA32F, GL_R32UI)
+	unsigned int m_format;
+public:
+	TBO(unsigned int format = GL_RGBA32F) : m_format(format) {}
+	~TBO();
+	TBO(const TBO& o) = delete;
+	TBO& operator=(const TBO& o) = delete;
+
+	// create buffer and texture and assign ids
+	void create();
+
+	// allocate new storage and load data, usage is GL_STREAM_DRAW (contents are replaced every frame)
+	void bufferData(const void* data, unsigned int size);
+
+	// bind the buffer texture to a texture slot
+	void bind(unsigned int slot) const;
+};
@@ -0,0 +1,62 @@
+#include "UBO.h"
+
+unsigned int UBO::s_currentBoundUBO = 0;
+
+UBO::UBO(void* data, unsigned int size)
+{
+	glGenBuffers(1, &m_id); // generate new UBO
+	bind();					// bind this UBO
+	bufferData(data, size); // allocate and buffer data
+}
+
+UBO::~UBO()
+{
+	if (m_id == s_currentBoundUBO) {
+		s_currentBoundUBO = 0;
+	}
+	glDeleteBuffers(1, &m_id);
+}
+
+void UBO::create()
+{
+	// create only if not already created
+	if (m_id == 0) {
+		glGenBuffers(1, &m_id);
+	}
+}
+
+void UBO::bufferData(void* data, unsigned int size)
+{
+	create(); // create if not already
+	bind(); // bind this UBO
+	glBufferData(GL_UNIFORM_BUFFER, size, data, GL_DYNAMIC_DRAW); // contents are updated often
+}
+
+void UBO::bufferSubData(unsigned int offset, void* data, unsigned int size)
+{
+	bind();
+	glBufferSubData(GL_UNIFORM_BUFFER, offset, size, data);
+}
+
+void UBO::bindBase(unsigned int binding) const
+{
+	// glBindBufferBase also binds the buffer to the generic GL_UNIFORM_BUFFER target
+	glBindBufferBase(GL_UNIFORM_BUFFER, binding, m_id);
+	s_currentBoundUBO = m_id;
+}
+
+void UBO::bind() const
+{
+	if (m_id != s_currentBoundUBO) {
+		glBindBuffer(GL_UNIFORM_BUFFER, m_id);
+		s_currentBoundUBO = m_id;
+	}
+}
+
+void UBO::unbind() const
+{
+	if (s_currentBoundUBO != 0) {
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		s_currentBoundUBO = 0;
+	}
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include "GL/glew.h"
+
+class UBO
+{
+private:
+	unsigned int m_id = 0;
+	static unsigned int s_currentBoundUBO; // id of currently bound UBO, 0 if not bound
+public:
+	UBO() = default;
+	UBO(void* data, unsigned int size);
+	~UBO();
+	UBO(const UBO& o) = delete;
+	UBO& operator=(const UBO& o) = delete;
+
+	// create UBO and assign id
+	void create();
+
+	// allocate storage and load data (data can be nullptr), usage is GL_DYNAMIC_DRAW
+	void bufferData(void* data, unsigned int size);
+
+	// update a part of the buffer (storage must be allocated with bufferData)
+	void bufferSubData(unsigned int offset, void* data, unsigned int size);
+
+	// bind the whole buffer to a uniform block binding point
+	void bindBase(unsigned int binding) const;
+
+	// bind this UBO if not bound already
+	void bind() const;
+
+	// unbind (bind 0)
+	void unbind() const;
+};
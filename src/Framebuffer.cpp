@@ -1,20 +1,29 @@
 #include "Framebuffer.h"
 
-void Framebuffer::addColorAttachament(unsigned int type, unsigned int internalFormat)
+void Framebuffer::addColorAttachament(unsigned int type, unsigned int internalFormat, bool mipmaps)
 {
 	Attachment colorAttachment;
 	colorAttachment.type = type;
 	if (type == GL_TEXTURE_2D) {
+		colorAttachment.mipmaps = mipmaps;
 		// create and bind texture id
 		glGenTextures(1, &colorAttachment.id);
 		glActiveTexture(GL_TEXTURE0);
 		glBindTexture(GL_TEXTURE_2D, colorAttachment.id);
 		// create texture and parameters
 		glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, m_width, m_height, 0, GL_RGBA, GL_FLOAT, 0);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+		if (mipmaps) {
+			// allocate the other levels, trilinear filtering
+			glGenerateMipmap(GL_TEXTURE_2D);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		}
+		else {
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		}
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 		// unbind
 		glBindTexture(GL_TEXTURE_2D, 0);
 	}
@@ -119,7 +128,35 @@ void Framebuffer::create()
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
+Framebuffer::Framebuffer(Framebuffer&& o) noexcept
+{
+	*this = std::move(o);
+}
+
+Framebuffer& Framebuffer::operator=(Framebuffer&& o) noexcept
+{
+	if (this == &o) return *this;
+	release();
+	m_id = o.m_id;
+	m_width = o.m_width;
+	m_height = o.m_height;
+	m_created = o.m_created;
+	m_colorAttachments = std::move(o.m_colorAttachments);
+	m_depthAttachments = std::move(o.m_depthAttachments);
+	// o no longer owns anything
+	o.m_id = 0;
+	o.m_created = false;
+	o.m_colorAttachments.clear();
+	o.m_depthAttachments.clear();
+	return *this;
+}
+
 Framebuffer::~Framebuffer()
+{
+	release();
+}
+
+void Framebuffer::release()
 {
 	// delete color attachments
 	for (auto& colorAttachment : m_colorAttachments) {
@@ -141,6 +178,19 @@ Framebuffer::~Framebuffer()
 		}
 	}
 	glDeleteFramebuffers(1, &m_id);
+	m_id = 0;
+	m_created = false;
+	m_colorAttachments.clear();
+	m_depthAttachments.clear();
+}
+
+void Framebuffer::generateMipmaps(int slot) const
+{
+	if (!m_colorAttachments[slot].mipmaps) return;
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, m_colorAttachments[slot].id);
+	glGenerateMipmap(GL_TEXTURE_2D);
+	glBindTexture(GL_TEXTURE_2D, 0);
 }
 
 void Framebuffer::activateDepthAttachment(int slot, unsigned int target)
@@ -151,8 +201,13 @@ void Framebuffer::activateDepthAttachment(int slot, unsigned int target)
 		// activate slot and bind this texture
 		glActiveTexture(GL_TEXTURE0);
 		glBindTexture(m_depthAttachments[slot].type, m_depthAttachments[slot].id);
-		// link texture to fbo
-		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, target, m_depthAttachments[slot].id, 0);
+		// link texture to fbo (all faces of a cube map are attached as layers)
+		if (target == GL_TEXTURE_CUBE_MAP) {
+			glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_depthAttachments[slot].id, 0);
+		}
+		else {
+			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, target, m_depthAttachments[slot].id, 0);
+		}
 		glBindTexture(m_depthAttachments[slot].type, 0);
 	}
 	else {
@@ -15,6 +15,8 @@ public:
 	struct Attachment{
 		unsigned int type = GL_RENDERBUFFER;
 		unsigned int id = 0;
+		// texture with a full mip chain (see generateMipmaps)
+		bool mipmaps = false;
 	};
 
 private:
@@ -27,16 +29,27 @@ private:
 
 	std::vector<Attachment> m_colorAttachments;
 	std::vector<Attachment> m_depthAttachments;
+
+	// delete the framebuffer and its attachments
+	void release();
 public:
 	Framebuffer() = default;
 	Framebuffer(unsigned int width, unsigned int height) : m_width(width), m_height(height) {}
+	Framebuffer(const Framebuffer& o) = delete;
+	Framebuffer(Framebuffer&& o) noexcept;
+	/// <summary>
+	/// Take the framebuffer and attachments of o, the old ones are deleted (resizing with fbo = Framebuffer(w, h))
+	/// </summary>
+	Framebuffer& operator=(Framebuffer&& o) noexcept;
 	
 	/// <summary>
 	/// Add a color attachment texture/renderbuffer. Multiple can be added
 	/// </summary>
 	/// <param name="type">: GL_RENDERBUFFER or GL_TEXTURE_2D</param>
 	/// <param name="internalFormat">: default is GL_RGB</param>
-	void addColorAttachament(unsigned int type = GL_RENDERBUFFER, unsigned int internalFormat = GL_RGB);
+	/// <param name="mipmaps">: GL_TEXTURE_2D only, allocate all mip levels and filter with GL_LINEAR_MIPMAP_LINEAR
+	/// (the levels are filled with generateMipmaps)</param>
+	void addColorAttachament(unsigned int type = GL_RENDERBUFFER, unsigned int internalFormat = GL_RGB, bool mipmaps = false);
 	
 	/// <summary>
 	/// Add a depth attachment texture/renderbuffer
@@ -52,12 +65,18 @@ public:
 
 	inline void bind() const { glBindFramebuffer(GL_FRAMEBUFFER, m_id); }
 	inline void unbind() const { glBindFramebuffer(GL_FRAMEBUFFER, 0); }
+	unsigned int getId() const { return m_id; }
 	~Framebuffer();
 
 	/// <summary>
 	/// Get the id of the colorAttachment
 	/// </summary>
 	unsigned int getColorAttachment(int slot) const { return m_colorAttachments[slot].id; }
+
+	/// <summary>
+	/// Compute the mip levels of a color attachment added with mipmaps from its first level
+	/// </summary>
+	void generateMipmaps(int slot) const;
 	
 	/// <summary>
 	/// Get the id of the depthAttachment
@@ -67,7 +86,8 @@ public:
 	/// <summary>
 	/// Link the depthAttachment at position "slot" to the framebuffer
 	/// </summary>
-	/// <param name="target">: texture target, GL_TEXTURE_2D or GL_TEXTURE_CUBE_MAP_direction</param>
+	/// <param name="target">: texture target, GL_TEXTURE_2D or GL_TEXTURE_CUBE_MAP_direction,
+	/// GL_TEXTURE_CUBE_MAP attaches all faces (layered, the face is selected with gl_Layer)</param>
 	void activateDepthAttachment(int slot, unsigned int target = GL_TEXTURE_2D);
 
 	/// <summary>
@@ -0,0 +1,65 @@
+#include "GBuffer.h"
+#include <algorithm>
+
+void GBuffer::bindShader(Shader& shader)
+{
+	shader.setInt("u_gAlbedo", ALBEDO_SLOT);
+	shader.setInt("u_gNormal", NORMAL_SLOT);
+	shader.setInt("u_gF0", F0_SLOT);
+	shader.setInt("u_gDepth", DEPTH_SLOT);
+}
+
+void GBuffer::resize(unsigned int width, unsigned int height)
+{
+	m_fbo = Framebuffer(width, height);
+	// albedo + material id / 255
+	m_fbo.addColorAttachament(GL_TEXTURE_2D, GL_RGBA8);
+	// octahedral normal + roughness + metallic
+	m_fbo.addColorAttachament(GL_TEXTURE_2D, GL_RGBA16F);
+	// f0 (the specular coefficients of Phong can be above 1)
+	m_fbo.addColorAttachament(GL_TEXTURE_2D, GL_RGBA16F);
+	m_fbo.addDepthAttachment(GL_TEXTURE_2D, GL_DEPTH_COMPONENT24);
+	m_fbo.create();
+}
+
+void GBuffer::begin()
+{
+	m_fbo.bind();
+	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	m_materialCount = 0;
+}
+
+void GBuffer::setMaterial(Shader& gBufferShader, const Material& material, int id)
+{
+	if (id <= UNLIT_MATERIAL || id >= MAX_MATERIALS) {
+		printf("ERROR material id %d out of range\n", id);
+		return;
+	}
+	gBufferShader.setInt("u_materialId", id);
+	Material::DeferredData data;
+	material.getDeferredData(data);
+	gBufferShader.setVec3("u_surface.albedo", data.albedo);
+	gBufferShader.setFloat("u_surface.roughness", data.roughness);
+	gBufferShader.setVec3("u_surface.f0", data.f0);
+	gBufferShader.setFloat("u_surface.metallic", data.metallic);
+	std::copy(data.parameters, data.parameters + Material::DEFERRED_PARAMETERS, m_materialTable.begin() + id * Material::DEFERRED_PARAMETERS);
+	m_materialCount = std::max(m_materialCount, id + 1);
+}
+
+void GBuffer::setUniforms(Shader& shader, const glm::mat4& viewProjMatrix) const
+{
+	shader.setMat4("u_inverseViewProjMatrix", glm::inverse(viewProjMatrix));
+	// only the ids used this frame
+	if (m_materialCount > 0) {
+		shader.setVec4Array("u_materialTable", m_materialCount * Material::DEFERRED_PARAMETERS, m_materialTable.data());
+	}
+	glActiveTexture(GL_TEXTURE0 + ALBEDO_SLOT);
+	glBindTexture(GL_TEXTURE_2D, m_fbo.getColorAttachment(0));
+	glActiveTexture(GL_TEXTURE0 + NORMAL_SLOT);
+	glBindTexture(GL_TEXTURE_2D, m_fbo.getColorAttachment(1));
+	glActiveTexture(GL_TEXTURE0 + F0_SLOT);
+	glBindTexture(GL_TEXTURE_2D, m_fbo.getColorAttachment(2));
+	glActiveTexture(GL_TEXTURE0 + DEPTH_SLOT);
+	glBindTexture(GL_TEXTURE_2D, m_fbo.getDepthAttachment(0));
+}
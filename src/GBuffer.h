@@ -0,0 +1,72 @@
+#pragma once
+#include "Shader.h"
+#include "Framebuffer.h"
+#include "Materials/Material.h"
+#include <vector>
+
+/// <summary>
+/// G-buffer of the deferred renderer (shaders/gbuffer.partial.glsl): the scene is drawn once with gbuffer.frag,
+/// which stores the surface of every pixel in the same layout for all lighting models (albedo + material id,
+/// octahedral normal + roughness + metallic, f0, depth). The lighting shaders with the DEFERRED keyword then
+/// shade every pixel once in a full screen pass, the parameters of the lighting model of each material id are
+/// read from a small uniform table (Material::getDeferredData).
+/// </summary>
+class GBuffer
+{
+public:
+	// material ids per frame, must be the same as MAX_MATERIALS in shaders
+	static const int MAX_MATERIALS = 32;
+	// material id of the unlit surfaces (the albedo is the output color)
+	static const int UNLIT_MATERIAL = 0;
+
+	// texture slots of the G-buffer, the lighting pass binds no mesh textures
+	static const unsigned int ALBEDO_SLOT = 0;
+	static const unsigned int NORMAL_SLOT = 1;
+	static const unsigned int F0_SLOT = 2;
+	static const unsigned int DEPTH_SLOT = 3;
+private:
+	Framebuffer m_fbo;
+	// parameters of the materials in the order of their ids
+	std::vector<glm::vec4> m_materialTable = std::vector<glm::vec4>(MAX_MATERIALS * Material::DEFERRED_PARAMETERS, glm::vec4(0.0f));
+	// highest material id used this frame + 1
+	int m_materialCount = 0;
+public:
+	GBuffer() = default;
+	GBuffer(const GBuffer& o) = delete;
+	GBuffer& operator=(const GBuffer& o) = delete;
+
+	/// <summary>
+	/// Set the samplers of the G-buffer (call once per lighting shader)
+	/// </summary>
+	static void bindShader(Shader& shader);
+
+	/// <summary>
+	/// Recreate the framebuffer for a new screen size
+	/// </summary>
+	void resize(unsigned int width, unsigned int height);
+
+	/// <summary>
+	/// Bind and clear the G-buffer and reset the material table.
+	/// Then draw the scene with gbuffer.frag, calling setMaterial before every object.
+	/// </summary>
+	void begin();
+
+	/// <summary>
+	/// Set the surface uniforms of a material in the G-buffer shader and store its parameters under an id
+	/// (1..MAX_MATERIALS-1, ids can be shared by objects with the same material)
+	/// </summary>
+	void setMaterial(Shader& gBufferShader, const Material& material, int id);
+
+	/// <summary>
+	/// Draw the next objects unlit, their emission (u_emission) is the output color
+	/// </summary>
+	void setUnlit(Shader& gBufferShader) const { gBufferShader.setInt("u_materialId", UNLIT_MATERIAL); }
+
+	unsigned int getDepthTexture() const { return m_fbo.getDepthAttachment(0); }
+
+	/// <summary>
+	/// Bind the G-buffer and upload the material table and the matrix to reconstruct the positions to a lighting shader
+	/// (with the DEFERRED keyword)
+	/// </summary>
+	void setUniforms(Shader& shader, const glm::mat4& viewProjMatrix) const;
+};
@@ -0,0 +1,266 @@
+#include "HeadlessContext.h"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+namespace egl {
+	// the few declarations of EGL 1.5 that are used, the library is loaded at runtime
+	typedef int32_t Int;
+	typedef unsigned int Boolean;
+	typedef unsigned int Enum;
+	typedef intptr_t Attrib;
+	typedef void* Display;
+	typedef void* Config;
+	typedef void* Surface;
+	typedef void* Context;
+
+#ifdef _WIN32
+#define EGL_CALL __stdcall
+#else
+#define EGL_CALL
+#endif
+	typedef Display (EGL_CALL* GetPlatformDisplayProc)(Enum platform, void* nativeDisplay, const Attrib* attributes);
+	typedef Display (EGL_CALL* GetPlatformDisplayEXTProc)(Enum platform, void* nativeDisplay, const Int* attributes);
+	typedef Boolean (EGL_CALL* InitializeProc)(Display display, Int* major, Int* minor);
+	typedef Boolean (EGL_CALL* ChooseConfigProc)(Display display, const Int* attributes, Config* configs, Int size, Int* count);
+	typedef Surface (EGL_CALL* CreatePbufferSurfaceProc)(Display display, Config config, const Int* attributes);
+	typedef Boolean (EGL_CALL* BindAPIProc)(Enum api);
+	typedef Context (EGL_CALL* CreateContextProc)(Display display, Config config, Context share, const Int* attributes);
+	typedef Boolean (EGL_CALL* MakeCurrentProc)(Display display, Surface draw, Surface read, Context context);
+	typedef Boolean (EGL_CALL* SwapBuffersProc)(Display display, Surface surface);
+	typedef Boolean (EGL_CALL* DestroySurfaceProc)(Display display, Surface surface);
+	typedef Boolean (EGL_CALL* DestroyContextProc)(Display display, Context context);
+	typedef Boolean (EGL_CALL* TerminateProc)(Display display);
+	typedef void* (EGL_CALL* GetProcAddressProc)(const char* name);
+#undef EGL_CALL
+
+	const Int NONE = 0x3038;
+	const Int SURFACE_TYPE = 0x3033;
+	const Int PBUFFER_BIT = 0x0001;
+	const Int RENDERABLE_TYPE = 0x3040;
+	const Int OPENGL_BIT = 0x0008;
+	const Int RED_SIZE = 0x3024;
+	const Int GREEN_SIZE = 0x3023;
+	const Int BLUE_SIZE = 0x3022;
+	const Int DEPTH_SIZE = 0x3025;
+	const Int WIDTH = 0x3057;
+	const Int HEIGHT = 0x3056;
+	const Int CONTEXT_MAJOR_VERSION = 0x3098;
+	const Int CONTEXT_MINOR_VERSION = 0x30FB;
+	const Int CONTEXT_OPENGL_PROFILE_MASK = 0x30FD;
+	const Int CONTEXT_OPENGL_CORE_PROFILE_BIT = 0x0001;
+	const Enum OPENGL_API = 0x30A2;
+	const Enum PLATFORM_SURFACELESS_MESA = 0x31DD;
+}
+
+struct HeadlessContext::EGL {
+	void* library = nullptr;
+	egl::Display display = nullptr;
+	egl::Surface surface = nullptr;
+	egl::Context context = nullptr;
+
+	egl::GetPlatformDisplayProc getPlatformDisplay = nullptr;
+	egl::GetPlatformDisplayEXTProc getPlatformDisplayEXT = nullptr;
+	egl::InitializeProc initialize = nullptr;
+	egl::ChooseConfigProc chooseConfig = nullptr;
+	egl::CreatePbufferSurfaceProc createPbufferSurface = nullptr;
+	egl::BindAPIProc bindAPI = nullptr;
+	egl::CreateContextProc createContext = nullptr;
+	egl::MakeCurrentProc makeCurrent = nullptr;
+	egl::SwapBuffersProc swapBuffers = nullptr;
+	egl::DestroySurfaceProc destroySurface = nullptr;
+	egl::DestroyContextProc destroyContext = nullptr;
+	egl::TerminateProc terminate = nullptr;
+	egl::GetProcAddressProc getProcAddress = nullptr;
+
+	// open libEGL, returns false if it is not installed
+	bool open() {
+#ifdef _WIN32
+		library = (void*)LoadLibraryA("libEGL.dll");
+#else
+		library = dlopen("libEGL.so.1", RTLD_NOW | RTLD_LOCAL);
+#endif
+		return library != nullptr;
+	}
+
+	void close() {
+		if (library == nullptr) return;
+#ifdef _WIN32
+		FreeLibrary((HMODULE)library);
+#else
+		dlclose(library);
+#endif
+		library = nullptr;
+	}
+
+	template <typename T>
+	bool load(T& function, const char* name) {
+#ifdef _WIN32
+		function = (T)GetProcAddress((HMODULE)library, name);
+#else
+		function = (T)dlsym(library, name);
+#endif
+		return function != nullptr;
+	}
+};
+
+HeadlessContext::HeadlessContext(unsigned int width, unsigned int height, Backend backend) : m_width(width), m_height(height)
+{
+	if (backend != Backend::WINDOW) {
+		std::string error;
+		if (createEGL(error)) {
+			m_backend = Backend::EGL;
+			return;
+		}
+		destroyEGL();
+		if (backend == Backend::EGL) {
+			throw std::runtime_error("Error creating surfaceless EGL context: " + error);
+		}
+		printf("Surfaceless EGL not available (%s), using a hidden window\n", error.c_str());
+	}
+	createWindow();
+	m_backend = Backend::WINDOW;
+}
+
+bool HeadlessContext::createEGL(std::string& error)
+{
+	m_egl = std::make_unique<EGL>();
+	EGL& egl = *m_egl;
+	if (!egl.open()) {
+		error = "libEGL not found";
+		return false;
+	}
+	bool loaded = egl.load(egl.initialize, "eglInitialize") && egl.load(egl.chooseConfig, "eglChooseConfig")
+		&& egl.load(egl.createPbufferSurface, "eglCreatePbufferSurface") && egl.load(egl.bindAPI, "eglBindAPI")
+		&& egl.load(egl.createContext, "eglCreateContext") && egl.load(egl.makeCurrent, "eglMakeCurrent")
+		&& egl.load(egl.swapBuffers, "eglSwapBuffers") && egl.load(egl.destroySurface, "eglDestroySurface")
+		&& egl.load(egl.destroyContext, "eglDestroyContext") && egl.load(egl.terminate, "eglTerminate")
+		&& egl.load(egl.getProcAddress, "eglGetProcAddress");
+	if (!loaded) {
+		error = "libEGL is missing EGL 1.4 functions";
+		return false;
+	}
+
+	// surfaceless platform does not need a display server (Mesa), EGL 1.5 or EGL_EXT_platform_base
+	if (egl.load(egl.getPlatformDisplay, "eglGetPlatformDisplay")) {
+		egl.display = egl.getPlatformDisplay(egl::PLATFORM_SURFACELESS_MESA, nullptr, nullptr);
+	}
+	else {
+		egl.getPlatformDisplayEXT = (egl::GetPlatformDisplayEXTProc)egl.getProcAddress("eglGetPlatformDisplayEXT");
+		if (egl.getPlatformDisplayEXT != nullptr) {
+			egl.display = egl.getPlatformDisplayEXT(egl::PLATFORM_SURFACELESS_MESA, nullptr, nullptr);
+		}
+	}
+	if (egl.display == nullptr || !egl.initialize(egl.display, nullptr, nullptr)) {
+		error = "no surfaceless display";
+		egl.display = nullptr;
+		return false;
+	}
+
+	const egl::Int configAttributes[] = {
+		egl::SURFACE_TYPE, egl::PBUFFER_BIT,
+		egl::RENDERABLE_TYPE, egl::OPENGL_BIT,
+		egl::RED_SIZE, 8,
+		egl::GREEN_SIZE, 8,
+		egl::BLUE_SIZE, 8,
+		egl::DEPTH_SIZE, 24,
+		egl::NONE
+	};
+	egl::Config config = nullptr;
+	egl::Int numConfigs = 0;
+	if (!egl.chooseConfig(egl.display, configAttributes, &config, 1, &numConfigs) || numConfigs == 0) {
+		error = "no OpenGL pbuffer config";
+		return false;
+	}
+
+	// pbuffer acts as the default framebuffer (scenes render their final pass to framebuffer 0)
+	const egl::Int pbufferAttributes[] = {
+		egl::WIDTH, (egl::Int)m_width,
+		egl::HEIGHT, (egl::Int)m_height,
+		egl::NONE
+	};
+	egl.surface = egl.createPbufferSurface(egl.display, config, pbufferAttributes);
+
+	const egl::Int contextAttributes[] = {
+		egl::CONTEXT_MAJOR_VERSION, 3,
+		egl::CONTEXT_MINOR_VERSION, 3,
+		egl::CONTEXT_OPENGL_PROFILE_MASK, egl::CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		egl::NONE
+	};
+	if (!egl.bindAPI(egl::OPENGL_API)) {
+		error = "desktop OpenGL not supported";
+		return false;
+	}
+	egl.context = egl.createContext(egl.display, config, nullptr, contextAttributes);
+	if (egl.surface == nullptr || egl.context == nullptr || !egl.makeCurrent(egl.display, egl.surface, egl.surface, egl.context)) {
+		error = "no OpenGL 3.3 core context";
+		return false;
+	}
+
+	// the GL library of the application must dispatch to the EGL context (GLVND, or the GL library of the EGL vendor)
+	if (glGetString(GL_VERSION) == nullptr) {
+		error = "the linked OpenGL library does not reach the EGL context";
+		return false;
+	}
+	return true;
+}
+
+void HeadlessContext::destroyEGL()
+{
+	if (!m_egl) return;
+	EGL& egl = *m_egl;
+	if (egl.display != nullptr) {
+		egl.makeCurrent(egl.display, nullptr, nullptr, nullptr);
+		if (egl.context != nullptr) egl.destroyContext(egl.display, egl.context);
+		if (egl.surface != nullptr) egl.destroySurface(egl.display, egl.surface);
+		egl.terminate(egl.display);
+	}
+	egl.close();
+	m_egl.reset();
+}
+
+void HeadlessContext::createWindow()
+{
+	if (!glfwInit()) {
+		throw std::runtime_error("Error initializing GLFW");
+	}
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE); // never show the window
+
+	m_window = glfwCreateWindow(m_width, m_height, "Lighting demo (headless)", NULL, NULL);
+	if (m_window == nullptr) {
+		glfwTerminate();
+		throw std::runtime_error("Error creating hidden GLFW window");
+	}
+	glfwMakeContextCurrent(m_window);
+	glfwSwapInterval(0); // do not wait for vsync when benchmarking
+}
+
+HeadlessContext::~HeadlessContext()
+{
+	if (m_backend == Backend::EGL) {
+		destroyEGL();
+	}
+	else {
+		glfwDestroyWindow(m_window);
+		glfwTerminate();
+	}
+}
+
+void HeadlessContext::swapBuffers()
+{
+	if (m_backend == Backend::EGL) {
+		m_egl->swapBuffers(m_egl->display, m_egl->surface);
+	}
+	else {
+		glfwSwapBuffers(m_window);
+	}
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include "GL/glew.h"
+#include <GLFW/glfw3.h>
+#include <stdexcept>
+#include <memory>
+#include <string>
+
+/// <summary>
+/// OpenGL context without a visible window, used for benchmarking on machines with no display.
+/// EGL is loaded at runtime (libEGL), so every build can use a surfaceless EGL display with a pbuffer as the default
+/// framebuffer (EGL_MESA_platform_surfaceless, e.g. Mesa llvmpipe on a render node). The GL functions are still called
+/// through the GL library the application links (GLVND dispatches them to the EGL context), so the EGL context is only
+/// kept if GL answers through it. Otherwise an invisible GLFW window is created, which needs a display.
+/// </summary>
+class HeadlessContext
+{
+public:
+	enum class Backend {
+		AUTO,   // EGL if it works, else the hidden window
+		EGL,    // surfaceless EGL only
+		WINDOW  // hidden GLFW window only
+	};
+private:
+	unsigned int m_width = 0;
+	unsigned int m_height = 0;
+	// backend of the context (EGL or WINDOW)
+	Backend m_backend = Backend::WINDOW;
+
+	// used only if EGL is not available
+	GLFWwindow* m_window = nullptr;
+
+	// functions loaded from libEGL, display, surface and context (defined in the .cpp, no EGL headers needed)
+	struct EGL;
+	std::unique_ptr<EGL> m_egl;
+
+	// create the surfaceless EGL context, returns false (with the reason) if it can't be used
+	bool createEGL(std::string& error);
+	void destroyEGL();
+	void createWindow();
+public:
+	/// <summary>
+	/// Create an OpenGL 3.3 core context and make it current. Throws if no context can be created.
+	/// </summary>
+	/// <param name="width">: width of the default framebuffer</param>
+	/// <param name="height">: height of the default framebuffer</param>
+	HeadlessContext(unsigned int width, unsigned int height, Backend backend = Backend::AUTO);
+	~HeadlessContext();
+
+	// delete copy constructor and assignment operator
+	HeadlessContext(const HeadlessContext& o) = delete;
+	HeadlessContext& operator=(const HeadlessContext& o) = delete;
+
+	/// <summary>
+	/// Backend of the context: EGL or WINDOW
+	/// </summary>
+	Backend getBackend() const { return m_backend; }
+
+	/// <summary>
+	/// Present the default framebuffer (nothing is shown, but the frame is submitted)
+	/// </summary>
+	void swapBuffers();
+};
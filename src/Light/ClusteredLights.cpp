@@ -0,0 +1,323 @@
+#include "ClusteredLights.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <xmmintrin.h>
+#define CLUSTERS_USE_SSE 1
+#endif
+
+const float ClusteredLights::NEAR_DEPTH = 0.1f;
+const float ClusteredLights::FAR_DEPTH = 100.0f;
+const float ClusteredLights::RANGE_THRESHOLD = 0.01f;
+
+namespace {
+	// bit i is set if sphere i of the 4 spheres starting at x, y, z, radius overlaps the box
+	int overlapSpheres4(const float* x, const float* y, const float* z, const float* radius, const glm::vec3& min, const glm::vec3& max)
+	{
+#ifdef CLUSTERS_USE_SSE
+		const __m128 zero = _mm_setzero_ps();
+		// distance from the center to the box on each axis (0 inside)
+		auto axisDistance = [&zero](__m128 center, float min, float max) {
+			__m128 below = _mm_max_ps(_mm_sub_ps(_mm_set1_ps(min), center), zero);
+			__m128 above = _mm_max_ps(_mm_sub_ps(center, _mm_set1_ps(max)), zero);
+			return _mm_add_ps(below, above);
+		};
+		__m128 dx = axisDistance(_mm_loadu_ps(x), min.x, max.x);
+		__m128 dy = axisDistance(_mm_loadu_ps(y), min.y, max.y);
+		__m128 dz = axisDistance(_mm_loadu_ps(z), min.z, max.z);
+		__m128 r = _mm_loadu_ps(radius);
+		__m128 dist2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+		return _mm_movemask_ps(_mm_cmple_ps(dist2, _mm_mul_ps(r, r)));
+#else
+		int mask = 0;
+		for (int i = 0; i < 4; ++i) {
+			glm::vec3 center(x[i], y[i], z[i]);
+			glm::vec3 d = glm::max(min - center, 0.0f) + glm::max(center - max, 0.0f);
+			if (glm::dot(d, d) <= radius[i] * radius[i]) {
+				mask |= 1 << i;
+			}
+		}
+		return mask;
+#endif
+	}
+}
+
+ClusteredLights::ClusteredLights()
+{
+	// no lights in any cluster
+	m_items.assign(2 * NUM_CLUSTERS, 0);
+}
+
+ClusteredLights::~ClusteredLights()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_workMutex);
+		m_stopWorkers = true;
+	}
+	m_workStart.notify_all();
+	for (auto& worker : m_workers) {
+		worker.join();
+	}
+}
+
+void ClusteredLights::workerLoop(int worker)
+{
+	unsigned int frame = 0;
+	while (true) {
+		int first, last;
+		{
+			std::unique_lock<std::mutex> lock(m_workMutex);
+			m_workStart.wait(lock, [&] { return m_stopWorkers || m_workFrame != frame; });
+			if (m_stopWorkers) return;
+			frame = m_workFrame;
+			first = (worker + 1) * m_slicesPerWorker;
+			last = std::min(first + m_slicesPerWorker, (int)CLUSTERS_Z);
+		}
+		// fewer slices than threads => some workers have nothing to do
+		if (first < last) {
+			assignSlices(first, last);
+		}
+		std::lock_guard<std::mutex> lock(m_workMutex);
+		if (--m_workRemaining == 0) {
+			m_workDone.notify_one();
+		}
+	}
+}
+
+void ClusteredLights::bindShader(Shader& shader)
+{
+	shader.setInt("u_clusterLights", LIGHTS_SLOT);
+	shader.setInt("u_clusterItems", ITEMS_SLOT);
+}
+
+void ClusteredLights::buildClusters(const glm::mat4& projection, unsigned int width, unsigned int height)
+{
+	m_projection = projection;
+	m_width = width;
+	m_height = height;
+
+	glm::mat4 inverse = glm::inverse(projection);
+	auto unproject = [&inverse](float x, float y, float z) {
+		glm::vec4 p = inverse * glm::vec4(x, y, z, 1.0f);
+		return glm::vec3(p) / p.w;
+	};
+
+	// exponential slices: depth = NEAR * (FAR / NEAR)^(slice / CLUSTERS_Z),
+	// the first slice starts at the near plane of the projection (may be negative for orthographic projections)
+	m_sliceDepths[0] = std::min(NEAR_DEPTH, -unproject(0.0f, 0.0f, -1.0f).z);
+	for (int z = 1; z <= CLUSTERS_Z; ++z) {
+		m_sliceDepths[z] = NEAR_DEPTH * std::pow(FAR_DEPTH / NEAR_DEPTH, (float)z / CLUSTERS_Z);
+	}
+
+	// tiles have the same size in pixels as in the shader (the last tiles may be partially outside)
+	m_tileSize = glm::vec2(std::ceil((float)width / CLUSTERS_X), std::ceil((float)height / CLUSTERS_Y));
+
+	m_clusters.resize(NUM_CLUSTERS);
+	for (int y = 0; y < CLUSTERS_Y; ++y) {
+		for (int x = 0; x < CLUSTERS_X; ++x) {
+			// tile corners in NDC
+			float x0 = std::min(x * m_tileSize.x / width, 1.0f) * 2.0f - 1.0f;
+			float x1 = std::min((x + 1) * m_tileSize.x / width, 1.0f) * 2.0f - 1.0f;
+			float y0 = std::min(y * m_tileSize.y / height, 1.0f) * 2.0f - 1.0f;
+			float y1 = std::min((y + 1) * m_tileSize.y / height, 1.0f) * 2.0f - 1.0f;
+			const glm::vec2 corners[] = { { x0, y0 }, { x1, y0 }, { x0, y1 }, { x1, y1 } };
+
+			// the ray through a corner (works for perspective and orthographic projections,
+			// NDC z = 0 instead of 1 because the far plane of an infinite projection can't be unprojected)
+			glm::vec3 rayStart[4], rayDir[4];
+			for (int i = 0; i < 4; ++i) {
+				rayStart[i] = unproject(corners[i].x, corners[i].y, -1.0f);
+				rayDir[i] = unproject(corners[i].x, corners[i].y, 0.0f) - rayStart[i];
+			}
+
+			for (int z = 0; z < CLUSTERS_Z; ++z) {
+				AABB& box = m_clusters[(z * CLUSTERS_Y + y) * CLUSTERS_X + x];
+				box.min = glm::vec3(FLT_MAX);
+				box.max = glm::vec3(-FLT_MAX);
+				// points of the rays at the near and far depth of the slice (view space z = -depth)
+				for (float depth : { m_sliceDepths[z], m_sliceDepths[z + 1] }) {
+					for (int i = 0; i < 4; ++i) {
+						glm::vec3 p = rayStart[i] + rayDir[i] * ((-depth - rayStart[i].z) / rayDir[i].z);
+						box.min = glm::min(box.min, p);
+						box.max = glm::max(box.max, p);
+					}
+				}
+			}
+		}
+	}
+}
+
+void ClusteredLights::assignSlices(int first, int last)
+{
+	for (int z = first; z < last; ++z) {
+		Slice& slice = m_slices[z];
+		slice.indices.clear();
+		slice.lights.clear();
+		slice.x.clear();
+		slice.y.clear();
+		slice.z.clear();
+		slice.radius.clear();
+
+		// lights overlapping the depth range of the slice (view space z is negative in front of the camera)
+		for (size_t i = 0; i < m_spheres.size(); ++i) {
+			const glm::vec4& sphere = m_spheres[i];
+			if (-sphere.z + sphere.w < m_sliceDepths[z] || -sphere.z - sphere.w > m_sliceDepths[z + 1]) {
+				continue;
+			}
+			slice.lights.push_back((unsigned int)i);
+			slice.x.push_back(sphere.x);
+			slice.y.push_back(sphere.y);
+			slice.z.push_back(sphere.z);
+			slice.radius.push_back(sphere.w);
+		}
+		// pad to a multiple of 4 for the SSE test (the padding is masked out)
+		size_t count = slice.lights.size();
+		size_t padded = (count + 3) & ~(size_t)3;
+		slice.x.resize(padded, 0.0f);
+		slice.y.resize(padded, 0.0f);
+		slice.z.resize(padded, 0.0f);
+		slice.radius.resize(padded, 0.0f);
+
+		for (int cluster = 0; cluster < CLUSTERS_X * CLUSTERS_Y; ++cluster) {
+			const AABB& box = m_clusters[z * CLUSTERS_X * CLUSTERS_Y + cluster];
+			unsigned int found = 0;
+			for (size_t i = 0; i < padded; i += 4) {
+				int mask = overlapSpheres4(&slice.x[i], &slice.y[i], &slice.z[i], &slice.radius[i], box.min, box.max);
+				if (i + 4 > count) {
+					mask &= (1 << (count - i)) - 1;
+				}
+				for (int bit = 0; bit < 4; ++bit) {
+					if (mask & (1 << bit)) {
+						slice.indices.push_back(slice.lights[i + bit]);
+						found++;
+					}
+				}
+			}
+			slice.counts[cluster] = found;
+		}
+	}
+}
+
+void ClusteredLights::update(const std::vector<std::unique_ptr<Light>>& lights, const glm::mat4& view, const glm::mat4& projection,
+	unsigned int width, unsigned int height)
+{
+	if (projection != m_projection || width != m_width || height != m_height) {
+		buildClusters(projection, width, height);
+	}
+
+	// gather the lights and their range spheres in view space
+	m_lights.clear();
+	m_spheres.clear();
+	Light::UniformData data;
+	for (const auto& light : lights) {
+		if (light->getType() == Light::Type::DIRECTIONAL) {
+			continue;
+		}
+		light->getUniformData(data);
+		// lights without distance attenuation are limited to the clustered depth range
+		float range = std::min(Light::getRange(data, RANGE_THRESHOLD), FAR_DEPTH);
+		if (!data.enabled || range <= 0.0f) {
+			continue;
+		}
+		LightData lightData;
+		lightData.position = glm::vec3(data.position);
+		lightData.range = range;
+		lightData.color = data.color;
+		lightData.intensity = data.intensity;
+		lightData.attenuation = data.attenuation;
+		if (light->getType() == Light::Type::SPOT) {
+			lightData.direction = glm::normalize(data.target - lightData.position);
+			lightData.cutOff = data.cutOff;
+			lightData.outerCutOff = data.outerCutOff;
+		}
+		else {
+			lightData.direction = glm::vec3(0.0f, -1.0f, 0.0f);
+			lightData.cutOff = -1.0f;
+			lightData.outerCutOff = -2.0f;
+		}
+		m_lights.push_back(lightData);
+		m_spheres.push_back(glm::vec4(glm::vec3(view * glm::vec4(lightData.position, 1.0f)), range));
+	}
+
+	// every thread assigns a range of depth slices (a few lights are assigned on this thread only)
+	bool parallel = m_lights.size() >= 64;
+	if (parallel && m_workers.empty()) {
+		int threads = (int)std::max(1u, std::min(std::thread::hardware_concurrency(), (unsigned int)CLUSTERS_Z));
+		for (int i = 0; i + 1 < threads; ++i) {
+			m_workers.emplace_back(&ClusteredLights::workerLoop, this, i);
+		}
+	}
+	parallel = parallel && !m_workers.empty();
+	const int slices = CLUSTERS_Z;
+	int threads = parallel ? (int)m_workers.size() + 1 : 1;
+	int slicesPerWorker = (slices + threads - 1) / threads;
+	if (parallel) {
+		{
+			std::lock_guard<std::mutex> lock(m_workMutex);
+			m_slicesPerWorker = slicesPerWorker;
+			m_workRemaining = (int)m_workers.size();
+			m_workFrame++;
+		}
+		m_workStart.notify_all();
+	}
+	assignSlices(0, std::min(slicesPerWorker, slices));
+	if (parallel) {
+		std::unique_lock<std::mutex> lock(m_workMutex);
+		m_workDone.wait(lock, [this] { return m_workRemaining == 0; });
+	}
+
+	// the texture buffer size is limited (at least 65536 texels)
+	if (m_maxTexels == 0) {
+		glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &m_maxTexels);
+	}
+
+	// merge the slices: (offset, count) of every cluster followed by the indices
+	m_items.resize(2 * NUM_CLUSTERS);
+	m_maxLightsPerCluster = 0;
+	for (int z = 0; z < CLUSTERS_Z; ++z) {
+		const Slice& slice = m_slices[z];
+		const unsigned int* indices = slice.indices.data();
+		for (int cluster = 0; cluster < CLUSTERS_X * CLUSTERS_Y; ++cluster) {
+			unsigned int count = slice.counts[cluster];
+			unsigned int offset = (unsigned int)m_items.size();
+			unsigned int stored = std::min(count, (unsigned int)m_maxTexels - std::min(offset, (unsigned int)m_maxTexels));
+			if (stored < count && !m_warned) {
+				printf("Warning: too many lights per cluster, the light index buffer is limited to %d entries\n", m_maxTexels);
+				m_warned = true;
+			}
+			int index = z * CLUSTERS_X * CLUSTERS_Y + cluster;
+			m_items[2 * index] = offset;
+			m_items[2 * index + 1] = stored;
+			m_items.insert(m_items.end(), indices, indices + stored);
+			indices += count;
+			m_maxLightsPerCluster = std::max(m_maxLightsPerCluster, count);
+		}
+	}
+
+	// buffers must not be empty
+	if (m_lights.empty()) {
+		LightData empty = {};
+		m_lightsBuffer.bufferData(&empty, sizeof(LightData));
+	}
+	else {
+		m_lightsBuffer.bufferData(m_lights.data(), (unsigned int)(m_lights.size() * sizeof(LightData)));
+	}
+	m_itemsBuffer.bufferData(m_items.data(), (unsigned int)(m_items.size() * sizeof(unsigned int)));
+}
+
+void ClusteredLights::setUniforms(Shader& shader) const
+{
+	shader.setKeyword("CLUSTERED_LIGHTS", !m_lights.empty());
+	if (m_lights.empty()) {
+		return;
+	}
+	// slice = log(depth) * scale + bias
+	float logRatio = std::log(FAR_DEPTH / NEAR_DEPTH);
+	shader.setVec4("u_clusterParams", glm::vec4(m_tileSize, CLUSTERS_Z / logRatio, -CLUSTERS_Z * std::log(NEAR_DEPTH) / logRatio));
+	shader.setVec3("u_clusterCount", glm::vec3(CLUSTERS_X, CLUSTERS_Y, CLUSTERS_Z));
+	m_lightsBuffer.bind(LIGHTS_SLOT);
+	m_itemsBuffer.bind(ITEMS_SLOT);
+}
@@ -0,0 +1,147 @@
+#pragma once
+#include "Light.h"
+#include "Buffer/TBO.h"
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+/// <summary>
+/// Clustered forward lighting for point lights and spotlights without shadows (shaders/clusters.partial.glsl).
+/// The view frustum is split in CLUSTERS_X * CLUSTERS_Y screen tiles and CLUSTERS_Z exponential depth slices.
+/// Every frame the lights are assigned on the CPU (on persistent worker threads, 4 lights per SSE test) to the clusters their
+/// range sphere overlaps. The light data and the light index list of every cluster are read from texture buffers,
+/// so a fragment only loops over the lights of its cluster.
+/// </summary>
+class ClusteredLights
+{
+public:
+	static const int CLUSTERS_X = 16;
+	static const int CLUSTERS_Y = 9;
+	static const int CLUSTERS_Z = 24;
+	static const int NUM_CLUSTERS = CLUSTERS_X * CLUSTERS_Y * CLUSTERS_Z;
+
+	// texture slots of the buffers (after the shadow atlas)
+	static const unsigned int LIGHTS_SLOT = 13;
+	static const unsigned int ITEMS_SLOT = 14;
+
+	// depth range of the slices in view space, fragments outside use the first/last slice
+	static const float NEAR_DEPTH;
+	static const float FAR_DEPTH;
+
+	// the light range ends where its attenuated intensity falls below this value
+	static const float RANGE_THRESHOLD;
+
+	/// <summary>
+	/// Light as stored in the lights buffer (4 RGBA32F texels)
+	/// </summary>
+	struct LightData {
+		glm::vec3 position;
+		float range;
+		glm::vec3 color;
+		float intensity;
+		glm::vec3 attenuation;
+		float cutOff;       // cos values, -1 and -2 for point lights (spotlight factor is always 1)
+		glm::vec3 direction;
+		float outerCutOff;
+	};
+private:
+	// view space bounds of one cluster
+	struct AABB {
+		glm::vec3 min;
+		glm::vec3 max;
+	};
+
+	// light indices found by one worker for one depth slice
+	struct Slice {
+		// number of lights per cluster of the slice
+		unsigned int counts[CLUSTERS_X * CLUSTERS_Y];
+		// indices of all clusters of the slice, in cluster order
+		std::vector<unsigned int> indices;
+		// range spheres (view space, structure of arrays) of the lights overlapping the slice depth range
+		std::vector<float> x, y, z, radius;
+		std::vector<unsigned int> lights;
+	};
+
+	TBO m_lightsBuffer{ GL_RGBA32F };
+	TBO m_itemsBuffer{ GL_R32UI };
+
+	std::vector<LightData> m_lights;
+	// range spheres of the lights in view space (xyz = center, w = radius)
+	std::vector<glm::vec4> m_spheres;
+
+	// cluster bounds, rebuilt when the projection or the size changes
+	std::vector<AABB> m_clusters;
+	float m_sliceDepths[CLUSTERS_Z + 1];
+	glm::mat4 m_projection = glm::mat4(0.0f);
+	unsigned int m_width = 0;
+	unsigned int m_height = 0;
+	// size of a tile in pixels
+	glm::vec2 m_tileSize = glm::vec2(1.0f);
+
+	Slice m_slices[CLUSTERS_Z];
+	// (offset, count) of every cluster followed by the light indices
+	std::vector<unsigned int> m_items;
+
+	unsigned int m_maxLightsPerCluster = 0;
+
+	// size of the light index buffer (GL_MAX_TEXTURE_BUFFER_SIZE, queried in the first update)
+	int m_maxTexels = 0;
+	// the index buffer overflow was reported
+	bool m_warned = false;
+
+	// worker threads, started by the first update with enough lights and woken once per frame
+	// (the update thread assigns the first range of slices, worker i the range i + 1)
+	std::vector<std::thread> m_workers;
+	std::mutex m_workMutex;
+	// wakes the workers for a new frame / the update thread when all workers are done
+	std::condition_variable m_workStart;
+	std::condition_variable m_workDone;
+	// incremented for every frame given to the workers
+	unsigned int m_workFrame = 0;
+	// workers that have not finished the current frame
+	int m_workRemaining = 0;
+	// depth slices per thread in the current frame
+	int m_slicesPerWorker = 0;
+	bool m_stopWorkers = false;
+
+	// rebuild the cluster bounds for the projection
+	void buildClusters(const glm::mat4& projection, unsigned int width, unsigned int height);
+
+	// find the lights of every cluster of the slices [first, last)
+	void assignSlices(int first, int last);
+
+	// wait for a frame and assign the slices of the worker until the workers are stopped
+	void workerLoop(int worker);
+public:
+	ClusteredLights();
+	~ClusteredLights();
+	ClusteredLights(const ClusteredLights& o) = delete;
+	ClusteredLights& operator=(const ClusteredLights& o) = delete;
+
+	/// <summary>
+	/// Set the samplers of the buffers (call once per shader)
+	/// </summary>
+	static void bindShader(Shader& shader);
+
+	/// <summary>
+	/// Assign the enabled point lights and spotlights to the clusters and upload the buffers
+	/// (directional lights are ignored). Call every frame before drawing.
+	/// </summary>
+	/// <param name="view">: view matrix of the camera</param>
+	/// <param name="projection">: projection matrix of the camera</param>
+	/// <param name="width">, height: size of the framebuffer in pixels</param>
+	void update(const std::vector<std::unique_ptr<Light>>& lights, const glm::mat4& view, const glm::mat4& projection,
+		unsigned int width, unsigned int height);
+
+	/// <summary>
+	/// Enable the CLUSTERED_LIGHTS keyword (if there are lights), set the cluster uniforms and bind the buffers
+	/// </summary>
+	void setUniforms(Shader& shader) const;
+
+	unsigned int getLightCount() const { return (unsigned int)m_lights.size(); }
+	// number of light indices of all clusters
+	unsigned int getIndexCount() const { return (unsigned int)m_items.size() - 2 * NUM_CLUSTERS; }
+	unsigned int getMaxLightsPerCluster() const { return m_maxLightsPerCluster; }
+};
@@ -1,4 +1,5 @@
 #include "DirectionalLight.h"
+#include <cfloat>
 
 DirectionalLight::DirectionalLight(int index, const glm::vec3& direction, const glm::vec3& color) : 
 	Light(index, color)
@@ -24,58 +25,43 @@ void DirectionalLight::imGuiRender()
 		m_parameters.UP = (m_position.z == 0.0f && m_position.x == 0.0f) ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
 		calculateLightSpaceMatrix();
 		m_shadowNeedsRender = true;
+		m_dirty = true;
 	}
 
-	// UI for light view projection parameters
-	ImGui::PushStyleColor(ImGuiCol_Header, ImVec4(0.1f, 0.25f, 0.25f, 1.0f)); // Set header color
-	if (ImGui::CollapsingHeader("Light projection matrix parameters")) {
-		if (ImGui::DragFloat("Min x", &m_parameters.minx, 0.001f, -50.0f, 50.0f)) {
-			calculateLightSpaceMatrix();
-			m_shadowNeedsRender = true;
-		}
-		if (ImGui::DragFloat("Max x", &m_parameters.maxx, 0.001f, -50.0f, 50.0f)) {
-			calculateLightSpaceMatrix();
-			m_shadowNeedsRender = true;
-		}
-		if (ImGui::DragFloat("Min y", &m_parameters.miny, 0.001f, -50.0f, 50.0f)) {
-			calculateLightSpaceMatrix();
-			m_shadowNeedsRender = true;
-		}
-		if (ImGui::DragFloat("Max y", &m_parameters.maxy, 0.001f, -50.0f, 50.0f)) {
-			calculateLightSpaceMatrix();
-			m_shadowNeedsRender = true;
-		}
-		if (ImGui::DragFloat("Near plane", &m_parameters.near_plane, 0.001f, 0.001f, 50.0f)) {
-			calculateLightSpaceMatrix();
-			m_shadowNeedsRender = true;
-		}
-		if (ImGui::DragFloat("Far plane", &m_parameters.far_plane, 0.001f, 0.001f, 50.0f)) {
-			calculateLightSpaceMatrix();
-			m_shadowNeedsRender = true;
-		}
-		if (ImGui::DragFloat("Scale", &m_parameters.directionalLightScale, 0.01f, 0.1f, 50.0f)) {
-			calculateLightSpaceMatrix();
-			m_shadowNeedsRender = true;
-		}
+	// cascades are fitted again in the next frame
+	ImGui::SliderInt("Cascades", &m_cascadeCount, 1, MAX_CASCADES);
+	ImGui::DragFloat("Shadow distance", &m_shadowDistance, 0.1f, 0.5f, 500.0f);
+	ImGui::SliderFloat("Split lambda", &m_splitLambda, 0.0f, 1.0f);
+	// distance in front of the cascades (towards the light) where casters are still rendered
+	ImGui::DragFloat("Caster distance", &m_parameters.far_plane, 0.01f, 0.0f, 100.0f);
+	for (int i = 0; i < m_fittedCascades; ++i) {
+		ImGui::Text("Cascade %d: up to %.2f", i, m_cascadeSplits[i]);
 	}
-	ImGui::PopStyleColor();
 }
 
-void DirectionalLight::setUniforms(Shader& shader)
+void DirectionalLight::getUniformData(UniformData& data) const
 {
-	shader.setVec4(formatAttribute("position"), m_modelMatrix * glm::vec4(m_position, 0.0f));
-	shader.setFloat(formatAttribute("intensity"), m_intensity);
-	shader.setVec3(formatAttribute("color"), m_color);
-	shader.setBool(formatAttribute("enabled"), m_enabled);
-	shader.setVec3(formatAttribute("attenuation"), glm::vec3(0.0f));
-	shader.setVec3(formatAttribute("target"), glm::vec3(0.0f));
-	shader.setFloat(formatAttribute("cutOff"), glm::cos(glm::radians(0.0f)));
-	shader.setFloat(formatAttribute("outerCutOff"), glm::cos(glm::radians(0.0f)));
-	shader.setBool(formatAttribute("shadow"), m_shadow);
-	shader.setMat4(formatAttribute("lightSpaceMatrix"), m_lightSpaceMatrix[0]);
-	shader.setInt(formatAttribute("shadowMap"), m_shadowTextureSlot);
-	shader.setFloat(formatAttribute("farPlane"), m_parameters.far_plane);
-	shader.setInt(formatAttribute("type"), 0);
+	data.lightSpaceMatrix = m_lightSpaceMatrix[0];
+	data.position = m_modelMatrix * glm::vec4(m_position, 0.0f);
+	data.color = m_color;
+	data.intensity = m_intensity;
+	data.attenuation = glm::vec3(0.0f);
+	data.cutOff = glm::cos(glm::radians(0.0f));
+	data.target = glm::vec3(0.0f);
+	data.outerCutOff = glm::cos(glm::radians(0.0f));
+	data.type = 0;
+	data.enabled = m_enabled;
+	data.shadow = m_shadow;
+	data.farPlane = m_parameters.far_plane;
+	data.shadowFilterRadius = m_shadowFilterRadius;
+	data.shadowLightSize = m_shadowLightSize;
+	data.shadowRect = m_shadowRect;
+	for (int i = 0; i < MAX_CASCADES; ++i) {
+		data.cascadeScale[i] = m_cascadeScale[i];
+		data.cascadeOffset[i] = m_cascadeOffset[i];
+	}
+	data.cascadeCount = m_fittedCascades;
+	applyShadowState(data);
 }
 
 void DirectionalLight::calculateLightSpaceMatrix()
@@ -92,4 +78,100 @@ void DirectionalLight::calculateLightSpaceMatrix()
 			m_parameters.directionalLightScale * glm::normalize(m_position), // "place" the light on a sphere with radius 'directionalLightScale'
 			glm::vec3(0.0f), // looking at origin
 			m_parameters.UP); // up vector
-}
\ No newline at end of file
+}
+
+void DirectionalLight::fitShadowToCamera(const glm::mat4& view, const glm::mat4& projection)
+{
+	// near and far view depth of the camera (perspective and orthographic projections)
+	bool perspective = projection[2][3] != 0.0f;
+	float nearDepth, farDepth;
+	if (perspective) {
+		nearDepth = projection[3][2] / (projection[2][2] - 1.0f);
+		// infinite perspective: projection[2][2] == -1
+		farDepth = projection[2][2] != -1.0f ? projection[3][2] / (projection[2][2] + 1.0f) : FLT_MAX;
+	}
+	else {
+		nearDepth = (projection[3][2] + 1.0f) / projection[2][2];
+		farDepth = (projection[3][2] - 1.0f) / projection[2][2];
+	}
+	farDepth = std::min(farDepth, nearDepth + m_shadowDistance);
+
+	// the corners of the near plane give the direction of the frustum edges (view space)
+	glm::mat4 inverseProjection = glm::inverse(projection);
+	glm::vec3 corners[4];
+	for (int i = 0; i < 4; ++i) {
+		glm::vec4 corner = inverseProjection * glm::vec4(i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f, -1.0f, 1.0f);
+		corners[i] = glm::vec3(corner) / corner.w;
+	}
+	// corner of the frustum at a view depth
+	auto frustumCorner = [&](int i, float depth) {
+		if (perspective) {
+			return corners[i] * (depth / -corners[i].z);
+		}
+		return glm::vec3(corners[i].x, corners[i].y, -depth);
+	};
+
+	// all cascades share the rotation of the light, they only differ in their orthographic box
+	glm::vec3 lightDirection = -glm::normalize(m_position);
+	glm::mat4 lightView = glm::lookAt(glm::vec3(0.0f), lightDirection, m_parameters.UP);
+	glm::mat4 cameraToLight = lightView * glm::inverse(view);
+	glm::ivec2 cells = getShadowCells();
+	int cellSize = m_shadowViewport.z / cells.x;
+
+	std::vector<glm::mat4> matrices(m_cascadeCount);
+	glm::vec3 center[MAX_CASCADES], halfSize[MAX_CASCADES];
+	float splitNear = nearDepth;
+	for (int c = 0; c < m_cascadeCount; ++c) {
+		// practical split scheme: blend of logarithmic and uniform splits
+		float t = (c + 1.0f) / m_cascadeCount;
+		float logNear = std::max(nearDepth, 0.01f);
+		float logSplit = logNear * std::pow(farDepth / logNear, t);
+		float uniformSplit = nearDepth + (farDepth - nearDepth) * t;
+		float splitFar = m_splitLambda * logSplit + (1.0f - m_splitLambda) * uniformSplit;
+		m_cascadeSplits[c] = splitFar;
+
+		// bounding sphere of the split in light view space (the size doesn't change when the camera rotates)
+		glm::vec3 points[8];
+		glm::vec3 sphereCenter(0.0f);
+		for (int i = 0; i < 8; ++i) {
+			points[i] = glm::vec3(cameraToLight * glm::vec4(frustumCorner(i & 3, i < 4 ? splitNear : splitFar), 1.0f));
+			sphereCenter += points[i] / 8.0f;
+		}
+		float radius = 0.0f;
+		for (const glm::vec3& point : points) {
+			radius = std::max(radius, glm::length(point - sphereCenter));
+		}
+		radius = std::ceil(radius * 16.0f) / 16.0f;
+
+		// move the box in whole texels
+		if (cellSize > 0) {
+			float texelSize = 2.0f * radius / cellSize;
+			sphereCenter.x = std::floor(sphereCenter.x / texelSize) * texelSize;
+			sphereCenter.y = std::floor(sphereCenter.y / texelSize) * texelSize;
+		}
+
+		// depth range (distance along the light direction), extended towards the light for casters outside the sphere
+		float nearPlane = -sphereCenter.z - radius - m_parameters.far_plane;
+		float farPlane = -sphereCenter.z + radius;
+		matrices[c] = glm::ortho(sphereCenter.x - radius, sphereCenter.x + radius, sphereCenter.y - radius, sphereCenter.y + radius, nearPlane, farPlane) * lightView;
+		center[c] = glm::vec3(sphereCenter.x, sphereCenter.y, 0.5f * (nearPlane + farPlane));
+		halfSize[c] = glm::vec3(radius, radius, 0.5f * (farPlane - nearPlane));
+		splitNear = splitFar;
+	}
+
+	// normalized coords of cascade c = (coords of cascade 0 * halfSize0 + center0 - center) / halfSize
+	// (an orthographic projection maps x, y and the distance along the light direction to (value - center) / halfSize)
+	for (int c = 0; c < MAX_CASCADES; ++c) {
+		bool used = c < m_cascadeCount;
+		m_cascadeScale[c] = used ? glm::vec4(halfSize[0] / halfSize[c], 0.0f) : glm::vec4(0.0f);
+		m_cascadeOffset[c] = used ? glm::vec4((center[0] - center[c]) / halfSize[c], 0.0f) : glm::vec4(0.0f);
+	}
+
+	// render the shadow maps again only if a cascade moved
+	if (matrices != m_lightSpaceMatrix || m_fittedCascades != m_cascadeCount) {
+		m_lightSpaceMatrix = matrices;
+		m_fittedCascades = m_cascadeCount;
+		m_shadowNeedsRender = true;
+		m_dirty = true;
+	}
+}
@@ -6,6 +6,33 @@
 /// </summary>
 class DirectionalLight : public Light
 {
+private:
+	/// <summary>
+	/// Number of shadow cascades (splits of the camera frustum), stored in 2 columns of the atlas tile
+	/// </summary>
+	int m_cascadeCount = 3;
+
+	/// <summary>
+	/// View depth covered by the cascades, no shadows further away
+	/// </summary>
+	float m_shadowDistance = 20.0f;
+
+	/// <summary>
+	/// Split distribution: 0 = uniform, 1 = logarithmic
+	/// </summary>
+	float m_splitLambda = 0.75f;
+
+	/// <summary>
+	/// Far view depth of every cascade (for the UI)
+	/// </summary>
+	float m_cascadeSplits[MAX_CASCADES] = {};
+
+	/// <summary>
+	/// Light space of cascade i = light space of cascade 0 * scale + offset (0 cascades until fitted to a camera)
+	/// </summary>
+	glm::vec4 m_cascadeScale[MAX_CASCADES] = {};
+	glm::vec4 m_cascadeOffset[MAX_CASCADES] = {};
+	int m_fittedCascades = 0;
 public:
 	/// <summary>
 	/// Constructs a new directional light derived from Light class
@@ -16,17 +43,42 @@ public:
 
 	/// <summary>
 	/// Calculate the light space matrix using the member parameters
+	/// (fixed box around the origin, used until the cascades are fitted to a camera)
 	/// </summary>
 	void calculateLightSpaceMatrix() override;
 
+	/// <summary>
+	/// The cascades are stored in 2 columns
+	/// </summary>
+	glm::ivec2 getShadowCells() const override { return glm::ivec2(std::min(m_cascadeCount, 2), (m_cascadeCount + 1) / 2); }
+
+	/// <summary>
+	/// Split the camera frustum (up to the shadow distance) in cascades and fit an orthographic projection around
+	/// the bounding sphere of each split. The projections are snapped to texels of the atlas cell, so the shadows
+	/// don't shimmer when the camera moves. The far plane parameter is the distance in front of a cascade
+	/// (towards the light) where casters are still rendered.
+	/// </summary>
+	void fitShadowToCamera(const glm::mat4& view, const glm::mat4& projection) override;
+
+	/// <summary>
+	/// Set the number of cascades (1 - MAX_CASCADES)
+	/// </summary>
+	void setCascadeCount(int count) { m_cascadeCount = glm::clamp(count, 1, MAX_CASCADES); }
+	int getCascadeCount() const { return m_cascadeCount; }
+
+	/// <summary>
+	/// Set the view depth covered by the cascades
+	/// </summary>
+	void setShadowDistance(float distance) { m_shadowDistance = distance; }
+
 	/// <summary>
 	/// Draw UI in ImGui
 	/// </summary>
 	void imGuiRender() override;
 
 	/// <summary>
-	/// Sets all uniforms for this light (at m_index)
+	/// Fills the uniform buffer data for this light
 	/// </summary>
-	void setUniforms(Shader& shader) override;
+	void getUniformData(UniformData& data) const override;
 };
 
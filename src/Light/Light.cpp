@@ -1,4 +1,6 @@
 #include "Light.h"
+#include <algorithm>
+#include <cfloat>
 
 std::unique_ptr<Mesh> Light::s_lightMesh;
 
@@ -14,11 +16,81 @@ void Light::setViewProjectionParameters(const ViewProjectionParameters& param)
 {
 	m_parameters = param;
 	calculateLightSpaceMatrix();
+	m_dirty = true;
+}
+
+float Light::getRange(const UniformData& data, float threshold)
+{
+	const glm::vec3& att = data.attenuation;
+	float intensity = data.intensity * std::max(data.color.r, std::max(data.color.g, data.color.b));
+	if (data.type == 0 || (att.y <= 0.0f && att.z <= 0.0f)) {
+		return FLT_MAX;
+	}
+	// solve intensity / (constant + linear * d + quadratic * d^2) = threshold
+	float c = att.x - intensity / threshold;
+	if (c >= 0.0f) {
+		return 0.0f; // below the threshold everywhere
+	}
+	if (att.z <= 0.0f) {
+		return -c / att.y;
+	}
+	return (-att.y + std::sqrt(att.y * att.y - 4.0f * att.z * c)) / (2.0f * att.z);
+}
+
+bool Light::isSphereInCone(const glm::vec3& apex, const glm::vec3& axis, float cosAngle, const glm::vec3& center, float radius)
+{
+	glm::vec3 toCenter = center - apex;
+	float axisDistance = glm::dot(toCenter, axis);
+	float sideDistance = glm::sqrt(std::max(glm::dot(toCenter, toCenter) - axisDistance * axisDistance, 0.0f));
+	float sinAngle = glm::sqrt(std::max(1.0f - cosAngle * cosAngle, 0.0f));
+	// distance from the center to the side of the cone
+	return cosAngle * sideDistance - sinAngle * axisDistance <= radius;
+}
+
+void Light::getFrustumPlanes(const glm::mat4& viewProjection, glm::vec4 planes[6])
+{
+	// the planes are sums and differences of the rows of the matrix
+	glm::vec4 row[4];
+	for (int r = 0; r < 4; ++r) {
+		row[r] = glm::vec4(viewProjection[0][r], viewProjection[1][r], viewProjection[2][r], viewProjection[3][r]);
+	}
+	for (int axis = 0; axis < 3; ++axis) {
+		planes[2 * axis] = row[3] + row[axis];
+		planes[2 * axis + 1] = row[3] - row[axis];
+	}
+}
+
+bool Light::isBoxInFrustum(const glm::vec4 planes[6], const glm::vec3& min, const glm::vec3& max)
+{
+	for (int i = 0; i < 6; ++i) {
+		const glm::vec4& plane = planes[i];
+		// the corner of the box furthest along the plane normal
+		glm::vec3 corner(plane.x > 0.0f ? max.x : min.x, plane.y > 0.0f ? max.y : min.y, plane.z > 0.0f ? max.z : min.z);
+		if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.0f) {
+			return false;
+		}
+	}
+	return true;
+}
+
+int Light::getCellMask(const glm::vec3& min, const glm::vec3& max) const
+{
+	// one projection per cell (directional light cascades, spotlight)
+	int mask = 0;
+	glm::vec4 planes[6];
+	for (size_t cell = 0; cell < m_lightSpaceMatrix.size(); ++cell) {
+		getFrustumPlanes(m_lightSpaceMatrix[cell], planes);
+		if (isBoxInFrustum(planes, min, max)) {
+			mask |= 1 << cell;
+		}
+	}
+	return mask;
 }
 
 void Light::setPosition(const glm::vec3& pos)
 {
 	m_position = pos;
+	m_dirty = true;
 }
 
 void Light::draw(Shader& shader)
@@ -40,18 +112,75 @@ void Light::imGuiRender()
 {
 	ImGui::Checkbox("Draw light", &m_draw); // draw cube or not
 	ImGui::SameLine();
-	ImGui::Checkbox("Enable", &m_enabled); // enable/disable
+	// every other value is stored in the uniform buffer
+	bool changed = false;
+	changed |= ImGui::Checkbox("Enable", &m_enabled); // enable/disable
 	ImGui::SameLine();
-	ImGui::Checkbox("Shadows", &m_shadow);
-	ImGui::ColorEdit3("Light Color", &m_color.x, ImGuiColorEditFlags_Float);
-	ImGui::DragFloat("Light intensity", &m_intensity, 0.01f, 0.0f, 10.0f);
+	changed |= ImGui::Checkbox("Shadows", &m_shadow);
+	changed |= ImGui::ColorEdit3("Light Color", &m_color.x, ImGuiColorEditFlags_Float);
+	changed |= ImGui::DragFloat("Light intensity", &m_intensity, 0.01f, 0.0f, 10.0f);
+	// soft shadow kernel, used by the PCF and PCSS filters of the shadow atlas and by the blur of VSM/EVSM
+	if (ImGui::DragFloat("Shadow filter radius", &m_shadowFilterRadius, 0.05f, 0.0f, 32.0f, "%.2f texels")) {
+		// the moments are blurred when the shadow map is rendered
+		m_shadowNeedsRender = true;
+		changed = true;
+	}
+	changed |= ImGui::DragFloat("Shadow light size", &m_shadowLightSize, 0.001f, 0.0f, 2.0f);
+	if (m_shadow) {
+		ImGui::Text("Shadow casters: %d drawn, %d culled", m_castersDrawn, m_castersCulled);
+	}
+	if (changed) {
+		m_dirty = true;
+	}
+}
+
+void Light::captureShadowState(int cells)
+{
+	bool hadShadowState = m_hasShadowState;
+	glm::vec4 facePositions[6];
+	std::copy(m_shadowState.facePositions, m_shadowState.facePositions + 6, facePositions);
+	// the current data, without the previous state
+	m_hasShadowState = false;
+	getUniformData(m_shadowState);
+	m_hasShadowState = true;
+	if (hadShadowState) {
+		for (int face = 0; face < 6; ++face) {
+			if ((cells & (1 << face)) == 0) {
+				m_shadowState.facePositions[face] = facePositions[face];
+			}
+		}
+	}
+	m_dirty = true;
 }
 
-std::string Light::formatAttribute(const std::string& name)
+void Light::applyShadowState(UniformData& data) const
 {
-	std::stringstream ss;
-	ss << "u_lights[" << m_index << "]." << name;
-	return ss.str();
+	if (!m_hasShadowState) {
+		data.shadowPosition = data.position;
+		std::fill(data.facePositions, data.facePositions + 6, data.position);
+		return;
+	}
+	data.lightSpaceMatrix = m_shadowState.lightSpaceMatrix;
+	data.shadowPosition = m_shadowState.position;
+	std::copy(m_shadowState.facePositions, m_shadowState.facePositions + 6, data.facePositions);
+	data.farPlane = m_shadowState.farPlane;
+	data.nearPlane = m_shadowState.nearPlane;
+	for (int i = 0; i < MAX_CASCADES; ++i) {
+		data.cascadeScale[i] = m_shadowState.cascadeScale[i];
+		data.cascadeOffset[i] = m_shadowState.cascadeOffset[i];
+	}
+	data.cascadeCount = m_shadowState.cascadeCount;
+}
+
+void Light::setShadowTile(const glm::ivec4& viewport, const glm::vec4& rect)
+{
+	if (viewport == m_shadowViewport) {
+		return;
+	}
+	m_shadowViewport = viewport;
+	m_shadowRect = rect;
+	m_shadowNeedsRender = true;
+	m_dirty = true;
 }
 
 Light::ViewProjectionParameters& Light::ViewProjectionParameters::directional(
@@ -7,7 +7,7 @@
 #include "Mesh.h"
 
 /// <summary>
-/// Base class for lights. Must implement *setUniforms* and *calculateLightSpaceMatrix*
+/// Base class for lights. Must implement *getUniformData* and *calculateLightSpaceMatrix*
 /// </summary>
 class Light
 {
@@ -35,13 +35,49 @@ public:
 		POINT, DIRECTIONAL, SPOT
 	};
 
+	// maximum number of shadow cascades of a directional light (must be the same as MAX_CASCADES in shaders/lights.partial.glsl)
+	static const int MAX_CASCADES = 4;
+
+	/// <summary>
+	/// Light data as stored in the "Lights" uniform block (std140 layout, see shaders/lights.partial.glsl).
+	/// Members are ordered so that no padding is needed.
+	/// </summary>
+	struct UniformData {
+		glm::mat4 lightSpaceMatrix = glm::mat4(1.0f); // used to transform fragment from world space to light space
+		glm::vec4 position = glm::vec4(0.0f);         // w == 0 for directional light
+		glm::vec3 color = glm::vec3(1.0f);
+		float intensity = 1.0f;
+		glm::vec3 attenuation = glm::vec3(0.0f);      // constant, linear, quadratic
+		float cutOff = 1.0f;                          // cos value, 1 if NOT spotlight
+		glm::vec3 target = glm::vec3(0.0f);           // spotlight target
+		float outerCutOff = 1.0f;                     // cos value
+		int type = 0;                                 // 0 = directional | 1 = spotlight | 2 = pointlight
+		int enabled = 1;                              // bool in shader (4 bytes)
+		int shadow = 0;                               // bool in shader (4 bytes)
+		float farPlane = 1.0f;                        // used to map distance to [0,1] for shadows
+		glm::vec4 shadowRect = glm::vec4(0.0f);       // tile in the shadow atlas: xy = uv offset, zw = uv size of one face (0 = no tile)
+		// directional light cascades: light space coords of cascade i = coords of cascade 0 (lightSpaceMatrix) * scale + offset
+		glm::vec4 cascadeScale[MAX_CASCADES] = {};
+		glm::vec4 cascadeOffset[MAX_CASCADES] = {};
+		int cascadeCount = 0;                         // 0 = lightSpaceMatrix only
+		float nearPlane = 0.1f;                       // used to compute the hardware depth of perspective shadow maps
+		float shadowFilterRadius = 1.5f;              // PCF radius in shadow map texels (smallest penumbra of PCSS)
+		float shadowLightSize = 0.05f;                // PCSS: size of the light in world units (directional: penumbra per unit of distance)
+		glm::vec4 shadowPosition = glm::vec4(0.0f);   // position of the light when its shadow map was rendered
+		glm::vec4 facePositions[6] = {};              // point lights: position of the light when each cube face was last rendered
+	};
+	static_assert(sizeof(UniformData) == 416, "Light::UniformData must match the std140 layout of the Light struct in shaders");
+
 protected:
 	/// type of light
 	Type m_type;
 
-	// flag if the light position has been updated, used to render the scene for shadowmapping
+	// flag if the light position has been updated (or a static caster moved), used to render the scene for shadowmapping
 	bool m_shadowNeedsRender = true;
 
+	// flag if any value stored in the uniform buffer changed (the light data needs to be uploaded again)
+	bool m_dirty = true;
+
 	// parameters for shadowmapping (view and projection matrices)
 	ViewProjectionParameters m_parameters;
 
@@ -72,19 +108,42 @@ protected:
 	bool m_shadow = false;
 	std::vector<glm::mat4> m_lightSpaceMatrix = { glm::mat4(1.0f) };
 
+	// soft shadow kernel (see UniformData): PCF radius in texels, PCSS light size
+	float m_shadowFilterRadius = 1.5f;
+	float m_shadowLightSize = 0.05f;
+
 	/// <summary>
-	/// Slot of the texture depth map (0-16)
+	/// Tile of the shadow atlas (set by ShadowAtlas): viewport in pixels (x, y, width, height)
+	/// and uv rect read by the shaders (xy = offset, zw = size of one face)
 	/// </summary>
-	unsigned int m_shadowTextureSlot = 0;
+	glm::ivec4 m_shadowViewport = glm::ivec4(0);
+	glm::vec4 m_shadowRect = glm::vec4(0.0f);
+
+	// uniform data when the shadow map was last rendered (see captureShadowState)
+	UniformData m_shadowState;
+	bool m_hasShadowState = false;
+
+	// shadow casters drawn to / culled from the cells of the last shadow map update (one count per caster and cell)
+	int m_castersDrawn = 0;
+	int m_castersCulled = 0;
 
 	/// <summary>
-	/// Helper function to get the name of attribute as a uniform name
-	/// e.g. formatAttribute("position") == "u_lights[m_index].position"
+	/// Replace the shadow projection of the data (matrices, cascades, position, near/far planes) with the one the
+	/// shadow map was rendered with. Call at the end of getUniformData.
 	/// </summary>
-	/// <param name="name">: name of attribute, same as in shader</param>
-	std::string formatAttribute(const std::string& name);
+	void applyShadowState(UniformData& data) const;
 
 	virtual void calculateLightSpaceMatrix() = 0;
+
+	/// <summary>
+	/// Extract the frustum planes of a view projection matrix (Gribb-Hartmann), xyz = normal pointing inside, w = distance
+	/// </summary>
+	static void getFrustumPlanes(const glm::mat4& viewProjection, glm::vec4 planes[6]);
+
+	/// <summary>
+	/// Check if a world space box is (at least partly) inside the frustum planes
+	/// </summary>
+	static bool isBoxInFrustum(const glm::vec4 planes[6], const glm::vec3& min, const glm::vec3& max);
 public:
 	/// <summary>
 	///	The index refers to the index in the shader lights uniform array
@@ -97,26 +156,53 @@ public:
 
 	Type getType() const { return m_type; }
 
+	/// <summary>
+	/// Index of the light in the shader lights array
+	/// </summary>
+	int getIndex() const { return m_index; }
+
+	/// <summary>
+	/// Return flag to check if the light data must be uploaded to the uniform buffer
+	/// </summary>
+	bool isDirty() const { return m_dirty; }
+
+	/// <summary>
+	/// Resets dirty flag (call after uploading the light data)
+	/// </summary>
+	void clearDirty() { m_dirty = false; }
+
 	/// <summary>
 	/// Return flag to check if re rendering the scene for shadow mapping is necessary
 	/// </summary>
 	bool getShadowNeedsRender() const { return m_shadowNeedsRender; }
 
 	/// <summary>
-	/// Resets shadowNeedsRender flag (call after rendering scene)
+	/// Resets shadowNeedsRender flag (the shadow atlas takes it over when it schedules the shadow map)
 	/// </summary>
 	void resetShadowNeedsRender() { m_shadowNeedsRender = false; }
 
+	/// <summary>
+	/// Render the shadow map again in the next shadow pass (e.g. a static caster moved)
+	/// </summary>
+	void invalidateShadow() { m_shadowNeedsRender = true; }
+
+	/// <summary>
+	/// Remember the current shadow projection (call after rendering the shadow map). The uniform data keeps it until
+	/// the next call, so a shadow map whose update is delayed is still read with the matrices it was rendered with.
+	/// </summary>
+	/// <param name="cells">: cells rendered (bit i = cell i), the other point light faces keep the position they were rendered at</param>
+	void captureShadowState(int cells);
+
 	/// <summary>
 	/// Set if the light is casting shadow
 	/// </summary>
-	void setShadow(bool value) { m_shadow = true; }
+	void setShadow(bool value) { m_shadow = value; m_dirty = true; }
 	bool getShadow() const { return m_shadow; }
 
 	/// <summary>
 	/// Set the light intensity. Default is 1.
 	/// </summary>
-	void setIntensity(float value) { m_intensity = value; }
+	void setIntensity(float value) { m_intensity = value; m_dirty = true; }
 	float getIntensity() const { return m_intensity; }
 
 	/// <summary>
@@ -132,15 +218,31 @@ public:
 	/// <summary>
 	/// Disable the light (does not light the scene)
 	/// </summary>
-	void disable() { m_enabled = false; }
+	void disable() { m_enabled = false; m_dirty = true; }
 
 	/// <summary>
 	/// Enable the light (lights the scene)
 	/// </summary>
-	void enable() { m_enabled = true; }
+	void enable() { m_enabled = true; m_dirty = true; }
 
-	unsigned int getShadowTextureSlot() const { return m_shadowTextureSlot; }
-	void setShadowTextureSlot(unsigned int slot) { m_shadowTextureSlot = slot; }
+	/// <summary>
+	/// Set the tile of the shadow atlas. If it moved, the shadow map must be rendered again.
+	/// </summary>
+	/// <param name="viewport">: x, y, width, height in pixels (point lights: 3x2 faces)</param>
+	/// <param name="rect">: uv offset (xy) and uv size of one face (zw)</param>
+	void setShadowTile(const glm::ivec4& viewport, const glm::vec4& rect);
+	const glm::ivec4& getShadowViewport() const { return m_shadowViewport; }
+
+	/// <summary>
+	/// Number of cells (columns, rows) of the shadow atlas tile, one shadow map per cell (point light faces, cascades)
+	/// </summary>
+	virtual glm::ivec2 getShadowCells() const { return glm::ivec2(1); }
+
+	/// <summary>
+	/// Fit the shadow projection to the camera (called every frame by the shadow atlas, after the tiles are assigned).
+	/// Only directional lights depend on the camera.
+	/// </summary>
+	virtual void fitShadowToCamera(const glm::mat4& /*view*/, const glm::mat4& /*projection*/) {}
 
 	/// <summary>
 	/// Sets the parameters which are used to generate lightspace matrix
@@ -148,37 +250,48 @@ public:
 	void setViewProjectionParameters(const ViewProjectionParameters& param);
 
 	/// <summary>
-	/// Get the light space matrices (only 1 for spot/directional)
+	/// Get the light space matrices (6 for point lights, one per cascade for directional lights, 1 for spotlights)
 	/// </summary>
 	const std::vector<glm::mat4>& getLightSpaceMatrix() { return m_lightSpaceMatrix; }
 
 	float getFarPlane() const { return m_parameters.far_plane; }
 
 	/// <summary>
-	/// Abstract method that sets all uniforms for this light (at m_index)
-	/// Must set the following uniforms: 
-	/// [int type] (0 = directional | 1 == spotlight | 2 == pointlight
-	/// [vec4 position (w == 0 for directional light)]
-	/// [float intensity]
-	/// [vec3 color]
-	/// [bool enabled]
-	/// [vec3 attenuation (constant, linear, quadrastic)]
-	/// [vec3 target]
-	/// [float cutOff (cos value, 1 if NOT spotlight)]
-	/// [float outerCutOff (cos value)]
-	/// [bool shadow] (flag - if shadows are computed)
-	/// [mat4 lightSpaceMatrix] (matrix used for shadowmapping)
-	/// [float farPlane] (for shadowmapping - used to map distance to [0,1])
-	/// </summary>
-	virtual void setUniforms(Shader& shader) = 0;
-	
+	/// Get the cells of the shadow map (see getShadowCells) whose projection overlaps a world space box, used to cull
+	/// shadow casters (bit i set = cell i, 0 = the box casts no shadow in any cell)
+	/// </summary>
+	virtual int getCellMask(const glm::vec3& min, const glm::vec3& max) const;
+
+	/// <summary>
+	/// Set the casters drawn and culled in the last shadow map update (shown in the UI)
+	/// </summary>
+	void setShadowCasterStats(int drawn, int culled) { m_castersDrawn = drawn; m_castersCulled = culled; }
+
+	/// <summary>
+	/// Abstract method that fills the uniform buffer data for this light (see UniformData)
+	/// </summary>
+	virtual void getUniformData(UniformData& data) const = 0;
+
+	/// <summary>
+	/// Distance at which the attenuated intensity (intensity * max color / attenuation) falls below threshold.
+	/// FLT_MAX for directional lights and lights without distance attenuation.
+	/// </summary>
+	static float getRange(const UniformData& data, float threshold);
+
+	/// <summary>
+	/// Check if a sphere overlaps an infinite cone
+	/// </summary>
+	/// <param name="axis">: normalized direction of the cone</param>
+	/// <param name="cosAngle">: cos of the half angle of the cone</param>
+	static bool isSphereInCone(const glm::vec3& apex, const glm::vec3& axis, float cosAngle, const glm::vec3& center, float radius);
+
 	/// <summary>
 	/// Draws the light mesh (if m_draw is true)
 	/// </summary>
 	virtual void draw(Shader& shader);
 
 	/// <summary>
-	/// Draws the GUI in ImGui for: [draw light] [enabled] [color] [intensity]
+	/// Draws the GUI in ImGui for: [draw light] [enabled] [color] [intensity] [shadow filter radius] [shadow light size]
 	/// Other options are in derived classes
 	/// </summary>
 	virtual void imGuiRender();
@@ -197,5 +310,5 @@ public:
 	/// <summary>
 	/// Set the model matrix for transformations
 	/// </summary>
-	void setModelMatrix(const glm::mat4& model) { m_modelMatrix = model; }
+	void setModelMatrix(const glm::mat4& model) { m_modelMatrix = model; m_dirty = true; }
 };
\ No newline at end of file
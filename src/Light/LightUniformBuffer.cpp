@@ -0,0 +1,112 @@
+#include "LightUniformBuffer.h"
+#include <algorithm>
+#include <cfloat>
+
+LightUniformBuffer::LightUniformBuffer()
+{
+	// unused lights are disabled
+	for (int i = 0; i < MAX_LIGHTS; ++i) {
+		m_data[i].enabled = 0;
+		m_ranges[i] = 0.0f;
+	}
+	m_ubo.bufferData(m_data, sizeof(m_data));
+}
+
+void LightUniformBuffer::bindShader(Shader& shader)
+{
+	shader.setUniformBlockBinding("Lights", BINDING);
+}
+
+void LightUniformBuffer::update(const std::vector<std::unique_ptr<Light>>& lights)
+{
+	// bind every frame, other scenes may use the same binding point
+	m_ubo.bindBase(BINDING);
+
+	// statistics of the previous frame
+	m_averageLights = m_objectCount > 0 ? (float)m_objectLightCount / m_objectCount : 0.0f;
+	m_objectCount = 0;
+	m_objectLightCount = 0;
+
+	// range of dirty lights
+	int first = MAX_LIGHTS, last = -1;
+	for (const auto& light : lights) {
+		int index = light->getIndex();
+		if (!light->isDirty() || index < 0 || index >= MAX_LIGHTS) {
+			continue;
+		}
+		light->getUniformData(m_data[index]);
+		m_ranges[index] = getRange(m_data[index]);
+		light->clearDirty();
+		first = std::min(first, index);
+		last = std::max(last, index);
+	}
+
+	// nothing changed
+	if (last < first) {
+		return;
+	}
+	m_ubo.bufferSubData(first * sizeof(Light::UniformData), &m_data[first], (last - first + 1) * sizeof(Light::UniformData));
+}
+
+float LightUniformBuffer::getRange(const Light::UniformData& data) const
+{
+	if (!data.enabled || data.intensity <= 0.0f) {
+		return 0.0f;
+	}
+	return Light::getRange(data, m_rangeThreshold);
+}
+
+int LightUniformBuffer::getObjectLights(const glm::vec3& min, const glm::vec3& max, int indices[MAX_LIGHTS]) const
+{
+	glm::vec3 center = 0.5f * (min + max);
+	float radius = 0.5f * glm::length(max - min);
+	int count = 0;
+	for (int i = 0; i < MAX_LIGHTS; ++i) {
+		const Light::UniformData& data = m_data[i];
+		if (m_ranges[i] <= 0.0f) {
+			continue;
+		}
+		// directional lights reach everything
+		if (data.type != 0) {
+			// distance from the light to the closest point of the box
+			glm::vec3 position(data.position);
+			glm::vec3 closest = glm::clamp(position, min, max);
+			if (glm::dot(closest - position, closest - position) > m_ranges[i] * m_ranges[i]) {
+				continue;
+			}
+			// the cone of a spotlight (point lights have no target)
+			if (data.type == 1 && data.target != position && !Light::isSphereInCone(position, glm::normalize(data.target - position), data.outerCutOff, center, radius)) {
+				continue;
+			}
+		}
+		indices[count++] = i;
+	}
+	return count;
+}
+
+void LightUniformBuffer::setObjectLights(Shader& shader, const glm::vec3& min, const glm::vec3& max)
+{
+	int indices[MAX_LIGHTS];
+	int count = getObjectLights(min, max, indices);
+	shader.setInt("u_numLights", count);
+	shader.setIntArray("u_lightIndices", count, indices);
+	++m_objectCount;
+	m_objectLightCount += count;
+}
+
+void LightUniformBuffer::setRangeThreshold(float threshold)
+{
+	m_rangeThreshold = threshold;
+	for (int i = 0; i < MAX_LIGHTS; ++i) {
+		m_ranges[i] = getRange(m_data[i]);
+	}
+}
+
+void LightUniformBuffer::imGuiRender()
+{
+	float threshold = m_rangeThreshold;
+	if (ImGui::SliderFloat("Light range threshold", &threshold, 0.0001f, 0.1f, "%.4f", ImGuiSliderFlags_Logarithmic)) {
+		setRangeThreshold(threshold);
+	}
+	ImGui::Text("Lights per object: %.2f", m_averageLights);
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include "Light.h"
+#include "Buffer/UBO.h"
+#include <vector>
+#include <memory>
+
+/// <summary>
+/// Uniform buffer with the data of all lights ("Lights" uniform block, shaders/lights.partial.glsl).
+/// Shared by all lighting shaders, the data of a light is uploaded only when the light is dirty.
+/// Every object is lit only by the lights that reach its bounding box (setObjectLights): disabled lights and lights
+/// whose attenuated intensity falls below the range threshold before the box are skipped by the shaders.
+/// </summary>
+class LightUniformBuffer
+{
+public:
+	// must be the same as MAX_LIGHTS in shaders/lights.partial.glsl
+	static const int MAX_LIGHTS = 5;
+	// uniform block binding point used for the "Lights" block
+	static const unsigned int BINDING = 0;
+private:
+	UBO m_ubo;
+	// CPU copy of the buffer
+	Light::UniformData m_data[MAX_LIGHTS];
+	// the light range ends where its attenuated intensity falls below this value
+	float m_rangeThreshold = 0.01f;
+	// range of every light for the threshold (0 = lights nothing)
+	float m_ranges[MAX_LIGHTS];
+
+	// objects drawn and lights in their lists since the last update (shown in the UI)
+	int m_objectCount = 0;
+	int m_objectLightCount = 0;
+	float m_averageLights = 0.0f;
+
+	// range of a light (0 if disabled, FLT_MAX for directional lights)
+	float getRange(const Light::UniformData& data) const;
+public:
+	LightUniformBuffer();
+
+	/// <summary>
+	/// Bind the "Lights" block of the shader to the binding point of the buffer (call once per shader)
+	/// </summary>
+	static void bindShader(Shader& shader);
+
+	/// <summary>
+	/// Bind the buffer and upload the data of the dirty lights with a single glBufferSubData
+	/// </summary>
+	void update(const std::vector<std::unique_ptr<Light>>& lights);
+
+	/// <summary>
+	/// Get the lights reaching a world space box: enabled lights whose range overlaps the box (and spotlights whose
+	/// cone overlaps it), at most MAX_LIGHTS
+	/// </summary>
+	/// <param name="indices">: filled with the indices of the lights in the "Lights" block</param>
+	/// <returns>the number of lights</returns>
+	int getObjectLights(const glm::vec3& min, const glm::vec3& max, int indices[MAX_LIGHTS]) const;
+
+	/// <summary>
+	/// Set the lights of the object drawn next (u_numLights and u_lightIndices, see getObjectLights)
+	/// </summary>
+	/// <param name="min">: world space bounding box of the object</param>
+	void setObjectLights(Shader& shader, const glm::vec3& min, const glm::vec3& max);
+
+	/// <summary>
+	/// Set the intensity at which the light ranges end (the ranges are computed again)
+	/// </summary>
+	void setRangeThreshold(float threshold);
+
+	/// <summary>
+	/// Draw the UI in ImGui: range threshold and average lights per object
+	/// </summary>
+	void imGuiRender();
+};
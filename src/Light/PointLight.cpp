@@ -52,7 +52,34 @@ void PointLight::calculateLightSpaceMatrix()
 				m_parameters.far_plane) *
 			glm::lookAt(m_position, m_position + look_directions[i], up_directions[i])
 		);
+
+		// frustum planes of the face, used for culling
+		getFrustumPlanes(m_lightSpaceMatrix[i], m_facePlanes[i]);
+	}
+}
+
+int PointLight::getCellMask(const glm::vec3& min, const glm::vec3& max) const
+{
+	int mask = 0;
+	for (int face = 0; face < 6; ++face) {
+		if (isBoxInFrustum(m_facePlanes[face], min, max)) {
+			mask |= 1 << face;
+		}
 	}
+	return mask;
+}
+
+void PointLight::setCubeShadowUniforms(Shader& shader)
+{
+	static const Uniform faceMatrices[6] = {
+		"u_lightSpaceMatrices[0]", "u_lightSpaceMatrices[1]", "u_lightSpaceMatrices[2]",
+		"u_lightSpaceMatrices[3]", "u_lightSpaceMatrices[4]", "u_lightSpaceMatrices[5]"
+	};
+	for (int face = 0; face < 6; ++face) {
+		shader.setMat4(faceMatrices[face], m_lightSpaceMatrix[face]);
+	}
+	shader.setVec3("u_lightPos", m_position);
+	shader.setFloat("u_farPlane", m_parameters.far_plane);
 }
 
 void PointLight::imGuiRender()
@@ -62,8 +89,11 @@ void PointLight::imGuiRender()
 	if (ImGui::DragFloat3("Position", &m_position.x, 0.01f)) {
 		calculateLightSpaceMatrix();
 		m_shadowNeedsRender = true;
+		m_dirty = true;
+	}
+	if (ImGui::SliderFloat3("Attenuation", &m_attenuation[0], 0.0f, 1.0f, "%.3f", ImGuiSliderFlags_Logarithmic)) {
+		m_dirty = true;
 	}
-	ImGui::SliderFloat3("Attenuation", &m_attenuation[0], 0.0f, 1.0f, "%.3f", ImGuiSliderFlags_Logarithmic);
 
 	// UI for light view projection parameters
 	ImGui::PushStyleColor(ImGuiCol_Header, ImVec4(0.1f, 0.25f, 0.25f, 1.0f)); // Set header color
@@ -71,31 +101,39 @@ void PointLight::imGuiRender()
 		if (ImGui::DragFloat("Aspect", &m_parameters.aspect, 0.001f, 0.001f, 50.0f)) {
 			calculateLightSpaceMatrix();
 			m_shadowNeedsRender = true;
+			m_dirty = true;
 		}
 		if (ImGui::DragFloat("Near plane", &m_parameters.near_plane, 0.001f, 0.001f, 50.0f)) {
 			calculateLightSpaceMatrix();
 			m_shadowNeedsRender = true;
+			m_dirty = true;
 		}
 		if (ImGui::DragFloat("Far plane", &m_parameters.far_plane, 0.001f, 0.001f, 50.0f)) {
 			calculateLightSpaceMatrix();
 			m_shadowNeedsRender = true;
+			m_dirty = true;
 		}
 	}
 	ImGui::PopStyleColor();
 }
 
-void PointLight::setUniforms(Shader& shader)
+void PointLight::getUniformData(UniformData& data) const
 {
-	shader.setVec4(formatAttribute("position"), m_modelMatrix * glm::vec4(m_position, 1.0f));
-	shader.setFloat(formatAttribute("intensity"), m_intensity);
-	shader.setVec3(formatAttribute("color"), m_color);
-	shader.setBool(formatAttribute("enabled"), m_enabled);
-	shader.setVec3(formatAttribute("attenuation"), m_attenuation);
-	shader.setVec3(formatAttribute("target"), glm::vec3(0.0f));
-	shader.setFloat(formatAttribute("cutOff"), glm::cos(glm::radians(0.0f)));
-	shader.setFloat(formatAttribute("outerCutOff"), glm::cos(glm::radians(0.0f)));
-	shader.setInt(formatAttribute("shadowMapCube"), m_shadowTextureSlot);
-	shader.setBool(formatAttribute("shadow"), m_shadow);
-	shader.setFloat(formatAttribute("farPlane"), m_parameters.far_plane);
-	shader.setInt(formatAttribute("type"), 2);
+	data.lightSpaceMatrix = glm::mat4(1.0f); // not used, point lights sample a cubemap
+	data.position = m_modelMatrix * glm::vec4(m_position, 1.0f);
+	data.color = m_color;
+	data.intensity = m_intensity;
+	data.attenuation = m_attenuation;
+	data.cutOff = glm::cos(glm::radians(0.0f));
+	data.target = glm::vec3(0.0f);
+	data.outerCutOff = glm::cos(glm::radians(0.0f));
+	data.type = 2;
+	data.enabled = m_enabled;
+	data.shadow = m_shadow;
+	data.farPlane = m_parameters.far_plane;
+	data.shadowFilterRadius = m_shadowFilterRadius;
+	data.shadowLightSize = m_shadowLightSize;
+	data.nearPlane = m_parameters.near_plane;
+	data.shadowRect = m_shadowRect;
+	applyShadowState(data);
 }
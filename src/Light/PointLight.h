@@ -11,6 +11,11 @@ private:
 	/// attenuation factors: constant, linear, quadratic
 	/// </summary>
 	glm::vec3 m_attenuation = glm::vec3(1.0f, 0.1f, 0.04f);
+
+	/// <summary>
+	/// frustum planes of every cube face (xyz = normal pointing inside, w = distance), used for culling
+	/// </summary>
+	glm::vec4 m_facePlanes[6][6];
 public:
 	/// <summary>
 	/// Constructs a new point light derived from Light class
@@ -21,14 +26,35 @@ public:
 
 	void calculateLightSpaceMatrix() override;
 
+	/// <summary>
+	/// The 6 faces are stored in 3x2 cells: +X -X +Y / -Y +Z -Z
+	/// </summary>
+	glm::ivec2 getShadowCells() const override { return glm::ivec2(3, 2); }
+
+	/// <summary>
+	/// Get the cube faces whose frustum overlaps a world space box (bit i set = face i, 0 = not in any face)
+	/// </summary>
+	int getCellMask(const glm::vec3& min, const glm::vec3& max) const override;
+
+	/// <summary>
+	/// Set the uniforms of the single pass cube shadow shader (shadowmap_cube.geom):
+	/// the matrices of all faces, light position and far plane
+	/// </summary>
+	void setCubeShadowUniforms(Shader& shader);
+
 	/// <summary>
 	/// Draw UI in ImGui
 	/// </summary>
 	void imGuiRender() override;
 
 	/// <summary>
-	/// Sets all uniforms for this light (at m_index)
+	/// Set the attenuation factors: constant, linear, quadratic
+	/// </summary>
+	void setAttenuation(const glm::vec3& attenuation) { m_attenuation = attenuation; m_dirty = true; }
+
+	/// <summary>
+	/// Fills the uniform buffer data for this light
 	/// </summary>
-	void setUniforms(Shader& shader) override;
+	void getUniformData(UniformData& data) const override;
 };
 
@@ -0,0 +1,640 @@
+#include "ShadowAtlas.h"
+#include "PointLight.h"
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+
+ShadowAtlas::ShadowAtlas(int size, int maxTileSize) : m_fbo(size, size), m_staticFbo(size, size), m_size(size), m_maxTileSize(std::min(maxTileSize, size))
+{
+	m_fbo.addDepthAttachment(GL_TEXTURE_2D);
+	m_fbo.create();
+	// same format as the atlas (required to copy depth with glBlitFramebuffer)
+	m_staticFbo.addDepthAttachment(GL_TEXTURE_2D);
+	m_staticFbo.create();
+
+	glGenSamplers(1, &m_depthSampler);
+	glSamplerParameteri(m_depthSampler, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glSamplerParameteri(m_depthSampler, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glSamplerParameteri(m_depthSampler, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glSamplerParameteri(m_depthSampler, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glSamplerParameteri(m_depthSampler, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+}
+
+ShadowAtlas::~ShadowAtlas()
+{
+	glDeleteSamplers(1, &m_depthSampler);
+}
+
+void ShadowAtlas::bindShader(Shader& shader)
+{
+	shader.setInt("u_shadowAtlas", SLOT);
+	shader.setInt("u_shadowAtlasDepth", DEPTH_SLOT);
+	shader.setInt("u_shadowMoments", MOMENTS_SLOT);
+}
+
+void ShadowAtlas::setUniforms(Shader& shader) const
+{
+	shader.setKeyword("SHADOW_COMPARE", m_hardwareCompare);
+	shader.setKeyword("SHADOW_PCF", m_filter == Filter::PCF);
+	shader.setKeyword("SHADOW_PCSS", m_filter == Filter::PCSS);
+	shader.setKeyword("SHADOW_VSM", m_filter == Filter::VSM);
+	shader.setKeyword("SHADOW_EVSM", m_filter == Filter::EVSM);
+	if (m_filter == Filter::PCF || m_filter == Filter::PCSS) {
+		shader.setInt("u_shadowSamples", m_filterSamples);
+	}
+}
+
+void ShadowAtlas::setFilter(Filter filter, int samples)
+{
+	Filter previous = m_filter;
+	m_filter = filter;
+	m_filterSamples = std::max(1, std::min(samples, 32));
+	if (usesMoments() && m_filter != previous) {
+		if (m_momentsFilter != m_filter) {
+			createMoments();
+		}
+		// the moments of a tile are computed when it is rendered
+		m_forceRender = true;
+	}
+}
+
+void ShadowAtlas::createMoments()
+{
+	m_momentsFilter = m_filter;
+	unsigned int format = m_filter == Filter::EVSM ? GL_RGBA16F : GL_RG32F;
+	m_momentsFbo = Framebuffer(m_size, m_size);
+	m_momentsFbo.addColorAttachament(GL_TEXTURE_2D, format, true);
+	m_momentsFbo.create();
+	m_blurFbo = Framebuffer(m_size, m_size);
+	m_blurFbo.addColorAttachament(GL_TEXTURE_2D, format);
+	m_blurFbo.create();
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, m_momentsFbo.getColorAttachment(0));
+	// the coarsest levels would mix the smallest tiles
+	int levels = 0;
+	while ((MIN_TILE_SIZE >> levels) > 4) {
+		++levels;
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels);
+	if (GLEW_EXT_texture_filter_anisotropic) {
+		float maxAnisotropy = 1.0f;
+		glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &maxAnisotropy);
+		glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, std::min(maxAnisotropy, MAX_ANISOTROPY));
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void ShadowAtlas::setHardwareCompare(bool enabled)
+{
+	if (enabled == m_hardwareCompare) {
+		return;
+	}
+	m_hardwareCompare = enabled;
+	m_forceRender = true;
+	// sampling a depth texture with compare mode through a sampler2D is undefined, set it with the keyword
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, getTexture());
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, enabled ? GL_COMPARE_REF_TO_TEXTURE : GL_NONE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+int ShadowAtlas::getCellSize(const Light::UniformData& data, const glm::ivec2& cells, const glm::mat4& view, const glm::mat4& projection, unsigned int height, int previous) const
+{
+	// the largest cell size whose tile fits in the max tile size (point lights: in the atlas)
+	int maxCellSize = m_maxTileSize;
+	int maxSize = data.type == 2 ? m_size : m_maxTileSize;
+	while (maxCellSize > MIN_TILE_SIZE && (cells.x * maxCellSize > maxSize || cells.y * maxCellSize > maxSize)) {
+		maxCellSize /= 2;
+	}
+
+	// directional lights cover the whole view
+	if (data.type == 0) {
+		return maxCellSize;
+	}
+
+	// bounding sphere of the light volume (up to the far plane of the shadow projection)
+	glm::vec3 center = glm::vec3(data.position);
+	float radius = data.farPlane;
+	if (data.type == 1) {
+		// spotlight: sphere around the pyramid of the projection (half angle = outer cut off)
+		float halfLength = 0.5f * data.farPlane;
+		float side = data.farPlane * std::min(std::tan(std::acos(data.outerCutOff)), 10.0f);
+		center += glm::normalize(data.target - center) * halfLength;
+		radius = std::sqrt(halfLength * halfLength + 2.0f * side * side);
+	}
+
+	// size of the sphere on screen in pixels
+	float diameter = 0.0f;
+	glm::vec3 viewCenter = glm::vec3(view * glm::vec4(center, 1.0f));
+	glm::vec4 clip = projection * glm::vec4(viewCenter, 1.0f);
+	bool perspective = projection[2][3] != 0.0f;
+	if (glm::length(viewCenter) <= radius || (perspective && clip.w < radius && clip.w >= -radius)) {
+		// the camera is inside (or next to) the volume
+		diameter = FLT_MAX;
+	}
+	else if (!perspective || clip.w > 0.0f) {
+		float w = perspective ? clip.w : 1.0f;
+		glm::vec2 ndc = glm::vec2(clip) / w;
+		glm::vec2 ndcRadius = radius * glm::vec2(projection[0][0], projection[1][1]) / w;
+		bool visible = std::abs(ndc.x) - ndcRadius.x <= 1.0f && std::abs(ndc.y) - ndcRadius.y <= 1.0f;
+		diameter = visible ? ndcRadius.y * height : 0.0f;
+	}
+
+	// a face of a point light sees about half of the sphere
+	float desired = diameter * m_resolutionScale * (data.type == 2 ? 0.5f : 1.0f);
+	int size = MIN_TILE_SIZE;
+	while (size < desired && size < maxCellSize) {
+		size *= 2;
+	}
+	// shrink only when the desired size is well below the current one (no repacking back and forth)
+	if (previous == 2 * size && previous <= maxCellSize && desired > 0.375f * previous) {
+		size = previous;
+	}
+	return size;
+}
+
+bool ShadowAtlas::updateCaster(Caster& caster, const glm::mat4& modelMatrix)
+{
+	if (caster.modelMatrix == modelMatrix) {
+		return false;
+	}
+	caster.modelMatrix = modelMatrix;
+	if (caster.dynamic) {
+		m_dynamicMoved = true;
+	}
+	else {
+		m_invalidate = true;
+	}
+	return true;
+}
+
+void ShadowAtlas::update(const std::vector<std::unique_ptr<Light>>& lights, const glm::mat4& view, const glm::mat4& projection, unsigned int height)
+{
+	std::vector<glm::ivec3> requests(lights.size(), glm::ivec3(0));
+	bool repack = false;
+	for (size_t i = 0; i < lights.size(); ++i) {
+		Light::UniformData data;
+		lights[i]->getUniformData(data);
+		if (!data.enabled || !data.shadow) {
+			continue;
+		}
+		glm::ivec2 cells = lights[i]->getShadowCells();
+		int previous = i < m_requests.size() ? m_requests[i].x : 0;
+		requests[i] = glm::ivec3(getCellSize(data, cells, view, projection, height, previous), cells);
+		// a new light (e.g. the light type changed) has no tile yet
+		repack |= lights[i]->getShadowViewport().z == 0;
+	}
+	repack |= requests != m_requests;
+	// lights whose tile moved must be rendered this frame (their old shadow map is gone)
+	std::vector<bool> required(lights.size(), m_forceRender);
+	if (repack) {
+		std::vector<glm::ivec4> previousViewports(lights.size());
+		for (size_t i = 0; i < lights.size(); ++i) {
+			previousViewports[i] = lights[i]->getShadowViewport();
+		}
+		m_requests = requests;
+		pack(lights);
+		for (size_t i = 0; i < lights.size(); ++i) {
+			if (lights[i]->getShadowViewport() != previousViewports[i]) {
+				required[i] = true;
+			}
+		}
+	}
+
+	for (size_t i = 0; i < lights.size(); ++i) {
+		if (lights[i]->getShadowViewport().z != 0) {
+			lights[i]->fitShadowToCamera(view, projection);
+		}
+		// the cached static casters are out of date
+		if (m_invalidate || m_forceRender) {
+			lights[i]->invalidateShadow();
+		}
+	}
+	m_renderDynamic = m_dynamicMoved;
+	schedule(lights, required);
+	m_invalidate = false;
+	m_forceRender = false;
+	m_dynamicMoved = false;
+}
+
+int ShadowAtlas::countCells(int cells)
+{
+	int count = 0;
+	for (; cells != 0; cells &= cells - 1) {
+		++count;
+	}
+	return count;
+}
+
+void ShadowAtlas::schedule(const std::vector<std::unique_ptr<Light>>& lights, const std::vector<bool>& required)
+{
+	size_t count = lights.size();
+	m_staleStaticCells.resize(count, 0);
+	m_staleCells.resize(count, 0);
+	m_staleFrames.resize(count, 0);
+	m_nextFace.resize(count, 0);
+	m_scheduledCells.assign(count, 0);
+	m_scheduledStaticCells.assign(count, 0);
+
+	// collect the out of date cells, the lights that must be rendered now don't count for the budget
+	int budget = m_cellBudget > 0 ? m_cellBudget : INT_MAX;
+	std::vector<size_t> waiting;
+	for (size_t i = 0; i < count; ++i) {
+		Light& light = *lights[i];
+		if (!light.getShadow() || light.getShadowViewport().z == 0) {
+			m_staleStaticCells[i] = m_staleCells[i] = m_staleFrames[i] = 0;
+			continue;
+		}
+		glm::ivec2 cells = light.getShadowCells();
+		int allCells = (1 << (cells.x * cells.y)) - 1;
+		if (light.getShadowNeedsRender()) {
+			m_staleStaticCells[i] = allCells;
+			light.resetShadowNeedsRender();
+		}
+		m_staleStaticCells[i] &= allCells;
+		m_staleCells[i] = (m_staleCells[i] | m_staleStaticCells[i] | (m_renderDynamic ? allCells : 0)) & allCells;
+		if (required[i]) {
+			m_scheduledCells[i] = allCells;
+		}
+		else if (m_staleCells[i] != 0) {
+			waiting.push_back(i);
+		}
+	}
+
+	// the largest tiles (most pixels on screen) first, lights that waited longer move up
+	std::stable_sort(waiting.begin(), waiting.end(), [&](size_t a, size_t b) {
+		return m_requests[a].x * (1 + m_staleFrames[a]) > m_requests[b].x * (1 + m_staleFrames[b]);
+	});
+	bool progress = false;
+	for (size_t i : waiting) {
+		if (budget <= 0) {
+			break;
+		}
+		if (lights[i]->getType() == Light::Type::POINT) {
+			// faces in turns, starting after the last face updated
+			for (int n = 0; n < 6 && budget > 0; ++n) {
+				int face = (m_nextFace[i] + n) % 6;
+				if (m_staleCells[i] & (1 << face)) {
+					m_scheduledCells[i] |= 1 << face;
+					m_nextFace[i] = (face + 1) % 6;
+					--budget;
+				}
+			}
+		}
+		else {
+			// all cascades together (they share the shadow state of the light), at least one light per frame
+			glm::ivec2 cells = lights[i]->getShadowCells();
+			int allCells = (1 << (cells.x * cells.y)) - 1;
+			if (countCells(allCells) > budget && progress) {
+				continue;
+			}
+			m_scheduledCells[i] = allCells;
+			budget -= countCells(allCells);
+		}
+		progress = true;
+	}
+
+	m_backlog = 0;
+	m_renderedCells = 0;
+	for (size_t i = 0; i < count; ++i) {
+		m_scheduledStaticCells[i] = m_staleStaticCells[i] & m_scheduledCells[i];
+		m_staleStaticCells[i] &= ~m_scheduledCells[i];
+		m_staleCells[i] &= ~m_scheduledCells[i];
+		m_staleFrames[i] = m_staleCells[i] != 0 ? m_staleFrames[i] + 1 : 0;
+		m_backlog += countCells(m_staleCells[i]);
+		m_renderedCells += countCells(m_scheduledCells[i]);
+	}
+}
+
+void ShadowAtlas::pack(const std::vector<std::unique_ptr<Light>>& lights)
+{
+	std::vector<int> cellSizes(m_requests.size());
+	for (size_t i = 0; i < m_requests.size(); ++i) {
+		cellSizes[i] = m_requests[i].x;
+	}
+	std::vector<glm::ivec4> viewports;
+	auto tileSize = [&](size_t i) {
+		return cellSizes[i] * glm::ivec2(m_requests[i].y, m_requests[i].z);
+	};
+
+	while (true) {
+		// largest tiles first (by height, then width)
+		std::vector<size_t> order;
+		for (size_t i = 0; i < cellSizes.size(); ++i) {
+			if (cellSizes[i] > 0) {
+				order.push_back(i);
+			}
+		}
+		std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+			glm::ivec2 sizeA = tileSize(a), sizeB = tileSize(b);
+			return sizeA.y > sizeB.y || (sizeA.y == sizeB.y && sizeA.x > sizeB.x);
+		});
+
+		// fill shelves from the bottom left, a new shelf starts when a tile doesn't fit in the row
+		viewports.assign(cellSizes.size(), glm::ivec4(0));
+		int x = 0, y = 0, shelfHeight = 0;
+		bool fits = true;
+		for (size_t i : order) {
+			glm::ivec2 size = tileSize(i);
+			if (x + size.x > m_size) {
+				y += shelfHeight;
+				x = 0;
+				shelfHeight = 0;
+			}
+			if (y + size.y > m_size) {
+				fits = false;
+				break;
+			}
+			viewports[i] = glm::ivec4(x, y, size.x, size.y);
+			x += size.x;
+			shelfHeight = std::max(shelfHeight, size.y);
+		}
+		if (fits) {
+			break;
+		}
+		// halve the largest cells, if all are at the minimum the lights that were not placed have no shadows
+		auto largest = std::max_element(cellSizes.begin(), cellSizes.end());
+		if (*largest <= MIN_TILE_SIZE) {
+			break;
+		}
+		*largest /= 2;
+	}
+
+	m_usedArea = 0;
+	for (size_t i = 0; i < lights.size(); ++i) {
+		const glm::ivec4& viewport = viewports[i];
+		glm::vec4 rect(0.0f);
+		if (viewport.z != 0) {
+			rect = glm::vec4(viewport.x, viewport.y, cellSizes[i], cellSizes[i]) / (float)m_size;
+		}
+		lights[i]->setShadowTile(viewport, rect);
+		m_usedArea += viewport.z * viewport.w;
+	}
+	m_viewports = viewports;
+}
+
+void ShadowAtlas::begin()
+{
+	m_fbo.bind();
+	glEnable(GL_SCISSOR_TEST);
+	// slope scaled bias: the compare filters 4 texels, which see different depths on surfaces at grazing angles
+	if (m_hardwareCompare) {
+		glEnable(GL_POLYGON_OFFSET_FILL);
+		glPolygonOffset(POLYGON_OFFSET_FACTOR, POLYGON_OFFSET_UNITS);
+	}
+}
+
+void ShadowAtlas::beginStaticTile(const Light& light, int cells)
+{
+	const glm::ivec4& viewport = light.getShadowViewport();
+	m_staticFbo.bind();
+	setTile(light);
+	// clear only the cells rendered this frame
+	for (int cell = 0; cells >> cell != 0; ++cell) {
+		if (cells & (1 << cell)) {
+			glm::ivec4 rect = getCellViewport(light, cell);
+			glScissor(rect.x, rect.y, rect.z, rect.w);
+			glClear(GL_DEPTH_BUFFER_BIT);
+		}
+	}
+	glScissor(viewport.x, viewport.y, viewport.z, viewport.w);
+}
+
+void ShadowAtlas::beginTile(const Light& light, int cells)
+{
+	setTile(light);
+	if (usesMoments()) {
+		m_renderedLights.push_back(&light);
+	}
+	// copy the static casters of the cells rendered this frame
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_staticFbo.getId());
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_fbo.getId());
+	for (int cell = 0; cells >> cell != 0; ++cell) {
+		if (cells & (1 << cell)) {
+			glm::ivec4 rect = getCellViewport(light, cell);
+			glBlitFramebuffer(rect.x, rect.y, rect.x + rect.z, rect.y + rect.w,
+				rect.x, rect.y, rect.x + rect.z, rect.y + rect.w, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+		}
+	}
+	m_fbo.bind();
+}
+
+void ShadowAtlas::setTile(const Light& light)
+{
+	const glm::ivec4& viewport = light.getShadowViewport();
+	glViewport(viewport.x, viewport.y, viewport.z, viewport.w);
+	glScissor(viewport.x, viewport.y, viewport.z, viewport.w);
+	// the faces of a point light are clipped to their cell of the tile (rendered in one pass)
+	for (int i = 0; i < 4; ++i) {
+		if (light.getType() == Light::Type::POINT) {
+			glEnable(GL_CLIP_DISTANCE0 + i);
+		}
+		else {
+			glDisable(GL_CLIP_DISTANCE0 + i);
+		}
+	}
+}
+
+glm::ivec4 ShadowAtlas::getCellViewport(const Light& light, int cell) const
+{
+	const glm::ivec4& viewport = light.getShadowViewport();
+	int columns = light.getShadowCells().x;
+	int cellSize = viewport.z / columns;
+	return glm::ivec4(viewport.x + (cell % columns) * cellSize, viewport.y + (cell / columns) * cellSize, cellSize, cellSize);
+}
+
+void ShadowAtlas::beginCell(const Light& light, int cell)
+{
+	glm::ivec4 rect = getCellViewport(light, cell);
+	glViewport(rect.x, rect.y, rect.z, rect.w);
+}
+
+void ShadowAtlas::end()
+{
+	m_fbo.bind();
+	glDisable(GL_SCISSOR_TEST);
+	glDisable(GL_POLYGON_OFFSET_FILL);
+	for (int i = 0; i < 4; ++i) {
+		glDisable(GL_CLIP_DISTANCE0 + i);
+	}
+}
+
+void ShadowAtlas::render(const std::vector<std::unique_ptr<Light>>& lights, Shader& shader, Shader& cubeShader, const DrawCasters& drawCasters)
+{
+	begin();
+	glEnable(GL_CULL_FACE);
+	glEnable(GL_DEPTH_TEST);
+	glCullFace(GL_BACK);
+	shader.bind();
+
+	for (size_t i = 0; i < lights.size(); ++i) {
+		// cells of the shadow map rendered this frame: none for lights without shadows (or without a tile),
+		// lights whose shadow map is up to date and lights delayed by the update budget
+		int cells = getScheduledCells(i);
+		if (cells == 0) {
+			continue;
+		}
+		int staticCells = getScheduledStaticCells(i);
+		Light& light = *lights[i];
+		bool point = light.getType() == Light::Type::POINT;
+		// casters drawn to / culled from the cells of the light
+		int castersDrawn = 0, castersCulled = 0;
+
+		// set far plane and light position for this light (used to write distance from light to fragment in texture)
+		shader.setVec3("u_lightPos", light.getPosition());
+		shader.setFloat("u_farPlane", light.getFarPlane());
+		// hardware depth for directional lights (orthographic) and for all lights with hardware compare
+		bool hardwareDepth = m_hardwareCompare || light.getType() == Light::Type::DIRECTIONAL;
+		if (point) {
+			cubeShader.setKeyword("HARDWARE_DEPTH", hardwareDepth);
+			cubeShader.bind();
+			static_cast<PointLight&>(light).setCubeShadowUniforms(cubeShader);
+		}
+		else {
+			shader.setKeyword("HARDWARE_DEPTH", hardwareDepth);
+		}
+
+		// the static casters are drawn to the cache of the atlas only when they or the light changed,
+		// the dynamic casters are drawn over the copy of the cache in the tile of the light
+		for (int dynamic = staticCells != 0 ? 0 : 1; dynamic < 2; ++dynamic) {
+			if (dynamic) {
+				beginTile(light, cells);
+			}
+			else {
+				beginStaticTile(light, staticCells);
+			}
+			if (point) {
+				// all scheduled faces in one pass, the geometry shader places every face in its cell of the tile
+				// and every caster is only drawn to the faces whose frustum contains it
+				int faces = dynamic ? cells : staticCells;
+				drawCasters(cubeShader, [&](const Caster& caster, const glm::mat4& modelMatrix) {
+					if (caster.dynamic != (dynamic != 0)) return false;
+					int faceMask = light.getCellMask(caster.boundsMin, caster.boundsMax) & faces;
+					castersDrawn += countCells(faceMask);
+					castersCulled += countCells(faces) - countCells(faceMask);
+					if (faceMask == 0) return false;
+					cubeShader.setInt("u_faceMask", faceMask);
+					cubeShader.setMat4("u_modelMatrix", modelMatrix);
+					return true;
+				});
+			}
+			else {
+				// one cell per cascade for directional lights (orthographic depth), a single one for spotlights
+				// (always all cells, they are scheduled together)
+				const std::vector<glm::mat4>& matrices = light.getLightSpaceMatrix();
+				for (size_t cell = 0; cell < matrices.size(); ++cell) {
+					beginCell(light, (int)cell);
+					shader.setMat4("u_lightSpaceMatrix", matrices[cell]);
+					drawCasters(shader, [&](const Caster& caster, const glm::mat4& modelMatrix) {
+						if (caster.dynamic != (dynamic != 0)) return false;
+						if ((light.getCellMask(caster.boundsMin, caster.boundsMax) & (1 << cell)) == 0) {
+							++castersCulled;
+							return false;
+						}
+						++castersDrawn;
+						shader.setMat4("u_modelMatrix", modelMatrix);
+						return true;
+					});
+				}
+			}
+		}
+		shader.bind();
+		light.setShadowCasterStats(castersDrawn, castersCulled);
+
+		// the lighting shaders read the shadow map with the projection it was rendered with
+		// (point light faces delayed by the budget keep the position of their last update)
+		light.captureShadowState(cells);
+	}
+	end();
+}
+
+void ShadowAtlas::resolveMoments(Shader& shader, ScreenQuadRenderer& quad)
+{
+	if (!usesMoments() || m_renderedLights.empty()) {
+		m_renderedLights.clear();
+		return;
+	}
+	shader.setKeyword("SHADOW_COMPARE", m_hardwareCompare);
+	shader.setKeyword("SHADOW_EVSM", m_filter == Filter::EVSM);
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_CULL_FACE);
+	for (const Light* light : m_renderedLights) {
+		Light::UniformData data;
+		light->getUniformData(data);
+		shader.setInt("u_lightType", data.type);
+		shader.setFloat("u_nearPlane", data.nearPlane);
+		shader.setFloat("u_farPlane", data.farPlane);
+		shader.setFloat("u_blurRadius", data.shadowFilterRadius);
+
+		glm::ivec2 cells = light->getShadowCells();
+		for (int cell = 0; cell < cells.x * cells.y; ++cell) {
+			glm::ivec4 rect = getCellViewport(*light, cell);
+			glViewport(rect.x, rect.y, rect.z, rect.w);
+			shader.setVec4("u_cell", glm::vec4(rect));
+			// depth to moments, horizontal blur (the sampler object disables the depth compare)
+			m_blurFbo.bind();
+			shader.setKeyword("DEPTH_INPUT", true);
+			glBindSampler(0, m_depthSampler);
+			quad.render(getTexture(), shader);
+			glBindSampler(0, 0);
+			// vertical blur
+			m_momentsFbo.bind();
+			shader.setKeyword("DEPTH_INPUT", false);
+			quad.render(m_blurFbo.getColorAttachment(0), shader);
+		}
+	}
+	glEnable(GL_DEPTH_TEST);
+	glEnable(GL_CULL_FACE);
+	m_momentsFbo.generateMipmaps(0);
+	m_renderedLights.clear();
+}
+
+void ShadowAtlas::bindTexture() const
+{
+	glActiveTexture(GL_TEXTURE0 + SLOT);
+	glBindTexture(GL_TEXTURE_2D, getTexture());
+	// the sampler object overrides the compare mode of the texture
+	if (m_filter == Filter::PCSS && m_hardwareCompare) {
+		glActiveTexture(GL_TEXTURE0 + DEPTH_SLOT);
+		glBindTexture(GL_TEXTURE_2D, getTexture());
+		glBindSampler(DEPTH_SLOT, m_depthSampler);
+	}
+	if (usesMoments()) {
+		glActiveTexture(GL_TEXTURE0 + MOMENTS_SLOT);
+		glBindTexture(GL_TEXTURE_2D, m_momentsFbo.getColorAttachment(0));
+	}
+}
+
+void ShadowAtlas::imGuiRender()
+{
+	// the tiles get their new size in the next update
+	ImGui::SliderFloat("Shadow resolution scale", &m_resolutionScale, 0.125f, 4.0f, "%.3f", ImGuiSliderFlags_Logarithmic);
+	bool hardwareCompare = m_hardwareCompare;
+	if (ImGui::Checkbox("Hardware shadow compare", &hardwareCompare)) {
+		setHardwareCompare(hardwareCompare);
+	}
+	// filter kernel sizes are set per light
+	int filter = (int)m_filter;
+	bool changed = ImGui::Combo("Shadow filter", &filter, "Hard\0Poisson PCF\0PCSS\0VSM\0EVSM\0\0");
+	if (filter == (int)Filter::PCF || filter == (int)Filter::PCSS) {
+		changed |= ImGui::SliderInt("Shadow filter samples", &m_filterSamples, 1, 32);
+	}
+	if (changed) {
+		setFilter((Filter)filter, m_filterSamples);
+	}
+	// 0 = render every out of date shadow map in the same frame
+	if (ImGui::SliderInt("Shadow updates per frame", &m_cellBudget, 0, 24, m_cellBudget == 0 ? "no limit" : "%d cells")) {
+		setCellBudget(m_cellBudget);
+	}
+	ImGui::Text("Shadow cells rendered: %d, waiting: %d", m_renderedCells, m_backlog);
+	ImGui::Text("Shadow atlas %dx%d, %.1f%% used", m_size, m_size, 100.0f * m_usedArea / ((float)m_size * m_size));
+	for (size_t i = 0; i < m_viewports.size(); ++i) {
+		if (m_viewports[i].z != 0) {
+			int waiting = i < m_staleCells.size() ? countCells(m_staleCells[i]) : 0;
+			ImGui::Text("  Light #%d: %dx%d, %d cells waiting for %d frames", (int)i, m_viewports[i].z, m_viewports[i].w, waiting, waiting != 0 ? m_staleFrames[i] : 0);
+		}
+	}
+}
@@ -0,0 +1,287 @@
+#pragma once
+#include "Light.h"
+#include "Framebuffer.h"
+#include "Postprocess/ScreenQuadRenderer.h"
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <functional>
+
+/// <summary>
+/// Shadow maps of all lights in one depth texture (shaders/shadows.partial.glsl). Every light casting shadows gets
+/// a tile, split in cells when it has more than one shadow map (Light::getShadowCells: point light faces,
+/// directional light cascades). The tile size follows the size of the light volume on screen (power of two between
+/// MIN_TILE_SIZE and the max tile size), the tiles are packed in shelves and packed again only when a size changes.
+/// Lights whose tile moved must render their shadow map again.
+/// Static casters are rendered into a second depth texture (the cache) only when the light or a static caster
+/// changes. The shadow maps are a copy of the cache with the dynamic casters drawn over it, so when only dynamic
+/// casters move the static ones are not drawn again.
+/// With hardware compare the shadow maps store the depth of the light projections (no gl_FragDepth writes) and the
+/// shaders read them with a sampler2DShadow, else they store squared distances compared in the shader.
+/// The shadows are filtered with one hard tap, rotated Poisson disk PCF or PCSS (kernel sizes are set per light).
+/// A scheduler limits the cells (shadow maps) rendered per frame: out of date lights are ordered by the size of
+/// their tile (their influence on screen) times the frames they waited, point light faces are updated in turns.
+/// Tiles that moved and changes of the depth format are always rendered.
+/// VSM and EVSM convert the rendered tiles to moments in a second texture with the same layout (resolveMoments):
+/// blurred once per shadow texel and mipmapped, then read with trilinear and anisotropic filtering.
+/// </summary>
+class ShadowAtlas
+{
+public:
+	// texture slot of the atlas (before ClusteredLights::LIGHTS_SLOT)
+	static const unsigned int SLOT = 8;
+	// the atlas without depth compare, read by the PCSS blocker search with hardware compare
+	static const unsigned int DEPTH_SLOT = 9;
+	// moments of the atlas for VSM/EVSM (after ShadowMask::DISTANCE_SLOT)
+	static const unsigned int MOMENTS_SLOT = 12;
+	// tile size of lights whose volume is not visible
+	static const int MIN_TILE_SIZE = 64;
+
+	enum class Filter {
+		HARD, PCF, PCSS, VSM, EVSM
+	};
+
+	/// <summary>
+	/// Shadow caster state kept by the scene for every object (see updateCaster)
+	/// </summary>
+	struct Caster {
+		// dynamic casters are drawn every frame one of them moved, static casters are cached
+		bool dynamic = false;
+		// model matrix in the last update
+		glm::mat4 modelMatrix = glm::mat4(0.0f);
+		// world space bounding box, used to cull the caster per light (Light::getCellMask), updated by the scene when it moved
+		glm::vec3 boundsMin = glm::vec3(0.0f);
+		glm::vec3 boundsMax = glm::vec3(0.0f);
+	};
+
+	// called by the scene for every caster before drawing it: false if the caster is not drawn in this pass
+	// (other classification or outside the cells rendered), else its model matrix is set in the shader
+	using CasterFilter = std::function<bool(const Caster& caster, const glm::mat4& modelMatrix)>;
+	// draws the casters of the scene with the shader, skipping those rejected by the filter
+	using DrawCasters = std::function<void(Shader& shader, const CasterFilter& filter)>;
+private:
+	Framebuffer m_fbo;
+	// depth of the static casters of every tile
+	Framebuffer m_staticFbo;
+	int m_size;
+	int m_maxTileSize;
+
+	// tile size = size on screen (pixels) * scale
+	float m_resolutionScale = 1.0f;
+
+	// hardware depth and depth compare sampling (SHADOW_COMPARE keyword)
+	bool m_hardwareCompare = false;
+	// sampler object of DEPTH_SLOT (no compare, nearest)
+	unsigned int m_depthSampler = 0;
+
+	// soft shadow filter (SHADOW_PCF, SHADOW_PCSS, SHADOW_VSM, SHADOW_EVSM keywords) and its number of taps
+	Filter m_filter = Filter::PCF;
+	int m_filterSamples = 16;
+
+	// VSM: RG32F, EVSM: RGBA16F moments with mipmaps (created when the filter is selected)
+	Framebuffer m_momentsFbo;
+	// moments after the horizontal blur
+	Framebuffer m_blurFbo;
+	// filter of the moments framebuffers (HARD = not created)
+	Filter m_momentsFilter = Filter::HARD;
+	// lights whose tile was rendered since the last resolveMoments
+	std::vector<const Light*> m_renderedLights;
+	// anisotropic filtering of the moments (1 = off)
+	static constexpr float MAX_ANISOTROPY = 8.0f;
+
+	// glPolygonOffset of the shadow pass with hardware compare
+	static constexpr float POLYGON_OFFSET_FACTOR = 2.0f;
+	static constexpr float POLYGON_OFFSET_UNITS = 4.0f;
+
+	// requested cell size and cells (columns, rows) of every light in the list (0 = no tile),
+	// the atlas is packed again when one changes
+	std::vector<glm::ivec3> m_requests;
+	// tiles assigned by the last pack (same order as the lights) and the pixels they use
+	std::vector<glm::ivec4> m_viewports;
+	int m_usedArea = 0;
+
+	// all shadow maps must be rendered again (a static caster moved)
+	bool m_invalidate = false;
+	// all shadow maps must be rendered in the next update, without waiting for the scheduler (the depth mode changed)
+	bool m_forceRender = false;
+	// a dynamic caster moved since the last update
+	bool m_dynamicMoved = false;
+	// the dynamic casters of all lights must be drawn again (in the next update)
+	bool m_renderDynamic = true;
+
+	// cells rendered per frame by the scheduler (0 = no limit)
+	int m_cellBudget = 0;
+	// per light (same order as the lights), bit i = cell i: cells whose static casters / shadow map are out of date
+	std::vector<int> m_staleStaticCells;
+	std::vector<int> m_staleCells;
+	// frames the light waited with out of date cells
+	std::vector<int> m_staleFrames;
+	// next point light face to update
+	std::vector<int> m_nextFace;
+	// cells to render this frame (and cells whose static casters are drawn first)
+	std::vector<int> m_scheduledCells;
+	std::vector<int> m_scheduledStaticCells;
+	// out of date cells left for the next frames, and cells rendered this frame
+	int m_backlog = 0;
+	int m_renderedCells = 0;
+
+	// cell size for the light from the size of its volume on screen (previous = its last cell size, 0 if none)
+	int getCellSize(const Light::UniformData& data, const glm::ivec2& cells, const glm::mat4& view, const glm::mat4& projection, unsigned int height, int previous) const;
+
+	// place the tiles of the lights, halving the largest ones until all fit
+	void pack(const std::vector<std::unique_ptr<Light>>& lights);
+
+	// choose the cells rendered this frame (required = lights whose tile must be rendered now)
+	void schedule(const std::vector<std::unique_ptr<Light>>& lights, const std::vector<bool>& required);
+
+	// set viewport, scissor and clip distances for the tile of the light
+	void setTile(const Light& light);
+
+	// cell of the tile of the light in pixels (x, y, width, height)
+	glm::ivec4 getCellViewport(const Light& light, int cell) const;
+
+	bool usesMoments() const { return m_filter == Filter::VSM || m_filter == Filter::EVSM; }
+
+	// create the moments framebuffers in the format of the filter
+	void createMoments();
+public:
+	/// <summary>
+	/// Create the depth texture of the atlas
+	/// </summary>
+	/// <param name="size">: width and height of the atlas in pixels</param>
+	/// <param name="maxTileSize">: size of the largest tile (directional lights always get this size)</param>
+	ShadowAtlas(int size, int maxTileSize);
+	~ShadowAtlas();
+	ShadowAtlas(const ShadowAtlas& o) = delete;
+	ShadowAtlas& operator=(const ShadowAtlas& o) = delete;
+
+	/// <summary>
+	/// Set the atlas samplers (call once per shader)
+	/// </summary>
+	static void bindShader(Shader& shader);
+
+	/// <summary>
+	/// Set the compare and filter keywords of a shader reading the atlas and the number of filter taps (call before drawing)
+	/// </summary>
+	void setUniforms(Shader& shader) const;
+
+	/// <summary>
+	/// Set the shadow filter: one hard tap, rotated Poisson disk PCF, PCSS or the filtered moments of VSM/EVSM
+	/// (switching to VSM/EVSM renders all shadow maps again)
+	/// </summary>
+	/// <param name="samples">: taps of the Poisson disk (PCF, and blocker search + PCF for PCSS), at most 32</param>
+	void setFilter(Filter filter, int samples);
+
+	/// <summary>
+	/// Store hardware depth and sample it with depth compare (GL_COMPARE_REF_TO_TEXTURE, bilinear PCF),
+	/// or squared distances compared in the shader. All shadow maps are rendered again.
+	/// </summary>
+	void setHardwareCompare(bool enabled);
+
+	/// <summary>
+	/// Check if the shadow maps store hardware depth: the shadow shaders must not write gl_FragDepth
+	/// (HARDWARE_DEPTH keyword of shadowmap.frag, always set for directional lights)
+	/// </summary>
+	bool getHardwareCompare() const { return m_hardwareCompare; }
+
+	/// <summary>
+	/// Call every frame for every shadow caster before update. A moved static caster invalidates the cache of all
+	/// lights, a moved dynamic caster makes all lights draw their dynamic casters again.
+	/// </summary>
+	/// <param name="caster">: state of the caster (classification and last model matrix)</param>
+	/// <param name="modelMatrix">: current model matrix of the caster</param>
+	/// <returns>true if the caster moved (its bounds must be updated)</returns>
+	bool updateCaster(Caster& caster, const glm::mat4& modelMatrix);
+
+	/// <summary>
+	/// Choose the tile size of every enabled light casting shadows, assign the tiles (Light::setShadowTile),
+	/// fit the shadow projections to the camera (Light::fitShadowToCamera) and schedule the cells rendered this frame
+	/// (takes over Light::getShadowNeedsRender). Call every frame before the shadow pass.
+	/// </summary>
+	/// <param name="view">: view matrix of the camera</param>
+	/// <param name="projection">: projection matrix of the camera</param>
+	/// <param name="height">: height of the framebuffer in pixels</param>
+	void update(const std::vector<std::unique_ptr<Light>>& lights, const glm::mat4& view, const glm::mat4& projection, unsigned int height);
+
+	/// <summary>
+	/// Shadow pass: render the cells scheduled by update for every light (the static casters to the cache when
+	/// needed, then the dynamic casters over its copy), record the caster stats and the shadow state of the lights.
+	/// Call after update, then resolveMoments.
+	/// </summary>
+	/// <param name="shader">: shader with shadowmap.frag for spotlights and directional lights</param>
+	/// <param name="cubeShader">: shader with shadowmap_cube.geom for point lights</param>
+	/// <param name="drawCasters">: draws all shadow casters of the scene (called once per pass and cell)</param>
+	void render(const std::vector<std::unique_ptr<Light>>& lights, Shader& shader, Shader& cubeShader, const DrawCasters& drawCasters);
+
+	/// <summary>
+	/// Bind the framebuffer of the atlas for the shadow pass (and enable the polygon offset of hardware compare)
+	/// </summary>
+	void begin();
+
+	/// <summary>
+	/// Cells of the tile of a light to render this frame (bit i = cell i, see Light::getShadowCells), 0 if the shadow
+	/// map is up to date or delayed by the scheduler.
+	/// </summary>
+	/// <param name="index">: index of the light in the list passed to update</param>
+	int getScheduledCells(size_t index) const { return index < m_scheduledCells.size() ? m_scheduledCells[index] : 0; }
+
+	/// <summary>
+	/// Scheduled cells whose static casters must be drawn to the cache first (beginStaticTile)
+	/// </summary>
+	int getScheduledStaticCells(size_t index) const { return index < m_scheduledStaticCells.size() ? m_scheduledStaticCells[index] : 0; }
+
+	/// <summary>
+	/// Number of cells in a cell mask (bit i = cell i)
+	/// </summary>
+	static int countCells(int cells);
+
+	/// <summary>
+	/// Set the number of cells (shadow maps, point light faces) rendered per frame, 0 = no limit
+	/// </summary>
+	void setCellBudget(int cells) { m_cellBudget = std::max(0, cells); }
+
+	/// <summary>
+	/// Bind the cache, set viewport and scissor to the tile of the light and clear the cells (draw the static casters).
+	/// For point lights the clip distances used by shadowmap_cube.geom are enabled.
+	/// </summary>
+	/// <param name="cells">: cells to clear (getScheduledStaticCells)</param>
+	void beginStaticTile(const Light& light, int cells);
+
+	/// <summary>
+	/// Bind the atlas, copy the static casters of the cells from the cache to the tile of the light and set viewport
+	/// and scissor to the tile (draw the dynamic casters).
+	/// For point lights the clip distances used by shadowmap_cube.geom are enabled.
+	/// </summary>
+	/// <param name="cells">: cells to copy (getScheduledCells)</param>
+	void beginTile(const Light& light, int cells);
+
+	/// <summary>
+	/// Set the viewport to a cell of the tile of the light (after beginStaticTile or beginTile)
+	/// </summary>
+	void beginCell(const Light& light, int cell);
+
+	/// <summary>
+	/// Reset the state changed by begin/beginStaticTile/beginTile (the atlas framebuffer stays bound)
+	/// </summary>
+	void end();
+
+	/// <summary>
+	/// VSM/EVSM: convert the tiles rendered since the last call to blurred moments (separable gaussian with the
+	/// Light::UniformData::shadowFilterRadius of the light) and generate the mipmaps. Call after end().
+	/// </summary>
+	/// <param name="shader">: shader with shadow_moments.frag</param>
+	/// <param name="quad">: draws the cells</param>
+	void resolveMoments(Shader& shader, ScreenQuadRenderer& quad);
+
+	/// <summary>
+	/// Bind the atlas texture to SLOT (and to DEPTH_SLOT for the PCSS blocker search, the moments to MOMENTS_SLOT)
+	/// </summary>
+	void bindTexture() const;
+
+	unsigned int getTexture() const { return m_fbo.getDepthAttachment(0); }
+
+	/// <summary>
+	/// Draw the UI in ImGui: resolution scale, hardware compare, filter, update budget and backlog, used space
+	/// </summary>
+	void imGuiRender();
+};
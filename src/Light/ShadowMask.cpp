@@ -0,0 +1,60 @@
+#include "ShadowMask.h"
+#include "imgui.h"
+#include <algorithm>
+
+void ShadowMask::bindShader(Shader& shader)
+{
+	shader.setInt("u_shadowMask", SLOT);
+	shader.setInt("u_shadowMaskDistance", DISTANCE_SLOT);
+}
+
+void ShadowMask::resize(unsigned int width, unsigned int height)
+{
+	m_screenWidth = width;
+	m_screenHeight = height;
+	create();
+}
+
+void ShadowMask::create()
+{
+	m_width = std::max(1u, m_screenWidth / m_downscale);
+	m_height = std::max(1u, m_screenHeight / m_downscale);
+	m_fbo = Framebuffer(m_width, m_height);
+	m_fbo.addColorAttachament(GL_TEXTURE_2D, GL_RGBA8);
+	m_fbo.addColorAttachament(GL_TEXTURE_2D, GL_R32F);
+	m_fbo.addDepthAttachment(GL_RENDERBUFFER);
+	m_fbo.create();
+}
+
+void ShadowMask::begin()
+{
+	m_fbo.bind();
+	glViewport(0, 0, m_width, m_height);
+	// lit and far away where nothing is drawn (gets no weight in the upsampling)
+	const float visibility[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	const float distance[4] = { 1e30f, 0.0f, 0.0f, 0.0f };
+	glClearBufferfv(GL_COLOR, 0, visibility);
+	glClearBufferfv(GL_COLOR, 1, distance);
+	glClear(GL_DEPTH_BUFFER_BIT);
+}
+
+void ShadowMask::setUniforms(Shader& shader) const
+{
+	shader.setKeyword("SHADOW_MASK", m_enabled);
+	if (!m_enabled) {
+		return;
+	}
+	shader.setVec4("u_shadowMaskScale", glm::vec4((float)m_width / m_screenWidth, (float)m_height / m_screenHeight, 0.0f, 0.0f));
+	glActiveTexture(GL_TEXTURE0 + SLOT);
+	glBindTexture(GL_TEXTURE_2D, m_fbo.getColorAttachment(0));
+	glActiveTexture(GL_TEXTURE0 + DISTANCE_SLOT);
+	glBindTexture(GL_TEXTURE_2D, m_fbo.getColorAttachment(1));
+}
+
+void ShadowMask::imGuiRender()
+{
+	ImGui::Checkbox("Screen space shadow mask", &m_enabled);
+	if (m_enabled && ImGui::SliderInt("Shadow mask downscale", &m_downscale, 1, 4)) {
+		create();
+	}
+}
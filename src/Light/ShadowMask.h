@@ -0,0 +1,67 @@
+#pragma once
+#include "Shader.h"
+#include "Framebuffer.h"
+
+/// <summary>
+/// Screen space shadow mask (shaders/shadow_mask.frag): the filtered shadows of the first LIGHTS lights are
+/// computed once per pixel at reduced resolution, before the lighting pass. The lighting shaders read the mask
+/// (SHADOW_MASK keyword, shaders/shadows.partial.glsl) and upsample it with a bilateral filter, so the expensive
+/// PCF/PCSS kernels run on a fraction of the pixels and only once for all lighting models.
+/// </summary>
+class ShadowMask
+{
+public:
+	// lights in the mask (rgba channels), must be the same as SHADOW_MASK_LIGHTS in shaders
+	static const int LIGHTS = 4;
+
+	// texture slots of the mask and of its distances (after ShadowAtlas::DEPTH_SLOT)
+	static const unsigned int SLOT = 10;
+	static const unsigned int DISTANCE_SLOT = 11;
+private:
+	// visibility of the lights (RGBA8) and distance from the camera (R32F)
+	Framebuffer m_fbo;
+	unsigned int m_width = 0;
+	unsigned int m_height = 0;
+	// size of the framebuffer of the scene
+	unsigned int m_screenWidth = 0;
+	unsigned int m_screenHeight = 0;
+
+	bool m_enabled = false;
+	// mask size = screen size / downscale
+	int m_downscale = 2;
+
+	// create the framebuffer for the screen size and downscale
+	void create();
+public:
+	ShadowMask() = default;
+	ShadowMask(const ShadowMask& o) = delete;
+	ShadowMask& operator=(const ShadowMask& o) = delete;
+
+	/// <summary>
+	/// Set the samplers of the mask (call once per lighting shader)
+	/// </summary>
+	static void bindShader(Shader& shader);
+
+	/// <summary>
+	/// Resize the mask for a framebuffer of the scene
+	/// </summary>
+	void resize(unsigned int width, unsigned int height);
+
+	bool isEnabled() const { return m_enabled; }
+
+	/// <summary>
+	/// Bind the mask framebuffer, set the viewport and clear it (lit, far away).
+	/// Then draw the scene with shadow_mask.frag.
+	/// </summary>
+	void begin();
+
+	/// <summary>
+	/// Enable the SHADOW_MASK keyword of a lighting shader (if the mask is enabled) and bind the mask
+	/// </summary>
+	void setUniforms(Shader& shader) const;
+
+	/// <summary>
+	/// Draw the UI in ImGui: enable and resolution
+	/// </summary>
+	void imGuiRender();
+};
@@ -26,11 +26,13 @@ void Spotlight::imGuiRender()
 		m_parameters.UP = (m_position.z == 0.0f && m_position.x == 0.0f) ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
 		calculateLightSpaceMatrix();
 		m_shadowNeedsRender = true;
+		m_dirty = true;
 	}
 
 	if (ImGui::DragFloat3("Target", &m_target.x, 0.01f)) {
 		calculateLightSpaceMatrix();
 		m_shadowNeedsRender = true;
+		m_dirty = true;
 	}
 	/*
 	* the cut off and outer cut off are stored in degrees (shader expects cos values)
@@ -39,14 +41,18 @@ void Spotlight::imGuiRender()
 		m_outerCutOff = std::max(m_outerCutOff, m_cutOff);
 		calculateLightSpaceMatrix();
 		m_shadowNeedsRender = true;
+		m_dirty = true;
 	}
 	if (ImGui::DragFloat("Outer cut off", &m_outerCutOff, 0.1f, 0.1f, 90.0f, "%.1f deg")) {
 		m_cutOff = std::min(m_cutOff, m_outerCutOff);
 		calculateLightSpaceMatrix();
 		m_shadowNeedsRender = true;
+		m_dirty = true;
 	}
 	// slider is logaritmic for greater control
-	ImGui::SliderFloat3("Attenuation", &m_attenuation[0], 0.0f, 1.0f, "%.3f", ImGuiSliderFlags_Logarithmic);
+	if (ImGui::SliderFloat3("Attenuation", &m_attenuation[0], 0.0f, 1.0f, "%.3f", ImGuiSliderFlags_Logarithmic)) {
+		m_dirty = true;
+	}
 
 	// UI for light view projection parameters
 	ImGui::PushStyleColor(ImGuiCol_Header, ImVec4(0.1f, 0.25f, 0.25f, 1.0f)); // Set header color
@@ -54,34 +60,41 @@ void Spotlight::imGuiRender()
 		if (ImGui::DragFloat("Aspect", &m_parameters.aspect, 0.001f, 0.001f, 50.0f)) {
 			calculateLightSpaceMatrix();
 			m_shadowNeedsRender = true;
+			m_dirty = true;
 		}
 		if (ImGui::DragFloat("Near plane", &m_parameters.near_plane, 0.001f, 0.001f, 50.0f)) {
 			calculateLightSpaceMatrix();
 			m_shadowNeedsRender = true;
+			m_dirty = true;
 		}
 		if (ImGui::DragFloat("Far plane", &m_parameters.far_plane, 0.001f, 0.001f, 50.0f)) {
 			calculateLightSpaceMatrix();
 			m_shadowNeedsRender = true;
+			m_dirty = true;
 		}
 	}
 	ImGui::PopStyleColor();
 }
 
-void Spotlight::setUniforms(Shader& shader)
+void Spotlight::getUniformData(UniformData& data) const
 {
-	shader.setVec4(formatAttribute("position"), m_modelMatrix * glm::vec4(m_position, 1.0f));
-	shader.setFloat(formatAttribute("intensity"), m_intensity);
-	shader.setVec3(formatAttribute("color"), m_color);
-	shader.setBool(formatAttribute("enabled"), m_enabled);
-	shader.setVec3(formatAttribute("attenuation"), m_attenuation);
-	shader.setVec3(formatAttribute("target"), m_target);
-	shader.setFloat(formatAttribute("cutOff"), glm::cos(glm::radians(m_cutOff))); // shader uses cos values
-	shader.setFloat(formatAttribute("outerCutOff"), glm::cos(glm::radians(m_outerCutOff))); // shader uses cos values
-	shader.setBool(formatAttribute("shadow"), m_shadow);
-	shader.setMat4(formatAttribute("lightSpaceMatrix"), m_lightSpaceMatrix[0]);
-	shader.setInt(formatAttribute("shadowMap"), m_shadowTextureSlot);
-	shader.setFloat(formatAttribute("farPlane"), m_parameters.far_plane);
-	shader.setInt(formatAttribute("type"), 1);
+	data.lightSpaceMatrix = m_lightSpaceMatrix[0];
+	data.position = m_modelMatrix * glm::vec4(m_position, 1.0f);
+	data.color = m_color;
+	data.intensity = m_intensity;
+	data.attenuation = m_attenuation;
+	data.cutOff = glm::cos(glm::radians(m_cutOff)); // shader uses cos values
+	data.target = m_target;
+	data.outerCutOff = glm::cos(glm::radians(m_outerCutOff)); // shader uses cos values
+	data.type = 1;
+	data.enabled = m_enabled;
+	data.shadow = m_shadow;
+	data.farPlane = m_parameters.far_plane;
+	data.shadowFilterRadius = m_shadowFilterRadius;
+	data.shadowLightSize = m_shadowLightSize;
+	data.nearPlane = m_parameters.near_plane;
+	data.shadowRect = m_shadowRect;
+	applyShadowState(data);
 }
 
 void Spotlight::calculateLightSpaceMatrix()
@@ -97,3 +110,17 @@ void Spotlight::calculateLightSpaceMatrix()
 			m_target,
 			m_parameters.UP);
 }
+
+int Spotlight::getCellMask(const glm::vec3& min, const glm::vec3& max) const
+{
+	if (Light::getCellMask(min, max) == 0) {
+		return 0;
+	}
+	// the frustum corners are outside the cone: test the bounding sphere of the box against the cone
+	glm::vec3 center = 0.5f * (min + max);
+	float radius = 0.5f * glm::length(max - min);
+	if (!isSphereInCone(m_position, glm::normalize(m_target - m_position), glm::cos(glm::radians(m_outerCutOff)), center, radius)) {
+		return 0;
+	}
+	return 1;
+}
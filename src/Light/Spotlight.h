@@ -44,15 +44,25 @@ public:
 	void imGuiRender() override;
 
 	/// <summary>
-	/// Sets all uniforms for this light (at m_index)
+	/// Set the attenuation factors: constant, linear, quadratic
 	/// </summary>
-	void setUniforms(Shader& shader) override;
+	void setAttenuation(const glm::vec3& attenuation) { m_attenuation = attenuation; m_dirty = true; }
+
+	/// <summary>
+	/// Fills the uniform buffer data for this light
+	/// </summary>
+	void getUniformData(UniformData& data) const override;
 
 	/// <summary>
 	/// Calculate the light space matrix using the member parameters
 	/// </summary>
 	void calculateLightSpaceMatrix() override;
 
+	/// <summary>
+	/// Check the box against the frustum of the shadow map and against the cone of the outer cut off
+	/// </summary>
+	int getCellMask(const glm::vec3& min, const glm::vec3& max) const override;
+
 	float getCutoff() const { return m_cutOff; }
 	float getOuterCutoff() const { return m_outerCutOff; }
 	glm::vec3 getTarget() const { return m_target; }
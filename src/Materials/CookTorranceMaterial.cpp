@@ -62,14 +62,29 @@ void CookTorranceMaterial::setUniforms(Shader& shader)
 	shader.setFloat("u_material.metallic", m_metallic);
 	shader.setFloat("u_material.ka", m_ka);
 	shader.setVec3("u_material.ia", m_ia);
-	shader.setInt("u_Gindex", m_Gindex);
-	shader.setInt("u_Dindex", m_Dindex);
 
-	shader.setBool("u_outputDFG", m_outputDFG);
-	shader.setInt("u_outputOnlyBRDF", m_outputDFG ? 1 : 0);
-	shader.setInt("u_outputD", m_outputDFG_choice == 0 ? 1 : 0);
-	shader.setInt("u_outputF", m_outputDFG_choice == 1 ? 1 : 0);
-	shader.setInt("u_outputG", m_outputDFG_choice == 2 ? 1 : 0);
+	// D and G functions and debug outputs are selected with keywords (compiled into the shader variant)
+	shader.setKeyword("DISTRIBUTION_GGX", m_Dindex == 1);
+	shader.setKeyword("DISTRIBUTION_PHONG", m_Dindex == 2);
+	shader.setKeyword("GEOMETRY_BECKMANN_UNCORRELATED", m_Gindex == 1);
+	shader.setKeyword("GEOMETRY_GGX_UNCORRELATED", m_Gindex == 2);
+	shader.setKeyword("GEOMETRY_BECKMANN", m_Gindex == 3);
+	shader.setKeyword("GEOMETRY_GGX", m_Gindex == 4);
+
+	shader.setKeyword("OUTPUT_BRDF", m_outputDFG);
+	shader.setKeyword("OUTPUT_D", m_outputDFG && m_outputDFG_choice == 0);
+	shader.setKeyword("OUTPUT_F", m_outputDFG && m_outputDFG_choice == 1);
+	shader.setKeyword("OUTPUT_G", m_outputDFG && m_outputDFG_choice == 2);
+}
+
+void CookTorranceMaterial::getDeferredData(DeferredData& data) const
+{
+	data.albedo = m_albedo;
+	data.roughness = m_roughness;
+	data.metallic = m_metallic;
+	data.f0 = m_customF0 ? glm::pow(m_f0, glm::vec3(2.2f)) : glm::vec3(0.0f);
+	// ambient color + ambient coefficient
+	data.parameters[0] = glm::vec4(m_ia, m_ka);
 }
 
 void CookTorranceMaterial::defaultParameters()
@@ -46,6 +46,11 @@ public:
 	/// </summary>
 	void setUniforms(Shader& shader) override;
 
+	/// <summary>
+	/// Surface and material table parameters of the deferred renderer
+	/// </summary>
+	void getDeferredData(DeferredData& data) const override;
+
 	void setColor(const glm::vec3& albedo) override { m_albedo = albedo; }
 	void setAmbient(const glm::vec3& c) override { m_ia = c; }
 	void disableHighlights() override { m_roughness = 0.999f; m_metallic = 0.05f; }
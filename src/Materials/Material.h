@@ -6,6 +6,22 @@
 /// </summary>
 class Material
 {
+public:
+	// number of vec4 parameters of a material in the material table of the deferred lighting shaders
+	static const int DEFERRED_PARAMETERS = 2;
+
+	/// <summary>
+	/// Material data of the deferred renderer (see GBuffer): the surface written to the G-buffer
+	/// and the parameters of the lighting model read from the material table
+	/// </summary>
+	struct DeferredData {
+		glm::vec3 albedo = glm::vec3(1.0f);
+		float roughness = 1.0f;
+		glm::vec3 f0 = glm::vec3(0.0f);
+		float metallic = 0.0f;
+		// read by the "deferred_material" section of the lighting shader
+		glm::vec4 parameters[DEFERRED_PARAMETERS] = {};
+	};
 protected:
 	int m_presetIndex = 0;
 
@@ -18,11 +34,17 @@ public:
 	virtual void imGuiRender() = 0;
 
 	/// <summary>
-	/// Sets all uniforms in shader
+	/// Sets all uniforms and keywords in shader
 	/// </summary>
 	virtual void setUniforms(Shader& shader) = 0;
 	virtual ~Material() {}
 
+	/// <summary>
+	/// Fill the G-buffer surface and the material table parameters of the material
+	/// (keywords and other uniforms of the lighting shader are still set with setUniforms)
+	/// </summary>
+	virtual void getDeferredData(DeferredData& data) const = 0;
+
 	// set albedo/diffuse
 	virtual void setColor(const glm::vec3& color) = 0;
 	
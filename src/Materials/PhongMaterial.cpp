@@ -66,6 +66,18 @@ void PhongMaterial::setUniforms(Shader& shader)
     shader.setBool("u_modifiedSpecular", m_modifiedSpecular);
 }
 
+void PhongMaterial::getDeferredData(DeferredData& data) const
+{
+    data.albedo = m_diffuseColor;
+    // the shininess is stored as roughness, like the one approximated from roughness textures (alpha = 2 / roughness^2)
+    data.roughness = glm::min(1.0f, glm::sqrt(2.0f / glm::max(m_alpha, 0.0001f)));
+    // the specular coefficient is stored in f0
+    data.f0 = m_ks;
+    // kd + ambient coefficient, ambient color + modified specular flag
+    data.parameters[0] = glm::vec4(m_kd, m_ka);
+    data.parameters[1] = glm::vec4(m_ia, m_modifiedSpecular ? 1.0f : 0.0f);
+}
+
 void PhongMaterial::defaultParameters()
 {
 	m_presetIndex = 0;
@@ -49,6 +49,11 @@ public:
 	/// </summary>
 	virtual void setUniforms(Shader& shader) override;
 
+	/// <summary>
+	/// Surface and material table parameters of the deferred renderer
+	/// </summary>
+	virtual void getDeferredData(DeferredData& data) const override;
+
 	virtual void defaultParameters() override;
 };
 
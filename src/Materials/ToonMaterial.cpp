@@ -12,3 +12,10 @@ void ToonMaterial::setUniforms(Shader& shader)
     shader.setVec3("u_material.diffuseColor", m_diffuseColor);
     shader.setVec3("u_material.ambientColor", m_ambientFactor * m_ambientColor);
 }
+
+void ToonMaterial::getDeferredData(DeferredData& data) const
+{
+    data.albedo = m_diffuseColor;
+    // ambient color
+    data.parameters[0] = glm::vec4(m_ambientFactor * m_ambientColor, 0.0f);
+}
@@ -32,5 +32,10 @@ public:
 	/// Sets all material uniforms in shader
 	/// </summary>
 	virtual void setUniforms(Shader& shader) override;
+
+	/// <summary>
+	/// Surface and material table parameters of the deferred renderer
+	/// </summary>
+	virtual void getDeferredData(DeferredData& data) const override;
 };
 
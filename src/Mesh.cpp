@@ -1,4 +1,5 @@
 #include "Mesh.h"
+#include <cfloat>
 
 Mesh::Mesh(const std::vector<Vertex> &vertices, 
 	const std::vector<unsigned int>& indices,
@@ -25,6 +26,28 @@ Mesh::Mesh(const std::vector<Vertex> &vertices,
 	m_ebo->bind();
 
 	m_indicesCount = indices.size();
+
+	// bounding box, used for culling
+	if (!vertices.empty()) {
+		m_boundsMin = m_boundsMax = vertices[0].position;
+	}
+	for (const auto& vertex : vertices) {
+		m_boundsMin = glm::min(m_boundsMin, vertex.position);
+		m_boundsMax = glm::max(m_boundsMax, vertex.position);
+	}
+}
+
+void Mesh::getBounds(const glm::mat4& modelMatrix, glm::vec3& min, glm::vec3& max) const
+{
+	// transform the 8 corners of the box
+	min = glm::vec3(FLT_MAX);
+	max = glm::vec3(-FLT_MAX);
+	for (int i = 0; i < 8; ++i) {
+		glm::vec3 corner(i & 1 ? m_boundsMax.x : m_boundsMin.x, i & 2 ? m_boundsMax.y : m_boundsMin.y, i & 4 ? m_boundsMax.z : m_boundsMin.z);
+		glm::vec3 p = glm::vec3(modelMatrix * glm::vec4(corner, 1.0f));
+		min = glm::min(min, p);
+		max = glm::max(max, p);
+	}
 }
 
 Mesh::~Mesh()
@@ -37,16 +60,22 @@ Mesh::~Mesh()
 
 void Mesh::draw(Shader &shader)
 {
-	// set all texture uniforms to false
-	shader.setBool("u_hasDiffTexture", false);
-	shader.setBool("u_hasSpecTexture", false);
-	shader.setBool("u_hasNormTexture", false);
-	shader.setBool("u_hasRoughTexture", false);
-	shader.setBool("u_hasMetallicTexture", false);
-	shader.setBool("u_hasEmissiveTexture", false);
-	shader.setBool("u_hasOpacityTexture", false);
-
-	// set uniforms for used textures
+	// select the shader variant for the textures of this mesh
+	// (CUBEMAP is the last type)
+	bool hasTexture[(int)Texture::Type::CUBEMAP + 1] = { false };
+	for (const auto& texture : m_textures) {
+		hasTexture[(int)texture->getType()] = true;
+	}
+	shader.setKeyword("HAS_DIFFUSE_TEXTURE", hasTexture[(int)Texture::Type::DIFFUSE]);
+	shader.setKeyword("HAS_SPECULAR_TEXTURE", hasTexture[(int)Texture::Type::SPECULAR]);
+	shader.setKeyword("HAS_NORMAL_TEXTURE", hasTexture[(int)Texture::Type::NORMAL]);
+	shader.setKeyword("HAS_ROUGHNESS_TEXTURE", hasTexture[(int)Texture::Type::ROUGHNESS]);
+	shader.setKeyword("HAS_METALLIC_TEXTURE", hasTexture[(int)Texture::Type::METALLIC]);
+	shader.setKeyword("HAS_EMISSIVE_TEXTURE", hasTexture[(int)Texture::Type::EMISSIVE]);
+	shader.setKeyword("HAS_OPACITY_TEXTURE", hasTexture[(int)Texture::Type::OPACITY]);
+	shader.bind();
+
+	// set sampler uniforms for used textures
 	for (unsigned int i = 0; i < m_textures.size(); ++i) {
 		// bind this texture
 		m_textures[i]->bind(i);
@@ -55,46 +84,29 @@ void Mesh::draw(Shader &shader)
 		{
 		case Texture::Type::DIFFUSE:
 			shader.setInt("u_DiffuseTex", i);
-			shader.setBool("u_hasDiffTexture", true);
 			break;
 		case Texture::Type::SPECULAR:
 			shader.setInt("u_SpecularTex", i);
-			shader.setBool("u_hasSpecTexture", true);
 			break;
 		case Texture::Type::NORMAL:
 			shader.setInt("u_NormalTex", i);
-			shader.setBool("u_hasNormTexture", true);
 			break;
 		case Texture::Type::ROUGHNESS:
 			shader.setInt("u_RoughTex", i);
-			shader.setBool("u_hasRoughTexture", true);
 			break;
 		case Texture::Type::METALLIC:
 			shader.setInt("u_MetallicTex", i);
-			shader.setBool("u_hasMetallicTexture", true);
 			break;
 		case Texture::Type::EMISSIVE:
 			shader.setInt("u_EmissiveTex", i);
-			shader.setBool("u_hasEmissiveTexture", true);
 			break;
 		case Texture::Type::OPACITY:
 			shader.setInt("u_OpacityTex", i);
-			shader.setBool("u_hasOpacityTexture", true);
 			break;
 		}
-
-
 	}
 	m_vao->bind();
 	glDrawElements(GL_TRIANGLES, m_indicesCount, GL_UNSIGNED_INT, 0);
-	// reset to avoid bugs
-	shader.setBool("u_hasDiffTexture", false);
-	shader.setBool("u_hasSpecTexture", false);
-	shader.setBool("u_hasNormTexture", false);
-	shader.setBool("u_hasRoughTexture", false);
-	shader.setBool("u_hasMetallicTexture", false);
-	shader.setBool("u_hasEmissiveTexture", false);
-	shader.setBool("u_hasOpacityTexture", false);
 }
 
 Mesh *Mesh::getCube(float width, float height, float depth)
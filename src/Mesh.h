@@ -15,6 +15,10 @@ private:
 	VBO *m_vbo = nullptr;
 	EBO *m_ebo = nullptr;
 	unsigned int m_indicesCount = 0;
+
+	// bounding box of the vertex positions (object space)
+	glm::vec3 m_boundsMin = glm::vec3(0.0f);
+	glm::vec3 m_boundsMax = glm::vec3(0.0f);
 	
 	std::vector<std::shared_ptr<Texture> > m_textures;
 public:
@@ -35,6 +39,11 @@ public:
 	/// </summary>
 	void setTextures(const std::vector<std::shared_ptr<Texture> > textures) { m_textures = textures; }
 
+	/// <summary>
+	/// Get the world space bounding box of the mesh transformed by the model matrix
+	/// </summary>
+	void getBounds(const glm::mat4& modelMatrix, glm::vec3& min, glm::vec3& max) const;
+
 	/// <summary>
 	/// Factory method to get a mesh representing a plane in the xOy plane (centered at origin).
 	/// </summary>
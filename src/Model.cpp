@@ -1,4 +1,5 @@
 #include "Model.h"
+#include <cfloat>
 
 /// <summary>
 /// This methods creates a mesh (vertex attributes, indices, textures)
@@ -153,6 +154,16 @@ void Model::load(const std::string& path)
 		}
 		index++;
 	}
+
+	// union of the mesh bounds, transformed by the model matrix in getBounds
+	m_boundsMin = glm::vec3(m_meshes.empty() ? 0.0f : FLT_MAX);
+	m_boundsMax = glm::vec3(m_meshes.empty() ? 0.0f : -FLT_MAX);
+	for (auto& mesh : m_meshes) {
+		glm::vec3 meshMin, meshMax;
+		mesh->getBounds(glm::mat4(1.0f), meshMin, meshMax);
+		m_boundsMin = glm::min(m_boundsMin, meshMin);
+		m_boundsMax = glm::max(m_boundsMax, meshMax);
+	}
 }
 
 void Model::draw(Shader& shader) const
@@ -162,3 +173,16 @@ void Model::draw(Shader& shader) const
 		mesh->draw(shader);
 	}
 }
+
+void Model::getBounds(glm::vec3& min, glm::vec3& max) const
+{
+	// transform the 8 corners of the box
+	min = glm::vec3(FLT_MAX);
+	max = glm::vec3(-FLT_MAX);
+	for (int i = 0; i < 8; ++i) {
+		glm::vec3 corner(i & 1 ? m_boundsMax.x : m_boundsMin.x, i & 2 ? m_boundsMax.y : m_boundsMin.y, i & 4 ? m_boundsMax.z : m_boundsMin.z);
+		glm::vec3 p = glm::vec3(m_modelMatrix * glm::vec4(corner, 1.0f));
+		min = glm::min(min, p);
+		max = glm::max(max, p);
+	}
+}
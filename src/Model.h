@@ -19,6 +19,10 @@ private:
 	// list of meshes used (each mesh = 1 draw call)
 	std::vector<std::unique_ptr<Mesh>> m_meshes;
 
+	// bounding box of all meshes (object space, computed on load)
+	glm::vec3 m_boundsMin = glm::vec3(0.0f);
+	glm::vec3 m_boundsMax = glm::vec3(0.0f);
+
 	/// <summary>
 	/// Process an assimp mesh and create a mesh using vertices, indices and textures
 	/// </summary>
@@ -39,5 +43,10 @@ public:
 	/// Draw this model (uses the model matrix)
 	/// </summary>
 	void draw(Shader& shader) const;
+
+	/// <summary>
+	/// Get the world space bounding box of all meshes (the box computed on load transformed by the model matrix)
+	/// </summary>
+	void getBounds(glm::vec3& min, glm::vec3& max) const;
 };
 
@@ -0,0 +1,46 @@
+#include "DynamicResolution.h"
+#include "imgui.h"
+
+const float DynamicResolution::SCALES[STEPS] = { 0.5f, 0.625f, 0.75f, 0.875f, 1.0f };
+
+bool DynamicResolution::update(float gpuFrameTime)
+{
+	if (!m_enabled || gpuFrameTime <= 0.0f) {
+		return false;
+	}
+	m_averageTime = m_averageTime > 0.0f ? m_averageTime + (gpuFrameTime - m_averageTime) * 0.1f : gpuFrameTime;
+	if (++m_framesSinceChange < COOLDOWN_FRAMES) {
+		return false;
+	}
+
+	int step = m_step;
+	if (m_averageTime > m_budget && step > 0) {
+		step--;
+	}
+	else if (m_averageTime < m_budget * m_upThreshold && step < STEPS - 1) {
+		step++;
+	}
+	if (step == m_step) {
+		return false;
+	}
+	m_step = step;
+	// the frame times of the old scale don't count
+	m_framesSinceChange = 0;
+	m_averageTime = 0.0f;
+	return true;
+}
+
+bool DynamicResolution::imGuiRender()
+{
+	float scale = getScale();
+	if (ImGui::Checkbox("Dynamic resolution", &m_enabled)) {
+		m_framesSinceChange = 0;
+		m_averageTime = 0.0f;
+	}
+	if (m_enabled) {
+		ImGui::SliderFloat("Frame time budget (ms)", &m_budget, 1.0f, 33.0f);
+		ImGui::SliderFloat("Upscale sharpness", &m_sharpness, 0.0f, 1.0f);
+		ImGui::Text("Render scale: %.0f%% (GPU %.2f ms)", getScale() * 100.0f, m_averageTime);
+	}
+	return scale != getScale();
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+/// <summary>
+/// Render scale chosen from the GPU frame time (PassProfiler::getGpuFrameTime): the scene is rendered at a fraction
+/// of the window size and upscaled in the final pass (bilinear + sharpening, shaders/upscale.partial.glsl).
+/// The scale only moves between a few steps so the render targets are reallocated rarely: one step down when the
+/// average frame time is over the budget, one step up when it is well below it (hysteresis), and after a change
+/// the new frame times are measured for a while before the next one.
+/// </summary>
+class DynamicResolution
+{
+public:
+	// render scales (fraction of the window width/height)
+	static const int STEPS = 5;
+	static const float SCALES[STEPS];
+	// frames to wait after a change (the GPU times arrive 2 frames late)
+	static const int COOLDOWN_FRAMES = 30;
+private:
+	bool m_enabled = false;
+	// frame time budget (ms)
+	float m_budget = 8.0f;
+	// scale up when the frame time is below budget * m_upThreshold
+	float m_upThreshold = 0.75f;
+	// sharpening of the upscale (0 = bilinear only)
+	float m_sharpness = 0.5f;
+
+	int m_step = STEPS - 1;
+	// exponential average of the GPU frame time
+	float m_averageTime = 0.0f;
+	int m_framesSinceChange = 0;
+public:
+	/// <summary>
+	/// Add the GPU frame time of a frame and choose the scale
+	/// </summary>
+	/// <param name="gpuFrameTime">: ms, 0 if not measured yet</param>
+	/// <returns>true if the scale changed (=> reallocate the render targets)</returns>
+	bool update(float gpuFrameTime);
+
+	float getScale() const { return m_enabled ? SCALES[m_step] : 1.0f; }
+	float getSharpness() const { return m_sharpness; }
+
+	/// <summary>
+	/// Draw the UI in ImGui: enable, budget, sharpness
+	/// </summary>
+	/// <returns>true if the scale changed</returns>
+	bool imGuiRender();
+};
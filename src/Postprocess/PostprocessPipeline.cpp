@@ -0,0 +1,245 @@
+#include "PostprocessPipeline.h"
+#include <algorithm>
+#include <cmath>
+
+PostprocessPipeline::PostprocessPipeline() : m_luminanceFBO(LUMINANCE_SIZE, LUMINANCE_SIZE)
+{
+	glGenSamplers(1, &m_linearSampler);
+	glSamplerParameteri(m_linearSampler, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glSamplerParameteri(m_linearSampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glSamplerParameteri(m_linearSampler, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glSamplerParameteri(m_linearSampler, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	m_luminanceFBO.addColorAttachament(GL_TEXTURE_2D, GL_R16F, true);
+	m_luminanceFBO.create();
+	// one float each (the 1x1 level)
+	glGenBuffers(EXPOSURE_READBACKS, m_readbackBuffers);
+	for (int i = 0; i < EXPOSURE_READBACKS; ++i) {
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, m_readbackBuffers[i]);
+		glBufferData(GL_PIXEL_PACK_BUFFER, sizeof(float), nullptr, GL_STREAM_READ);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	m_lastExposureUpdate = std::chrono::steady_clock::now();
+}
+
+PostprocessPipeline::~PostprocessPipeline()
+{
+	glDeleteSamplers(1, &m_linearSampler);
+	for (GLsync fence : m_readbackFences) {
+		if (fence != 0) {
+			glDeleteSync(fence);
+		}
+	}
+	glDeleteBuffers(EXPOSURE_READBACKS, m_readbackBuffers);
+}
+
+void PostprocessPipeline::bindShader(Shader& shader)
+{
+	shader.setInt("u_bloomTex", BLOOM_SLOT);
+}
+
+void PostprocessPipeline::resize(unsigned int width, unsigned int height)
+{
+	m_width = width;
+	m_height = height;
+	createBloomLevels();
+}
+
+void PostprocessPipeline::createBloomLevels()
+{
+	// half the screen, limited to BLOOM_MAX_HEIGHT (keeping the aspect ratio)
+	float scale = std::min(0.5f, (float)BLOOM_MAX_HEIGHT / std::max(1u, m_height));
+	unsigned int width = std::max(1u, (unsigned int)(m_width * scale));
+	unsigned int height = std::max(1u, (unsigned int)(m_height * scale));
+	for (auto& level : m_bloomLevels) {
+		if (!level.fbo || level.width != width || level.height != height) {
+			level.width = width;
+			level.height = height;
+			level.fbo = std::make_unique<Framebuffer>(width, height);
+			level.fbo->addColorAttachament(GL_TEXTURE_2D, GL_RGBA16F);
+			level.fbo->create();
+			// the downsample and upsample filters rely on bilinear filtering
+			glBindTexture(GL_TEXTURE_2D, level.fbo->getColorAttachment(0));
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			glBindTexture(GL_TEXTURE_2D, 0);
+		}
+		width = std::max(1u, width / 2);
+		height = std::max(1u, height / 2);
+	}
+}
+
+void PostprocessPipeline::renderBloom(Shader& shader, ScreenQuadRenderer& quad, unsigned int hdrTexture, const PostprocessUI& settings)
+{
+	m_bloomRendered = settings.getBloom();
+	if (!m_bloomRendered) {
+		return;
+	}
+	// the upsample adds the levels with blending, restore the blending of the scene afterwards
+	GLboolean blend = glIsEnabled(GL_BLEND);
+	GLint blendFunc[4];
+	glGetIntegerv(GL_BLEND_SRC_RGB, &blendFunc[0]);
+	glGetIntegerv(GL_BLEND_DST_RGB, &blendFunc[1]);
+	glGetIntegerv(GL_BLEND_SRC_ALPHA, &blendFunc[2]);
+	glGetIntegerv(GL_BLEND_DST_ALPHA, &blendFunc[3]);
+	glDisable(GL_BLEND);
+	glDisable(GL_DEPTH_TEST);
+
+	shader.setFloat("u_threshold", settings.getBloomThreshold());
+	shader.setFloat("u_radius", settings.getBloomRadius());
+
+	// downsample: HDR color (bright part) -> level 0 -> level 1 -> ...
+	shader.setKeyword("BLOOM_UPSAMPLE", false);
+	glBindSampler(0, m_linearSampler);
+	unsigned int source = hdrTexture;
+	for (int i = 0; i < BLOOM_LEVELS; ++i) {
+		m_bloomLevels[i].fbo->bind();
+		glViewport(0, 0, m_bloomLevels[i].width, m_bloomLevels[i].height);
+		shader.setKeyword("BLOOM_PREFILTER", i == 0);
+		quad.render(source, shader);
+		source = m_bloomLevels[i].fbo->getColorAttachment(0);
+		// the levels have their own bilinear filtering
+		glBindSampler(0, 0);
+	}
+
+	// upsample: every level is added to the larger one, level 0 has the sum of all levels
+	shader.setKeyword("BLOOM_PREFILTER", false);
+	shader.setKeyword("BLOOM_UPSAMPLE", true);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_ONE, GL_ONE);
+	for (int i = BLOOM_LEVELS - 2; i >= 0; --i) {
+		m_bloomLevels[i].fbo->bind();
+		glViewport(0, 0, m_bloomLevels[i].width, m_bloomLevels[i].height);
+		quad.render(m_bloomLevels[i + 1].fbo->getColorAttachment(0), shader);
+	}
+
+	glBlendFuncSeparate(blendFunc[0], blendFunc[1], blendFunc[2], blendFunc[3]);
+	if (!blend) {
+		glDisable(GL_BLEND);
+	}
+}
+
+void PostprocessPipeline::readExposure()
+{
+	// the copies finish in order, the oldest one is at the next write position
+	for (int k = 0; k < EXPOSURE_READBACKS; ++k) {
+		int i = (m_readbackIndex + k) % EXPOSURE_READBACKS;
+		if (m_readbackFences[i] == 0) {
+			continue;
+		}
+		// timeout 0: only check the fence
+		GLenum status = glClientWaitSync(m_readbackFences[i], 0, 0);
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+			break;
+		}
+		glDeleteSync(m_readbackFences[i]);
+		m_readbackFences[i] = 0;
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, m_readbackBuffers[i]);
+		const float* value = (const float*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, sizeof(float), GL_MAP_READ_BIT);
+		if (value != nullptr) {
+			m_logLuminance = *value;
+			m_hasLuminance = true;
+		}
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+void PostprocessPipeline::measureExposure(Shader& shader, ScreenQuadRenderer& quad, unsigned int hdrTexture, const PostprocessUI& settings)
+{
+	auto now = std::chrono::steady_clock::now();
+	float deltaTime = std::chrono::duration<float>(now - m_lastExposureUpdate).count();
+	m_lastExposureUpdate = now;
+	if (!settings.getAutoExposure()) {
+		m_exposure = 1.0f;
+		return;
+	}
+	readExposure();
+
+	// log luminance at LUMINANCE_SIZE^2 (bilinear taps of the HDR color), averaged by the mipmaps
+	// (the output has no alpha, blending of the scene is disabled for the pass)
+	GLboolean blend = glIsEnabled(GL_BLEND);
+	glDisable(GL_BLEND);
+	glDisable(GL_DEPTH_TEST);
+	m_luminanceFBO.bind();
+	glViewport(0, 0, LUMINANCE_SIZE, LUMINANCE_SIZE);
+	glBindSampler(0, m_linearSampler);
+	quad.render(hdrTexture, shader);
+	glBindSampler(0, 0);
+	if (blend) {
+		glEnable(GL_BLEND);
+	}
+	m_luminanceFBO.generateMipmaps(0);
+
+	// copy the 1x1 level to a free pixel buffer, the copy runs on the GPU after the mipmaps
+	// (all buffers in flight => skip this frame)
+	if (m_readbackFences[m_readbackIndex] == 0) {
+		int lastLevel = (int)std::round(std::log2((float)LUMINANCE_SIZE));
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, m_readbackBuffers[m_readbackIndex]);
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, m_luminanceFBO.getColorAttachment(0));
+		glGetTexImage(GL_TEXTURE_2D, lastLevel, GL_RED, GL_FLOAT, nullptr);
+		glBindTexture(GL_TEXTURE_2D, 0);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		m_readbackFences[m_readbackIndex] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		m_readbackIndex = (m_readbackIndex + 1) % EXPOSURE_READBACKS;
+	}
+
+	if (!m_hasLuminance) {
+		return;
+	}
+	// exposure mapping the average luminance (geometric mean) to the key, adapted exponentially in log space
+	float targetLogExposure = std::log2(settings.getExposureKey()) - m_logLuminance / std::log(2.0f);
+	targetLogExposure = std::max(-10.0f, std::min(10.0f, targetLogExposure));
+	float adaptation = 1.0f - std::exp(-deltaTime * settings.getAdaptationSpeed());
+	m_logExposure += (targetLogExposure - m_logExposure) * adaptation;
+	m_exposure = std::exp2(m_logExposure);
+}
+
+void PostprocessPipeline::beginFinalPass()
+{
+	if (m_captureRequested) {
+		m_captureFBO = std::make_unique<Framebuffer>(m_width, m_height);
+		m_captureFBO->addColorAttachament(GL_TEXTURE_2D, GL_RGB);
+		m_captureFBO->create();
+		m_captureFBO->bind();
+	}
+	else {
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	}
+	glViewport(0, 0, m_width, m_height);
+	glDisable(GL_DEPTH_TEST);
+	glClear(GL_COLOR_BUFFER_BIT);
+}
+
+void PostprocessPipeline::setUniforms(Shader& shader) const
+{
+	shader.setBool("u_bloom", m_bloomRendered);
+	shader.setFloat("u_exposure", m_exposure);
+	shader.setFloat("u_sharpness", m_upscale ? m_sharpness : 0.0f);
+	if (m_upscale) {
+		// bilinear filtering of the color (slot 0)
+		glBindSampler(0, m_linearSampler);
+	}
+	if (m_bloomRendered) {
+		glActiveTexture(GL_TEXTURE0 + BLOOM_SLOT);
+		glBindTexture(GL_TEXTURE_2D, m_bloomLevels[0].fbo->getColorAttachment(0));
+	}
+}
+
+void PostprocessPipeline::endFinalPass()
+{
+	glBindSampler(0, 0);
+	if (!m_captureFBO) {
+		return;
+	}
+	m_captureFBO->saveColorAttachmentToPNG(0);
+	// show the captured frame
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_captureFBO->getId());
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	glBlitFramebuffer(0, 0, m_width, m_height, 0, 0, m_width, m_height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	// the next frames are written to the default framebuffer again
+	m_captureFBO.reset();
+	m_captureRequested = false;
+}
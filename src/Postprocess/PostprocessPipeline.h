@@ -0,0 +1,132 @@
+#pragma once
+#include "Framebuffer.h"
+#include "Shader.h"
+#include "PostprocessUI.h"
+#include "ScreenQuadRenderer.h"
+#include <memory>
+#include <chrono>
+
+/// <summary>
+/// Passes between the lighting pass and the screen. Tonemapping, gamma correction and the other effects run in one
+/// fused final pass that writes straight to the default framebuffer; an intermediate framebuffer is created only
+/// for the frame after a capture (screenshot) is requested, saved to PNG and copied to the screen.
+/// Bloom is computed before the final pass in a mip chain of the HDR color (shaders/bloom.frag): the bright part
+/// is downsampled with a 13 tap filter into smaller and smaller levels, then the levels are upsampled with a tent
+/// filter and added back up to the first level, which the final pass adds to the color.
+/// The auto exposure averages the log luminance of the HDR color in the mip chain of a small texture and reads the
+/// last level back through pixel buffers, a frame or two later (fences, no stall); the exposure follows it over time.
+/// </summary>
+class PostprocessPipeline
+{
+public:
+	// texture slot of the bloom in the final pass (after the color and the distance/normal texture of toon shading)
+	static const unsigned int BLOOM_SLOT = 2;
+	// levels of the bloom chain, the first one is half the screen size
+	static const int BLOOM_LEVELS = 6;
+	// height limit of the first level, above this resolution the bloom costs the same
+	static const unsigned int BLOOM_MAX_HEIGHT = 540;
+	// size of the log luminance texture of the auto exposure (power of 2, the last mip level is 1x1)
+	static const unsigned int LUMINANCE_SIZE = 256;
+	// measurements in flight, read back when the GPU has finished them
+	static const int EXPOSURE_READBACKS = 3;
+private:
+	unsigned int m_width = 0;
+	unsigned int m_height = 0;
+
+	// set by requestCapture, the next final pass is written to m_captureFBO
+	bool m_captureRequested = false;
+	// only exists during the final pass of a capture
+	std::unique_ptr<Framebuffer> m_captureFBO;
+
+	struct BloomLevel {
+		std::unique_ptr<Framebuffer> fbo;
+		unsigned int width = 0;
+		unsigned int height = 0;
+	};
+	// RGBA16F levels, recreated only when their size changes
+	BloomLevel m_bloomLevels[BLOOM_LEVELS];
+	// bloom was rendered this frame
+	bool m_bloomRendered = false;
+	// bilinear filtering of the HDR color (the framebuffer textures are sampled with nearest filtering)
+	unsigned int m_linearSampler = 0;
+	// the HDR color is smaller than the screen (dynamic resolution) => bilinear upscale and sharpening
+	bool m_upscale = false;
+	float m_sharpness = 0.0f;
+
+	// log luminance with mipmaps (R16F)
+	Framebuffer m_luminanceFBO;
+	// pixel buffers receiving the last mip level and the fences of the copies (0 = free)
+	unsigned int m_readbackBuffers[EXPOSURE_READBACKS] = {};
+	GLsync m_readbackFences[EXPOSURE_READBACKS] = {};
+	// next pixel buffer to write
+	int m_readbackIndex = 0;
+	// latest average log luminance read back
+	float m_logLuminance = 0.0f;
+	bool m_hasLuminance = false;
+	// log2 of the exposure, adapted towards the measurement
+	float m_logExposure = 0.0f;
+	float m_exposure = 1.0f;
+	std::chrono::steady_clock::time_point m_lastExposureUpdate;
+
+	// (re)create the levels of the bloom chain for the screen size
+	void createBloomLevels();
+	// read the finished measurements (non blocking)
+	void readExposure();
+public:
+	PostprocessPipeline();
+	~PostprocessPipeline();
+	PostprocessPipeline(const PostprocessPipeline& o) = delete;
+	PostprocessPipeline& operator=(const PostprocessPipeline& o) = delete;
+
+	/// <summary>
+	/// Set the samplers of a final pass shader (postprocess.frag, toon_postprocess.frag)
+	/// </summary>
+	static void bindShader(Shader& shader);
+
+	/// <summary>
+	/// Set the size of the final pass (window size)
+	/// </summary>
+	void resize(unsigned int width, unsigned int height);
+
+	/// <summary>
+	/// Save the output of the next frame to a PNG file (named with the timestamp)
+	/// </summary>
+	void requestCapture() { m_captureRequested = true; }
+
+	/// <summary>
+	/// Compute the bloom of the HDR color (if enabled in the UI), before beginFinalPass
+	/// </summary>
+	/// <param name="shader">: bloom.frag</param>
+	void renderBloom(Shader& shader, ScreenQuadRenderer& quad, unsigned int hdrTexture, const PostprocessUI& settings);
+
+	/// <summary>
+	/// Measure the average luminance of the HDR color (if auto exposure is enabled in the UI) and adapt the exposure
+	/// to the measurement of a previous frame, before beginFinalPass
+	/// </summary>
+	/// <param name="shader">: luminance.frag</param>
+	void measureExposure(Shader& shader, ScreenQuadRenderer& quad, unsigned int hdrTexture, const PostprocessUI& settings);
+
+	float getExposure() const { return m_exposure; }
+
+	/// <summary>
+	/// Upscale the HDR color in the final pass (rendered at a lower resolution than the screen)
+	/// </summary>
+	/// <param name="sharpness">: 0 = bilinear only, 1 = strongest sharpening</param>
+	void setUpscale(bool upscale, float sharpness) { m_upscale = upscale; m_sharpness = sharpness; }
+
+	/// <summary>
+	/// Bind and clear the target of the final pass (depth test disabled): the default framebuffer,
+	/// or the capture framebuffer if a capture was requested
+	/// </summary>
+	void beginFinalPass();
+
+	/// <summary>
+	/// Bind the results of the previous passes (bloom, exposure) and the upscale filtering for the final pass shader
+	/// </summary>
+	void setUniforms(Shader& shader) const;
+
+	/// <summary>
+	/// Save the capture and copy it to the default framebuffer (nothing to do without a capture)
+	/// </summary>
+	void endFinalPass();
+};
@@ -12,6 +12,7 @@ void PostprocessUI::setUniforms() const
 		shader->setBool("u_gammaCorrect", m_gammaCorrect);
 		shader->setBool("u_hdr", m_hdr);
         shader->setFloat("u_reinhardWhite", m_reinhardWhite);
+        shader->setFloat("u_bloomIntensity", m_bloomIntensity);
 	}
 }
 
@@ -28,4 +29,19 @@ void PostprocessUI::onRenderImGui()
     if (m_hdr && ImGui::DragFloat("Reinhard L_White", &m_reinhardWhite, 0.01f, 0.01f, 100.0f, "%.3f")) {
         setUniforms();
     }
+
+    ImGui::Checkbox("Bloom", &m_bloom);
+    if (m_bloom) {
+        if (ImGui::DragFloat("Bloom intensity", &m_bloomIntensity, 0.001f, 0.0f, 1.0f, "%.3f")) {
+            setUniforms();
+        }
+        ImGui::DragFloat("Bloom threshold", &m_bloomThreshold, 0.01f, 0.0f, 10.0f, "%.2f");
+        ImGui::DragFloat("Bloom radius", &m_bloomRadius, 0.01f, 0.5f, 4.0f, "%.2f");
+    }
+
+    ImGui::Checkbox("Auto exposure", &m_autoExposure);
+    if (m_autoExposure) {
+        ImGui::DragFloat("Exposure key", &m_exposureKey, 0.001f, 0.01f, 1.0f, "%.3f");
+        ImGui::DragFloat("Adaptation speed", &m_adaptationSpeed, 0.01f, 0.1f, 10.0f, "%.2f");
+    }
 }
@@ -19,6 +19,20 @@ private:
 
 	// parameter for Reinhard tonemapping
 	float m_reinhardWhite = 4;
+
+	// bloom (see PostprocessPipeline::renderBloom)
+	bool m_bloom = true;
+	float m_bloomIntensity = 0.05f;
+	// luminance where the bloom starts
+	float m_bloomThreshold = 1.0f;
+	// radius of the upsample filter in texels of each level
+	float m_bloomRadius = 1.0f;
+
+	// auto exposure (see PostprocessPipeline::measureExposure): the average luminance is mapped to the key
+	bool m_autoExposure = true;
+	float m_exposureKey = 0.18f;
+	// how fast the exposure follows the measured luminance (1/seconds)
+	float m_adaptationSpeed = 1.5f;
 public:
 	/// <summary>
 	/// Used to "register" shaders so postprocessing uniforms can be set for all these shaders 
@@ -39,5 +53,11 @@ public:
 	inline void setGammaCorrection(bool value) { m_gammaCorrect = value; }
 	inline bool getGammaCorrection()const { return m_gammaCorrect; }
 	inline void setHDR(bool value) { m_hdr = value; }
+	inline bool getBloom() const { return m_bloom; }
+	inline float getBloomThreshold() const { return m_bloomThreshold; }
+	inline float getBloomRadius() const { return m_bloomRadius; }
+	inline bool getAutoExposure() const { return m_autoExposure; }
+	inline float getExposureKey() const { return m_exposureKey; }
+	inline float getAdaptationSpeed() const { return m_adaptationSpeed; }
 };
 
@@ -40,6 +40,15 @@ public:
 		glDrawArrays(GL_TRIANGLES, 0, 3);
 	}
 
+	/// <summary>
+	/// Draw the screen triangle with a shader that binds its own textures (e.g. the deferred lighting pass)
+	/// </summary>
+	void draw(Shader& shader) {
+		m_vao.bind();
+		shader.bind();
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+	}
+
 	/// <summary>
 	/// Render cubemap
 	/// </summary>
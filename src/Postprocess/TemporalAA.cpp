@@ -0,0 +1,149 @@
+#include "TemporalAA.h"
+#include "glm/gtc/matrix_transform.hpp"
+#include "imgui.h"
+
+// radical inverse of i in a base (Halton sequence), in [0, 1)
+static float halton(int i, int base)
+{
+	float result = 0.0f;
+	float fraction = 1.0f / base;
+	while (i > 0) {
+		result += (i % base) * fraction;
+		i /= base;
+		fraction /= base;
+	}
+	return result;
+}
+
+TemporalAA::TemporalAA()
+{
+	glGenSamplers(1, &m_linearSampler);
+	glSamplerParameteri(m_linearSampler, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glSamplerParameteri(m_linearSampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glSamplerParameteri(m_linearSampler, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glSamplerParameteri(m_linearSampler, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+}
+
+TemporalAA::~TemporalAA()
+{
+	glDeleteSamplers(1, &m_linearSampler);
+}
+
+void TemporalAA::bindShaders(Shader& velocityShader, Shader& resolveShader)
+{
+	velocityShader.setInt("u_depthTex", DEPTH_SLOT);
+	resolveShader.setInt("u_colorTex", COLOR_SLOT);
+	resolveShader.setInt("u_historyTex", HISTORY_SLOT);
+	resolveShader.setInt("u_velocityTex", VELOCITY_SLOT);
+}
+
+void TemporalAA::resize(unsigned int renderWidth, unsigned int renderHeight, unsigned int width, unsigned int height)
+{
+	if (!m_velocityFBO || renderWidth != m_renderWidth || renderHeight != m_renderHeight) {
+		m_renderWidth = renderWidth;
+		m_renderHeight = renderHeight;
+		m_velocityFBO = std::make_unique<Framebuffer>(renderWidth, renderHeight);
+		m_velocityFBO->addColorAttachament(GL_TEXTURE_2D, GL_RG16F);
+		m_velocityFBO->create();
+	}
+	if (!m_history[0] || width != m_width || height != m_height) {
+		m_width = width;
+		m_height = height;
+		for (auto& history : m_history) {
+			history = std::make_unique<Framebuffer>(width, height);
+			history->addColorAttachament(GL_TEXTURE_2D, GL_RGBA16F);
+			history->create();
+			// reprojected positions fall between the texels
+			glBindTexture(GL_TEXTURE_2D, history->getColorAttachment(0));
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			glBindTexture(GL_TEXTURE_2D, 0);
+		}
+		m_historyValid = false;
+	}
+}
+
+glm::mat4 TemporalAA::beginFrame(const glm::mat4& viewMatrix, const glm::mat4& projMatrix)
+{
+	m_prevViewProjMatrix = m_viewProjMatrix;
+	m_viewProjMatrix = projMatrix * viewMatrix;
+	if (!m_enabled) {
+		m_jitter = glm::vec2(0.0f);
+		m_jitteredViewProjMatrix = m_viewProjMatrix;
+		return projMatrix;
+	}
+	// sub-pixel offset in [-0.5, 0.5), the first index of the sequence is skipped (0, 0)
+	m_frame = (m_frame + 1) % JITTER_SAMPLES;
+	m_jitter = glm::vec2(halton(m_frame + 1, 2), halton(m_frame + 1, 3)) - 0.5f;
+	// the translation after the projection moves every point by the same amount in NDC (perspective and orthographic)
+	glm::vec2 offset = 2.0f * m_jitter / glm::vec2(m_renderWidth, m_renderHeight);
+	glm::mat4 jitteredProjMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(offset, 0.0f)) * projMatrix;
+	m_jitteredViewProjMatrix = jitteredProjMatrix * viewMatrix;
+	return jitteredProjMatrix;
+}
+
+void TemporalAA::resolve(Shader& velocityShader, Shader& resolveShader, ScreenQuadRenderer& quad, unsigned int color, unsigned int depth)
+{
+	if (!m_enabled) {
+		m_historyValid = false;
+		return;
+	}
+	// full screen passes, the blending of the scene is disabled
+	GLboolean blend = glIsEnabled(GL_BLEND);
+	glDisable(GL_BLEND);
+	glDisable(GL_DEPTH_TEST);
+
+	// velocity: position from the depth, projected with the view-projection of this and the previous frame
+	m_velocityFBO->bind();
+	glViewport(0, 0, m_renderWidth, m_renderHeight);
+	velocityShader.setMat4("u_inverseViewProjMatrix", glm::inverse(m_jitteredViewProjMatrix));
+	velocityShader.setMat4("u_viewProjMatrix", m_viewProjMatrix);
+	velocityShader.setMat4("u_prevViewProjMatrix", m_prevViewProjMatrix);
+	glActiveTexture(GL_TEXTURE0 + DEPTH_SLOT);
+	glBindTexture(GL_TEXTURE_2D, depth);
+	quad.draw(velocityShader);
+
+	// blend the frame into the other history buffer, at the screen size
+	int next = 1 - m_current;
+	m_history[next]->bind();
+	glViewport(0, 0, m_width, m_height);
+	resolveShader.setVec2("u_jitter", m_jitter / glm::vec2(m_renderWidth, m_renderHeight));
+	resolveShader.setFloat("u_feedback", m_feedback);
+	resolveShader.setBool("u_historyValid", m_historyValid);
+	glActiveTexture(GL_TEXTURE0 + COLOR_SLOT);
+	glBindTexture(GL_TEXTURE_2D, color);
+	glBindSampler(COLOR_SLOT, m_linearSampler);
+	glActiveTexture(GL_TEXTURE0 + HISTORY_SLOT);
+	glBindTexture(GL_TEXTURE_2D, m_history[m_current]->getColorAttachment(0));
+	glActiveTexture(GL_TEXTURE0 + VELOCITY_SLOT);
+	glBindTexture(GL_TEXTURE_2D, m_velocityFBO->getColorAttachment(0));
+	quad.draw(resolveShader);
+	glBindSampler(COLOR_SLOT, 0);
+	m_current = next;
+	m_historyValid = true;
+
+	if (blend) {
+		glEnable(GL_BLEND);
+	}
+}
+
+void TemporalAA::bindHistory(Shader& shader, unsigned int historySlot, unsigned int velocitySlot) const
+{
+	shader.setInt("u_historyTex", historySlot);
+	shader.setInt("u_velocityTex", velocitySlot);
+	shader.setBool("u_historyValid", m_enabled && m_historyValid);
+	glActiveTexture(GL_TEXTURE0 + historySlot);
+	glBindTexture(GL_TEXTURE_2D, getHistoryTexture());
+	glActiveTexture(GL_TEXTURE0 + velocitySlot);
+	glBindTexture(GL_TEXTURE_2D, getVelocityTexture());
+}
+
+void TemporalAA::imGuiRender()
+{
+	if (ImGui::Checkbox("Temporal anti-aliasing", &m_enabled)) {
+		m_historyValid = false;
+	}
+	if (m_enabled) {
+		ImGui::SliderFloat("TAA feedback", &m_feedback, 0.5f, 0.98f);
+	}
+}
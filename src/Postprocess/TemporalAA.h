@@ -0,0 +1,106 @@
+#pragma once
+#include "Framebuffer.h"
+#include "Shader.h"
+#include "ScreenQuadRenderer.h"
+#include "glm/glm.hpp"
+#include <memory>
+
+/// <summary>
+/// Temporal anti-aliasing: the projection is moved by a different sub-pixel offset every frame (Halton 2,3), and the
+/// resolve pass (shaders/taa_resolve.frag) blends the new frame into the history of the previous frames.
+/// The velocity of every pixel comes from its depth and the view-projection of the previous frame
+/// (shaders/taa_velocity.frag, camera motion only). The history is clamped to the neighbourhood of the new pixel, so
+/// moving objects and disocclusions don't leave trails. The history has the size of the screen, the scene can be
+/// rendered smaller (dynamic resolution) and is upscaled by the resolve.
+/// Other passes can reuse the history (bindHistory, shaders/temporal.partial.glsl) to accumulate effects computed
+/// at a reduced rate over several frames.
+/// </summary>
+class TemporalAA
+{
+public:
+	// length of the jitter sequence
+	static const int JITTER_SAMPLES = 8;
+	// texture slots of the resolve pass
+	static const unsigned int COLOR_SLOT = 0;
+	static const unsigned int HISTORY_SLOT = 1;
+	static const unsigned int VELOCITY_SLOT = 2;
+	static const unsigned int DEPTH_SLOT = 3;
+private:
+	bool m_enabled = true;
+	// weight of the history in the resolve
+	float m_feedback = 0.9f;
+
+	// render size (velocity) and screen size (history)
+	unsigned int m_renderWidth = 0;
+	unsigned int m_renderHeight = 0;
+	unsigned int m_width = 0;
+	unsigned int m_height = 0;
+
+	// screen space motion of the pixels since the previous frame (RG16F, uv units)
+	std::unique_ptr<Framebuffer> m_velocityFBO;
+	// resolved frames (RGBA16F, ping-pong), m_history[m_current] is the latest
+	std::unique_ptr<Framebuffer> m_history[2];
+	int m_current = 0;
+	// false until a frame was resolved into the history (after a resize or enabling)
+	bool m_historyValid = false;
+	// bilinear filtering of the color rendered at a lower resolution
+	unsigned int m_linearSampler = 0;
+
+	int m_frame = 0;
+	// offset of this frame in pixels of the render size
+	glm::vec2 m_jitter = glm::vec2(0.0f);
+	glm::mat4 m_viewProjMatrix = glm::mat4(1.0f);
+	glm::mat4 m_jitteredViewProjMatrix = glm::mat4(1.0f);
+	glm::mat4 m_prevViewProjMatrix = glm::mat4(1.0f);
+public:
+	TemporalAA();
+	~TemporalAA();
+	TemporalAA(const TemporalAA& o) = delete;
+	TemporalAA& operator=(const TemporalAA& o) = delete;
+
+	/// <summary>
+	/// Set the samplers of the velocity and resolve shaders (taa_velocity.frag, taa_resolve.frag)
+	/// </summary>
+	static void bindShaders(Shader& velocityShader, Shader& resolveShader);
+
+	/// <summary>
+	/// Recreate the velocity buffer for the render size and the history for the screen size (only if they changed)
+	/// </summary>
+	void resize(unsigned int renderWidth, unsigned int renderHeight, unsigned int width, unsigned int height);
+
+	bool isEnabled() const { return m_enabled; }
+
+	/// <summary>
+	/// Start a frame: store the view-projection (the one of the last frame becomes the previous one) and
+	/// return the projection moved by the jitter of the frame (the projection itself if TAA is disabled)
+	/// </summary>
+	glm::mat4 beginFrame(const glm::mat4& viewMatrix, const glm::mat4& projMatrix);
+
+	/// <summary>
+	/// Compute the velocity and blend the frame into the history (nothing if TAA is disabled).
+	/// The result is getHistoryTexture().
+	/// </summary>
+	/// <param name="color">: HDR color of the frame (render size)</param>
+	/// <param name="depth">: depth texture of the frame (render size)</param>
+	void resolve(Shader& velocityShader, Shader& resolveShader, ScreenQuadRenderer& quad, unsigned int color, unsigned int depth);
+
+	/// <summary>
+	/// Latest resolved color (screen size, bilinear filtering): the previous frame before resolve, this frame after it
+	/// </summary>
+	unsigned int getHistoryTexture() const { return m_history[m_current]->getColorAttachment(0); }
+	unsigned int getVelocityTexture() const { return m_velocityFBO->getColorAttachment(0); }
+	bool isHistoryValid() const { return m_historyValid; }
+	const glm::mat4& getPreviousViewProjection() const { return m_prevViewProjMatrix; }
+	// offset of this frame in pixels of the render size
+	glm::vec2 getJitter() const { return m_jitter; }
+
+	/// <summary>
+	/// Bind the history and the velocity for a pass that reprojects its previous results (shaders/temporal.partial.glsl)
+	/// </summary>
+	void bindHistory(Shader& shader, unsigned int historySlot, unsigned int velocitySlot) const;
+
+	/// <summary>
+	/// Draw the UI in ImGui: enable and feedback
+	/// </summary>
+	void imGuiRender();
+};
@@ -0,0 +1,168 @@
+#include "PassProfiler.h"
+#include <cstdio>
+#include <cfloat>
+
+PassProfiler::Scope::Scope(PassProfiler* profiler, int index) : m_profiler(profiler), m_index(index)
+{
+	m_gpuStarted = m_profiler->begin(m_index);
+	m_start = std::chrono::steady_clock::now();
+}
+
+void PassProfiler::Scope::end()
+{
+	// already ended (or moved from)
+	if (m_profiler == nullptr) return;
+	double cpuMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_start).count();
+	m_profiler->end(m_index, cpuMs, m_gpuStarted);
+	m_profiler = nullptr;
+}
+
+PassProfiler::~PassProfiler()
+{
+	for (auto& pass : m_passes) {
+		glDeleteQueries(QUERY_BUFFERS, pass.queries);
+	}
+}
+
+void PassProfiler::beginFrame()
+{
+	// the buffer used 2 frames ago is written this frame => read its results first
+	m_frameIndex = (m_frameIndex + 1) % QUERY_BUFFERS;
+	float frameTime = 0.0f;
+	bool hasResults = false;
+	for (auto& pass : m_passes) {
+		if (!pass.pending[m_frameIndex]) continue;
+
+		int available = 0;
+		glGetQueryObjectiv(pass.queries[m_frameIndex], GL_QUERY_RESULT_AVAILABLE, &available);
+		// not ready => drop the sample instead of waiting
+		pass.pending[m_frameIndex] = false;
+		if (!available) continue;
+
+		GLuint64 elapsed = 0;
+		glGetQueryObjectui64v(pass.queries[m_frameIndex], GL_QUERY_RESULT, &elapsed);
+		float gpuMs = elapsed / 1e6f;
+		addSample(pass.gpuHistory, pass.gpuHistoryIndex, pass.gpuHistoryCount, gpuMs);
+		pass.gpuTotal += gpuMs;
+		pass.gpuSamples++;
+		frameTime += gpuMs;
+		hasResults = true;
+	}
+	if (hasResults) {
+		m_gpuFrameTime = frameTime;
+	}
+}
+
+void PassProfiler::reset()
+{
+	for (auto& pass : m_passes) {
+		pass.cpuTotal = pass.gpuTotal = 0.0;
+		pass.cpuSamples = pass.gpuSamples = 0;
+	}
+}
+
+int PassProfiler::getPassIndex(const char* name)
+{
+	// compare pointers first (names are literals), then the strings
+	for (size_t i = 0; i < m_names.size(); ++i) {
+		if (m_names[i] == name) return (int)i;
+	}
+	for (size_t i = 0; i < m_passes.size(); ++i) {
+		if (m_passes[i].name == name) return (int)i;
+	}
+	Pass pass;
+	pass.name = name;
+	glGenQueries(QUERY_BUFFERS, pass.queries);
+	m_passes.push_back(pass);
+	m_names.push_back(name);
+	return (int)m_passes.size() - 1;
+}
+
+bool PassProfiler::begin(int index)
+{
+	// GPU queries can't be nested, only time the CPU for inner passes
+	if (m_gpuQueryActive) return false;
+	glBeginQuery(GL_TIME_ELAPSED, m_passes[index].queries[m_frameIndex]);
+	m_gpuQueryActive = true;
+	return true;
+}
+
+void PassProfiler::end(int index, double cpuMs, bool gpuStarted)
+{
+	Pass& pass = m_passes[index];
+	if (gpuStarted) {
+		glEndQuery(GL_TIME_ELAPSED);
+		pass.pending[m_frameIndex] = true;
+		m_gpuQueryActive = false;
+	}
+	addSample(pass.cpuHistory, pass.cpuHistoryIndex, pass.cpuHistoryCount, (float)cpuMs);
+	pass.cpuTotal += cpuMs;
+	pass.cpuSamples++;
+}
+
+void PassProfiler::addSample(float* history, int& historyIndex, int& historyCount, float value)
+{
+	history[historyIndex] = value;
+	historyIndex = (historyIndex + 1) % HISTORY_SIZE;
+	if (historyCount < HISTORY_SIZE) historyCount++;
+}
+
+float PassProfiler::Pass::averageCpu() const
+{
+	if (cpuHistoryCount == 0) return 0.0f;
+	float sum = 0.0f;
+	// the history is filled from index 0, so until it wraps only the first entries hold samples
+	for (int i = 0; i < cpuHistoryCount; ++i) sum += cpuHistory[i];
+	return sum / cpuHistoryCount;
+}
+
+float PassProfiler::Pass::averageGpu() const
+{
+	if (gpuHistoryCount == 0) return 0.0f;
+	float sum = 0.0f;
+	for (int i = 0; i < gpuHistoryCount; ++i) sum += gpuHistory[i];
+	return sum / gpuHistoryCount;
+}
+
+void PassProfiler::onRenderImGui()
+{
+	ImGui::PushStyleColor(ImGuiCol_Header, ImVec4(0.2f, 0.2f, 0.2f, 1.0f)); // Set header color
+	if (ImGui::CollapsingHeader("Pass timings")) {
+		float totalCpu = 0.0f, totalGpu = 0.0f;
+		if (ImGui::BeginTable("passes", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+			ImGui::TableSetupColumn("Pass");
+			ImGui::TableSetupColumn("CPU ms");
+			ImGui::TableSetupColumn("GPU ms");
+			ImGui::TableHeadersRow();
+			for (const auto& pass : m_passes) {
+				float cpu = pass.averageCpu();
+				float gpu = pass.averageGpu();
+				totalCpu += cpu;
+				totalGpu += gpu;
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn();
+				ImGui::TextUnformatted(pass.name.c_str());
+				ImGui::TableNextColumn();
+				ImGui::Text("%.3f", cpu);
+				ImGui::TableNextColumn();
+				ImGui::Text("%.3f", gpu);
+			}
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted("Total");
+			ImGui::TableNextColumn();
+			ImGui::Text("%.3f", totalCpu);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.3f", totalGpu);
+			ImGui::EndTable();
+		}
+
+		// GPU time graph of the last HISTORY_SIZE frames for each pass
+		for (const auto& pass : m_passes) {
+			char overlay[64];
+			snprintf(overlay, sizeof(overlay), "GPU %.3f ms", pass.averageGpu());
+			ImGui::PlotLines(pass.name.c_str(), pass.gpuHistory, HISTORY_SIZE, pass.gpuHistoryIndex, overlay, 0.0f, FLT_MAX, ImVec2(0.0f, 40.0f));
+		}
+	}
+	ImGui::PopStyleColor();
+}
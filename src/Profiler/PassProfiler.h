@@ -0,0 +1,122 @@
+#pragma once
+#include "GL/glew.h"
+#include "imgui.h"
+#include <chrono>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// Measures CPU and GPU time of named render passes.
+/// GPU time uses GL_TIME_ELAPSED queries, double-buffered: results are read two frames later
+/// and only if they are available, so reading them never stalls the pipeline.
+/// Passes must not overlap (GL_TIME_ELAPSED queries cannot be nested).
+/// </summary>
+class PassProfiler
+{
+public:
+	// number of samples kept for the graph/averages
+	static const int HISTORY_SIZE = 120;
+	// number of query objects per pass (one is written while the other is read)
+	static const int QUERY_BUFFERS = 2;
+
+	struct Pass {
+		std::string name;
+		unsigned int queries[QUERY_BUFFERS] = { 0 };
+		// true if the query was issued (has a result to read)
+		bool pending[QUERY_BUFFERS] = { false };
+
+		// rolling history in ms
+		float cpuHistory[HISTORY_SIZE] = { 0.0f };
+		float gpuHistory[HISTORY_SIZE] = { 0.0f };
+		int cpuHistoryIndex = 0;
+		int gpuHistoryIndex = 0;
+		// samples in the history (up to HISTORY_SIZE)
+		int cpuHistoryCount = 0;
+		int gpuHistoryCount = 0;
+
+		// totals since the last reset (used for benchmark averages)
+		double cpuTotal = 0.0;
+		double gpuTotal = 0.0;
+		unsigned int cpuSamples = 0;
+		unsigned int gpuSamples = 0;
+
+		// average of the samples in the history (0 if there are none)
+		float averageCpu() const;
+		float averageGpu() const;
+	};
+
+	/// <summary>
+	/// Times a pass from construction until end() is called or the object is destroyed
+	/// </summary>
+	class Scope {
+	private:
+		PassProfiler* m_profiler;
+		int m_index;
+		bool m_gpuStarted = false;
+		std::chrono::steady_clock::time_point m_start;
+	public:
+		Scope(PassProfiler* profiler, int index);
+		~Scope() { end(); }
+		Scope(const Scope& o) = delete;
+		Scope& operator=(const Scope& o) = delete;
+		// movable so it can be returned from PassProfiler::scope()
+		Scope(Scope&& o) noexcept : m_profiler(o.m_profiler), m_index(o.m_index), m_gpuStarted(o.m_gpuStarted), m_start(o.m_start) { o.m_profiler = nullptr; }
+
+		/// <summary>
+		/// Stop timing (called automatically by the destructor)
+		/// </summary>
+		void end();
+	};
+
+	PassProfiler() = default;
+	~PassProfiler();
+	PassProfiler(const PassProfiler& o) = delete;
+	PassProfiler& operator=(const PassProfiler& o) = delete;
+
+	/// <summary>
+	/// Call once at the start of every frame. Collects available GPU results from previous frames.
+	/// </summary>
+	void beginFrame();
+
+	/// <summary>
+	/// Start timing a pass. The pass is created the first time the name is used.
+	/// </summary>
+	/// <param name="name">: name shown in the UI, must be a string literal (compared by pointer first)</param>
+	Scope scope(const char* name) { return Scope(this, getPassIndex(name)); }
+
+	/// <summary>
+	/// Clear totals (e.g. after warm-up frames)
+	/// </summary>
+	void reset();
+
+	/// <summary>
+	/// Render table with average times and a graph of the GPU time per pass
+	/// </summary>
+	void onRenderImGui();
+
+	const std::vector<Pass>& getPasses() const { return m_passes; }
+
+	/// <summary>
+	/// GPU time of all passes of the last frame with results (ms), 0 before the first results
+	/// </summary>
+	float getGpuFrameTime() const { return m_gpuFrameTime; }
+private:
+	std::vector<Pass> m_passes;
+	// names as passed in (to avoid string compares for literals)
+	std::vector<const char*> m_names;
+
+	// index of query buffer written this frame
+	int m_frameIndex = 0;
+
+	// true if a GPU query is active (queries can't be nested)
+	bool m_gpuQueryActive = false;
+
+	// sum of the GPU times read in the last beginFrame that had results
+	float m_gpuFrameTime = 0.0f;
+
+	int getPassIndex(const char* name);
+	// returns true if a GPU query was started
+	bool begin(int index);
+	void end(int index, double cpuMs, bool gpuStarted);
+	static void addSample(float* history, int& historyIndex, int& historyCount, float value);
+};
@@ -1,7 +1,8 @@
 #include "Box.h"
+#include <random>
 
 Box::Box(std::unique_ptr<Scene>& scene, unsigned int width, unsigned int height)
-    : Scene(scene, width, height), m_shadowFBO(4096, 4096)
+    : Scene(scene, width, height), m_shadowAtlas(2048, 1024)
 {
     updateWidthHeight(width, height);
     
@@ -14,30 +15,65 @@ Box::Box(std::unique_ptr<Scene>& scene, unsigned int width, unsigned int height)
     m_lights.push_back(std::move(std::make_unique<PointLight>(0, glm::vec3(1.5f, 2.0f, 1.0f))));
     m_lights.push_back(std::move(std::make_unique<DirectionalLight>(1, glm::vec3(0.0f, 2.0f, 0.0f))));
     m_lights.push_back(std::move(std::make_unique<Spotlight>(2, glm::vec3(0.0f, 2.0f, 0.0f), glm::vec3(0.0f))));
+    createSmallLights();
 
-    // load shaders
-    m_shaders.resize(4);
+    // load shaders (all programs are submitted together on the first bind and compile in parallel)
+    m_fallbackShader.load("base_shader.vert", "fallback.frag");
     m_shaders[0].load("base_shader.vert", "phong.frag");
     m_shaders[1].load("base_shader.vert", "blinn.frag");
     m_shaders[2].load("base_shader.vert", "cook-torrance.frag");
     m_shaders[3].load("base_shader.vert", "toon.frag");
     m_postprocessShader.load("postprocess.vert", "postprocess.frag");
     m_toonPostProcessShader.load("postprocess.vert", "toon_postprocess.frag");
+    m_toonOutlineShader.load("postprocess.vert", "toon_outline.frag");
+    m_bloomShader.load("postprocess.vert", "bloom.frag");
+    m_luminanceShader.load("postprocess.vert", "luminance.frag");
+    m_taaVelocityShader.load("postprocess.vert", "taa_velocity.frag");
+    m_taaResolveShader.load("postprocess.vert", "taa_resolve.frag");
+    TemporalAA::bindShaders(m_taaVelocityShader, m_taaResolveShader);
+    PostprocessPipeline::bindShader(m_postprocessShader);
+    PostprocessPipeline::bindShader(m_toonPostProcessShader);
     m_shadowShader.load("shadowmap.vert", "shadowmap.frag");
+    m_cubeShadowShader.load("shadowmap_cube.vert", "shadowmap.frag", "shadowmap_cube.geom");
     m_textureDisplayShader.load("postprocess.vert", "texture_display.frag");
+    m_shadowMaskShader.load("base_shader.vert", "shadow_mask.frag");
+    m_shadowMomentsShader.load("postprocess.vert", "shadow_moments.frag");
+    m_gBufferShader.load("gbuffer.vert", "gbuffer.frag");
+    m_deferredShaders[0].load("postprocess.vert", "phong.frag");
+    m_deferredShaders[1].load("postprocess.vert", "blinn.frag");
+    m_deferredShaders[2].load("postprocess.vert", "cook-torrance.frag");
+    m_deferredShaders[3].load("postprocess.vert", "toon.frag");
+    m_fallbackShader.setUniformBlockBinding("Lights", LightUniformBuffer::BINDING);
+    for (auto& shader : m_shaders) {
+        shader.setFallback(&m_fallbackShader);
+    }
 
-    m_postProcessUI.addShaders({ &m_shaders[0], &m_shaders[1], &m_shaders[2], &m_shaders[3], &m_postprocessShader, &m_toonPostProcessShader });
+    m_postProcessUI.addShaders({ &m_shaders[0], &m_shaders[1], &m_shaders[2], &m_shaders[3], &m_postprocessShader, &m_toonPostProcessShader,
+        &m_gBufferShader, &m_deferredShaders[0], &m_deferredShaders[1], &m_deferredShaders[2], &m_deferredShaders[3] });
     m_postProcessUI.setUniforms();
     // setting uniforms
     // TODO: get screen size from config class?
 
     for (auto& shader : m_shaders) {
         shader.bind();
-        shader.setInt("u_numLights", 3);
-        for (auto& light : m_lights) {
-            light->setUniforms(shader);
-        }
+        // light data is read from the uniform buffer
+        LightUniformBuffer::bindShader(shader);
+        ClusteredLights::bindShader(shader);
+        ShadowAtlas::bindShader(shader);
+        ShadowMask::bindShader(shader);
     }
+    for (auto& shader : m_deferredShaders) {
+        shader.setKeyword("DEFERRED", true);
+        shader.bind();
+        LightUniformBuffer::bindShader(shader);
+        ClusteredLights::bindShader(shader);
+        ShadowAtlas::bindShader(shader);
+        ShadowMask::bindShader(shader);
+        GBuffer::bindShader(shader);
+    }
+    m_shadowMaskShader.bind();
+    LightUniformBuffer::bindShader(m_shadowMaskShader);
+    ShadowAtlas::bindShader(m_shadowMaskShader);
 
     // setup meshes
     std::vector<glm::mat4> wall_transforms{
@@ -107,6 +143,8 @@ Box::Box(std::unique_ptr<Scene>& scene, unsigned int width, unsigned int height)
             material->setShowPresetsUI(true);
         }
         m.name = meshNames[i];
+        // only the sphere moves (see m_animateSphere), the other casters are cached in the shadow atlas
+        m.caster.dynamic = i == 0;
         m_meshes.push_back(std::move(m));
     }
 
@@ -117,28 +155,6 @@ Box::Box(std::unique_ptr<Scene>& scene, unsigned int width, unsigned int height)
     m_lights[1]->setShadow(true);
     m_lights[2]->setShadow(true);
     m_lights[0]->setShadow(true);
-    
-    // for every light that casts shadow create a depth buffer
-    for (size_t i = 0; i < m_lights.size(); ++i) {
-        // create cube map for point light
-        if (m_lights[i]->getType() == Light::Type::POINT) {
-            unsigned int id = m_shadowFBO.addDepthAttachment(GL_TEXTURE_CUBE_MAP);
-            // set the depth maps starting from slot 8 
-            glActiveTexture(GL_TEXTURE8 + i);
-            glBindTexture(GL_TEXTURE_CUBE_MAP, id);
-        }
-        else {
-            unsigned int id = m_shadowFBO.addDepthAttachment(GL_TEXTURE_2D);
-            // set the depth maps starting from slot 8 
-            glActiveTexture(GL_TEXTURE8 + i);
-            glBindTexture(GL_TEXTURE_2D, id);
-        }
-        m_lights[i]->setShadowTextureSlot(8 + i);
-    }
-    
-    m_shadowFBO.create(); // create the shadow framebuffer
-
-    m_lights[1]->setViewProjectionParameters(Light::ViewProjectionParameters().directional(-4.0f, 4.0f, -4.0f, 4.0f, 0.1f, 12.0f, 2.8f, {0.0f, 0.0f, 1.0f}));
 }
 
 Box::~Box()
@@ -150,10 +166,17 @@ Box::~Box()
 
 void Box::onRender()
 {
-    static double time = glfwGetTime();
+    m_profiler.beginFrame();
+    // change the render scale when the GPU time left the budget
+    if (m_dynamicResolution.update(m_profiler.getGpuFrameTime())) {
+        resizeRenderTargets();
+    }
+    static double time = getTime();
     // update camera position and uniforms
-    m_camera.update(glfwGetTime() - time);
-    time = glfwGetTime();
+    m_camera.update(getTime() - time);
+    time = getTime();
+    // the scene is drawn with a sub-pixel jitter every frame (temporal anti-aliasing)
+    glm::mat4 projMatrix = m_taa.beginFrame(m_camera.getMatrix(), m_projMatrices[m_projMatrixIndex]);
     m_shaders[m_modelIndex].bind();
     m_shaders[m_modelIndex].setMat4("u_viewMatrix", m_camera.getMatrix());
     m_shaders[m_modelIndex].setVec3("u_viewPos", m_camera.getPosition());
@@ -162,68 +185,116 @@ void Box::onRender()
     * SHADOW PASS
     ******************/
 
-    // setup viewport and framebuffer
-    glViewport(0, 0, 4096, 4096);
-    m_shadowFBO.bind();
-    // enable depth testing and face culling
-    glEnable(GL_CULL_FACE);
-    glEnable(GL_DEPTH_TEST);
-    m_shadowShader.bind();
-
-    auto renderSceneShadowPass = [this]() {
-        // draw mesh
-        glCullFace(GL_BACK);
+    PassProfiler::Scope shadowPassTimer = m_profiler.scope("Shadow pass");
+    if (m_animateSphere) {
+        m_meshes[0].modelMatrix = glm::translate(glm::vec3(0.75f, -1.25f + std::abs(std::sin(3.0f * (float)time)), 0.75f));
+    }
+    // moved static casters invalidate the cached shadow maps, moved dynamic casters are drawn again
+    // (the bounds used to cull the casters per light follow the model matrix)
+    for (auto& mesh : m_meshes) {
+        if (m_shadowAtlas.updateCaster(mesh.caster, mesh.modelMatrix)) {
+            mesh.mesh->getBounds(mesh.modelMatrix, mesh.caster.boundsMin, mesh.caster.boundsMax);
+        }
+    }
+    for (auto& wall : m_wallMeshes) {
+        if (m_shadowAtlas.updateCaster(wall.caster, wall.modelMatrix)) {
+            wall.mesh->getBounds(wall.modelMatrix, wall.caster.boundsMin, wall.caster.boundsMax);
+        }
+    }
+    // size the tiles of the shadow atlas by the screen coverage of the lights (moved tiles are rendered again)
+    m_shadowAtlas.update(m_lights, m_camera.getMatrix(), m_projMatrices[m_projMatrixIndex], m_renderHeight);
+    // shadow pass of the lights scheduled by the atlas, the meshes and the walls are the casters
+    m_shadowAtlas.render(m_lights, m_shadowShader, m_cubeShadowShader, [this](Shader& shader, const ShadowAtlas::CasterFilter& filter) {
         for (const auto& mesh : m_meshes) {
-            m_shadowShader.setMat4("u_modelMatrix", mesh.modelMatrix);
-            mesh.mesh->draw(m_shadowShader);
+            if (filter(mesh.caster, mesh.modelMatrix)) mesh.mesh->draw(shader);
         }
-
+        for (const auto& wall : m_wallMeshes) {
+            if (filter(wall.caster, wall.modelMatrix)) wall.mesh->draw(shader);
+        }
+    });
+    // VSM/EVSM: blur the new shadow maps into the moments
+    m_shadowAtlas.resolveMoments(m_shadowMomentsShader, m_screenQuadRenderer);
+    shadowPassTimer.end();
+
+    // assign the small lights to the clusters of the camera frustum
+    PassProfiler::Scope clusteringTimer = m_profiler.scope("Light clustering");
+    m_clusteredLights.update(m_smallLights, m_camera.getMatrix(), m_projMatrices[m_projMatrixIndex], m_renderWidth, m_renderHeight);
+    clusteringTimer.end();
+
+    // lights (upload only the lights that changed)
+    m_lightBuffer.update(m_lights);
+    m_shadowAtlas.bindTexture();
+
+    // filter the shadows of the first lights once per pixel of the mask
+    if (m_shadowMask.isEnabled()) {
+        PassProfiler::Scope shadowMaskTimer = m_profiler.scope("Shadow mask");
+        m_shadowMask.begin();
+        glEnable(GL_CULL_FACE);
+        glEnable(GL_DEPTH_TEST);
         glCullFace(GL_BACK);
-        // draw box
+        m_shadowAtlas.setUniforms(m_shadowMaskShader);
+        m_shadowMaskShader.bind();
+        m_shadowMaskShader.setMat4("u_projMatrix", projMatrix);
+        m_shadowMaskShader.setMat4("u_viewMatrix", m_camera.getMatrix());
+        m_shadowMaskShader.setVec3("u_viewPos", m_camera.getPosition());
         for (const auto& wall : m_wallMeshes) {
-            m_shadowShader.setMat4("u_modelMatrix", wall.modelMatrix);
-            wall.mesh->draw(m_shadowShader);
+            m_shadowMaskShader.setMat4("u_modelMatrix", wall.modelMatrix);
+            wall.mesh->draw(m_shadowMaskShader);
         }
-    };
-
-    for (size_t i = 0, shadowTextureIndex = 0; i < m_lights.size(); ++i) {
-        // if light has no shadows then pass or
-        // if light doesnt need shadow update, then pass but increment shadowTextureIndex
-        if (!m_lights[i]->getShadow() || !m_lights[i]->getShadowNeedsRender()){
-            shadowTextureIndex++;
-            continue;
+        for (const auto& mesh : m_meshes) {
+            m_shadowMaskShader.setMat4("u_modelMatrix", mesh.modelMatrix);
+            mesh.mesh->draw(m_shadowMaskShader);
         }
+    }
 
-        // set far plane and light position for this light (used to write distance from light to fragment in texture)
-        m_shadowShader.setVec3("u_lightPos", m_lights[i]->getPosition());
-        m_shadowShader.setFloat("u_farPlane", m_lights[i]->getFarPlane());
-
-
-        // if it is point light render scene for each face
-        if (m_lights[i]->getType() == Light::Type::POINT) { 
-            for (int faceIndex = 0; faceIndex < 6; ++faceIndex) {
-                m_shadowShader.setMat4("u_lightSpaceMatrix", m_lights[i]->getLightSpaceMatrix()[faceIndex]);        
-                m_shadowFBO.activateDepthAttachment(shadowTextureIndex, GL_TEXTURE_CUBE_MAP_POSITIVE_X + faceIndex);
-                glClear(GL_DEPTH_BUFFER_BIT);
-                renderSceneShadowPass();
-            }
+    // bounds of all objects, the lights reaching them light the deferred pass
+    glm::vec3 sceneMin(FLT_MAX), sceneMax(-FLT_MAX);
+    if (m_deferred) {
+        /******************
+        * G-BUFFER PASS
+        ******************/
+        PassProfiler::Scope gBufferTimer = m_profiler.scope("G-buffer pass");
+        glViewport(0, 0, m_renderWidth, m_renderHeight);
+        glEnable(GL_CULL_FACE);
+        glEnable(GL_DEPTH_TEST);
+        glCullFace(GL_BACK);
+        m_gBuffer.begin();
+        m_gBufferShader.bind();
+        m_gBufferShader.setMat4("u_projMatrix", projMatrix);
+        m_gBufferShader.setMat4("u_viewMatrix", m_camera.getMatrix());
+        if (m_wireframeEnabled) {
+            glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
         }
-        else {
-            m_shadowShader.setMat4("u_lightSpaceMatrix", m_lights[i]->getLightSpaceMatrix()[0]);
-            // activate the depth attachment for this light
-            m_shadowFBO.activateDepthAttachment(shadowTextureIndex);
-            glClear(GL_DEPTH_BUFFER_BIT);
-            renderSceneShadowPass();
+        // the light meshes are only emissive
+        m_gBuffer.setUnlit(m_gBufferShader);
+        for (size_t i = 0; i < m_lights.size(); ++i) {
+            m_lights[i]->draw(m_gBufferShader);
+        }
+        // one material id per object
+        int materialId = GBuffer::UNLIT_MATERIAL + 1;
+        auto drawMesh = [this, &materialId, &sceneMin, &sceneMax](const MaterialMesh& mesh) {
+            m_gBuffer.setMaterial(m_gBufferShader, *mesh.materials[m_modelIndex], materialId++);
+            m_gBufferShader.setMat4("u_modelMatrix", mesh.modelMatrix);
+            mesh.mesh->draw(m_gBufferShader);
+            sceneMin = glm::min(sceneMin, mesh.caster.boundsMin);
+            sceneMax = glm::max(sceneMax, mesh.caster.boundsMax);
+        };
+        for (const auto& wall : m_wallMeshes) {
+            drawMesh(wall);
+        }
+        for (const auto& mesh : m_meshes) {
+            drawMesh(mesh);
+        }
+        if (m_wireframeEnabled) {
+            glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
         }
-
-        m_lights[i]->resetShadowNeedsRender();
-        shadowTextureIndex++;
     }
 
     /******************
     * LIGHTING PASS
     ******************/
-    glViewport(0, 0, m_width, m_height);
+    PassProfiler::Scope lightingPassTimer = m_profiler.scope("Lighting pass");
+    glViewport(0, 0, m_renderWidth, m_renderHeight);
     m_hdrFBO.bind();
     glEnable(GL_CULL_FACE);
     glEnable(GL_DEPTH_TEST);
@@ -231,55 +302,109 @@ void Box::onRender()
     glm::vec3 clearColor = m_postProcessUI.getGammaCorrection() ? glm::pow(glm::vec3(0.1f), glm::vec3(2.2f)) : glm::vec3(0.1f);
     glClearColor(clearColor.x, clearColor.y, clearColor.z, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    m_shaders[m_modelIndex].bind();
-    
-    m_shaders[m_modelIndex].setMat4("u_projMatrix", m_projMatrices[m_projMatrixIndex]);
-    if (m_wireframeEnabled) {
-        glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-    }
-    // lights
-    for (size_t i = 0; i < m_lights.size(); ++i) {
-        m_lights[i]->setUniforms(m_shaders[m_modelIndex]);
-        m_lights[i]->draw(m_shaders[m_modelIndex]);
+    if (m_deferred) {
+        // every pixel of the G-buffer is lit once, with the lighting model of the scene
+        Shader& shader = m_deferredShaders[m_modelIndex];
+        glDisable(GL_DEPTH_TEST);
+        // the keywords and the shader wide uniforms of the lighting model come from the first mesh,
+        // the per object parameters from the material table
+        m_meshes[0].materials[m_modelIndex]->setUniforms(shader);
+        shader.setMat4("u_viewMatrix", m_camera.getMatrix());
+        shader.setVec3("u_viewPos", m_camera.getPosition());
+        m_clusteredLights.setUniforms(shader);
+        m_shadowAtlas.setUniforms(shader);
+        m_shadowMask.setUniforms(shader);
+        m_gBuffer.setUniforms(shader, projMatrix * m_camera.getMatrix());
+        m_lightBuffer.setObjectLights(shader, sceneMin, sceneMax);
+        m_screenQuadRenderer.draw(shader);
+        glEnable(GL_DEPTH_TEST);
     }
+    else {
+        m_shaders[m_modelIndex].bind();
+    
+        m_shaders[m_modelIndex].setMat4("u_projMatrix", projMatrix);
+        m_clusteredLights.setUniforms(m_shaders[m_modelIndex]);
+        m_shadowAtlas.setUniforms(m_shaders[m_modelIndex]);
+        m_shadowMask.setUniforms(m_shaders[m_modelIndex]);
+        if (m_wireframeEnabled) {
+            glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+        }
+        // the light meshes are only emissive
+        m_shaders[m_modelIndex].setInt("u_numLights", 0);
+        for (size_t i = 0; i < m_lights.size(); ++i) {
+            m_lights[i]->draw(m_shaders[m_modelIndex]);
+        }
 
-    // draw box
-    for (const auto& wall : m_wallMeshes) {
-        wall.materials[m_modelIndex]->setUniforms(m_shaders[m_modelIndex]);
-        m_shaders[m_modelIndex].setMat4("u_modelMatrix", wall.modelMatrix);
-        wall.mesh->draw(m_shaders[m_modelIndex]);
-    }
+        // every object is lit by the lights reaching its bounding box
+        // draw box
+        for (const auto& wall : m_wallMeshes) {
+            wall.materials[m_modelIndex]->setUniforms(m_shaders[m_modelIndex]);
+            m_lightBuffer.setObjectLights(m_shaders[m_modelIndex], wall.caster.boundsMin, wall.caster.boundsMax);
+            m_shaders[m_modelIndex].setMat4("u_modelMatrix", wall.modelMatrix);
+            wall.mesh->draw(m_shaders[m_modelIndex]);
+        }
 
-    // draw meshes
-    for (const auto& mesh : m_meshes) {
-        mesh.materials[m_modelIndex]->setUniforms(m_shaders[m_modelIndex]);
-        m_shaders[m_modelIndex].setMat4("u_modelMatrix", mesh.modelMatrix);
-        mesh.mesh->draw(m_shaders[m_modelIndex]);
-    }
+        // draw meshes
+        for (const auto& mesh : m_meshes) {
+            mesh.materials[m_modelIndex]->setUniforms(m_shaders[m_modelIndex]);
+            m_lightBuffer.setObjectLights(m_shaders[m_modelIndex], mesh.caster.boundsMin, mesh.caster.boundsMax);
+            m_shaders[m_modelIndex].setMat4("u_modelMatrix", mesh.modelMatrix);
+            mesh.mesh->draw(m_shaders[m_modelIndex]);
+        }
 
-    if (m_wireframeEnabled) {
-        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+        if (m_wireframeEnabled) {
+            glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+        }
     }
-
-    // apply postprocessing and write to another FBO
-    m_outputFBO.bind();
-    glDisable(GL_DEPTH_TEST);
-    glClear(GL_COLOR_BUFFER_BIT);
-    if (m_shadowMapToDisplay != -1) {
-        m_screenQuadRenderer.render(m_shadowFBO.getDepthAttachment(m_shadowMapToDisplay), m_textureDisplayShader);
+    lightingPassTimer.end();
+
+    // blend the frame into the history (the deferred lighting pass writes no depth, the G-buffer has it)
+    PassProfiler::Scope taaTimer = m_profiler.scope("TAA");
+    unsigned int lightingColor = m_hdrFBO.getColorAttachment(0);
+    // toon outlines: detected on the jittered normals and resolved with the color, the final pass only tonemaps
+    bool toonOutline = m_taa.isEnabled() && m_modelIndex == 3;
+    if (toonOutline) {
+        m_toonOutlineFBO.bind();
+        glViewport(0, 0, m_renderWidth, m_renderHeight);
+        glDisable(GL_DEPTH_TEST);
+        m_toonOutlineShader.bind();
+        m_screenQuadRenderer.renderToon(lightingColor, m_hdrFBO.getColorAttachment(1), m_toonOutlineShader);
+        lightingColor = m_toonOutlineFBO.getColorAttachment(0);
+    }
+    m_taa.resolve(m_taaVelocityShader, m_taaResolveShader, m_screenQuadRenderer, lightingColor,
+        m_deferred ? m_gBuffer.getDepthTexture() : m_hdrFBO.getDepthAttachment(0));
+    taaTimer.end();
+    // the resolve upscales to the screen size
+    unsigned int color = m_taa.isEnabled() ? m_taa.getHistoryTexture() : lightingColor;
+
+    // bloom of the bright parts of the HDR color
+    PassProfiler::Scope bloomTimer = m_profiler.scope("Bloom");
+    m_postprocess.renderBloom(m_bloomShader, m_screenQuadRenderer, color, m_postProcessUI);
+    bloomTimer.end();
+
+    // average luminance for the exposure (read back in a later frame)
+    PassProfiler::Scope exposureTimer = m_profiler.scope("Auto exposure");
+    m_postprocess.measureExposure(m_luminanceShader, m_screenQuadRenderer, color, m_postProcessUI);
+    exposureTimer.end();
+
+    // apply postprocessing in one pass to the screen (upscaling the HDR color with dynamic resolution)
+    PassProfiler::Scope postprocessTimer = m_profiler.scope("Postprocess");
+    m_postprocess.setUpscale(!m_taa.isEnabled() && m_renderWidth < m_width, m_dynamicResolution.getSharpness());
+    m_postprocess.beginFinalPass();
+    if (m_showShadowAtlas) {
+        m_screenQuadRenderer.render(m_shadowAtlas.getTexture(), m_textureDisplayShader);
     } else
-    if (m_modelIndex != 3) {
-        m_screenQuadRenderer.render(m_hdrFBO.getColorAttachment(0), m_postprocessShader);
+    if (m_modelIndex != 3 || toonOutline) {
+        m_postprocess.setUniforms(m_postprocessShader);
+        m_screenQuadRenderer.render(color, m_postprocessShader);
     }
     else {
-        m_screenQuadRenderer.renderToon(m_hdrFBO.getColorAttachment(0), m_hdrFBO.getColorAttachment(1), m_toonPostProcessShader);
+        m_postprocess.setUniforms(m_toonPostProcessShader);
+        m_screenQuadRenderer.renderToon(color, m_hdrFBO.getColorAttachment(1), m_toonPostProcessShader);
     }
 
-    // bind default framebuffer
-    m_outputFBO.unbind();
-    glDisable(GL_DEPTH_TEST);
-    glClear(GL_COLOR_BUFFER_BIT);
-    m_screenQuadRenderer.render(m_outputFBO.getColorAttachment(0), m_textureDisplayShader);
+    m_postprocess.endFinalPass();
+    postprocessTimer.end();
 }
 
 void Box::onRenderImGui()
@@ -297,30 +422,21 @@ void Box::onRenderImGui()
             // render combox for light type
             int type = (int)m_lights[i]->getType();
             bool hadShadow = m_lights[i]->getShadow();
-            // recreate depth buffers for shadowmapping
-            unsigned int textureType = GL_TEXTURE_2D;
             if (ImGui::Combo("Type", &type, "Point\0Directional\0Spotlight\0\0")) {
                 switch (type)
                 {
                 case 0:
                     m_lights[i] = std::move(std::make_unique<PointLight>(i, m_lights[i]->getPosition()));
-                    textureType = GL_TEXTURE_CUBE_MAP;
                     break;
                 case 1:
                     m_lights[i] = std::move(std::make_unique<DirectionalLight>(i, m_lights[i]->getPosition()));
-                    m_lights[i]->setViewProjectionParameters(Light::ViewProjectionParameters().directional(-4.0f, 4.0f, -4.0f, 4.0f, 0.1f, 12.0f, 2.8f));
                     break;
                 case 2:
                     m_lights[i] = std::move(std::make_unique<Spotlight>(i, m_lights[i]->getPosition(), glm::vec3(0.0f)));
                     break;
                 }
+                // the new light gets a tile in the shadow atlas in the next frame
                 m_lights[i]->setShadow(hadShadow);
-                // recreate depth buffers for shadowmapping
-                unsigned int id = m_shadowFBO.addDepthAttachmentAtSlot(i, textureType);
-                // set the depth maps starting from slot 8 
-                glActiveTexture(GL_TEXTURE8 + i);
-                glBindTexture(textureType, id);
-                m_lights[i]->setShadowTextureSlot(8 + i);
             }
             // render the rest of UI
             m_lights[i]->imGuiRender();
@@ -330,6 +446,22 @@ void Box::onRenderImGui()
         ImGui::NewLine();
     }
 
+    // small lights (clustered, no shadows)
+    ImGui::PushStyleColor(ImGuiCol_Header, ImVec4(0.2f, 0.2f, 0.2f, 1.0f)); // Set header color
+    if (ImGui::CollapsingHeader("Small lights")) {
+        bool changed = false;
+        changed |= ImGui::SliderInt("Count", &m_smallLightCount, 0, 1024);
+        changed |= ImGui::DragFloat("Intensity", &m_smallLightIntensity, 0.01f, 0.0f, 10.0f);
+        changed |= ImGui::SliderFloat("Quadratic attenuation", &m_smallLightAttenuation, 1.0f, 1000.0f, "%.1f", ImGuiSliderFlags_Logarithmic);
+        if (changed) {
+            createSmallLights();
+        }
+        ImGui::Text("Lights: %u, light indices: %u, max lights per cluster: %u",
+            m_clusteredLights.getLightCount(), m_clusteredLights.getIndexCount(), m_clusteredLights.getMaxLightsPerCluster());
+    }
+    ImGui::PopStyleColor();
+    ImGui::NewLine();
+
     if (ImGui::Combo("Lighting model", &m_modelIndex, "Phong\0Blinn-Phong\0Cook-Torrance\0Toon\0\0")) {
         m_shaders[m_modelIndex].bind();
     }
@@ -351,39 +483,98 @@ void Box::onRenderImGui()
     }
 
     if (ImGui::Button("Screenshot")) {
-        m_outputFBO.saveColorAttachmentToPNG(0);
+        m_postprocess.requestCapture();
     }
 
     m_postProcessUI.onRenderImGui();
+    ImGui::Text("Exposure: %.3f", m_postprocess.getExposure());
 
     // enable/disable wireframes, for debug
     ImGui::Checkbox("Show wireframe", &m_wireframeEnabled);
-    ImGui::SliderInt("Shadowmap display", &m_shadowMapToDisplay, -1, 2);
+    ImGui::Checkbox("Deferred shading", &m_deferred);
+    ImGui::Checkbox("Show shadow atlas", &m_showShadowAtlas);
+    ImGui::Checkbox("Animate sphere", &m_animateSphere);
+    m_lightBuffer.imGuiRender();
+    m_shadowAtlas.imGuiRender();
+    m_shadowMask.imGuiRender();
+    if (m_dynamicResolution.imGuiRender()) {
+        resizeRenderTargets();
+    }
+    m_taa.imGuiRender();
     ImGui::SliderInt("Projection matrix", &m_projMatrixIndex, 0, 1);
 
+    m_profiler.onRenderImGui();
     ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
 }
 
+void Box::createSmallLights()
+{
+    m_smallLights.clear();
+    // same positions every time the count changes
+    std::mt19937 random(0);
+    std::uniform_real_distribution<float> coord(-1.8f, 1.8f);
+    std::uniform_real_distribution<float> offset(0.05f, 0.3f);
+    std::uniform_real_distribution<float> hue(0.0f, 6.0f);
+    for (int i = 0; i < m_smallLightCount; ++i) {
+        // random point on a wall (left, front, right, top, bottom) moved a bit towards the center
+        glm::vec3 position(coord(random), coord(random), coord(random));
+        int wall = i % 5;
+        int axis = (wall == 1) ? 2 : (wall == 3 || wall == 4) ? 1 : 0;
+        float side = (wall == 2 || wall == 3) ? 1.0f : -1.0f;
+        position[axis] = side * (2.0f - offset(random));
+
+        // saturated color from the hue
+        float h = hue(random);
+        glm::vec3 color = glm::clamp(glm::vec3(std::abs(h - 3.0f) - 1.0f, 2.0f - std::abs(h - 2.0f), 2.0f - std::abs(h - 4.0f)), 0.0f, 1.0f);
+
+        // index -1: not in the "Lights" uniform buffer
+        auto light = std::make_unique<PointLight>(-1, position, color);
+        light->setIntensity(m_smallLightIntensity);
+        light->setAttenuation({ 1.0f, 0.0f, m_smallLightAttenuation });
+        light->disableDraw();
+        m_smallLights.push_back(std::move(light));
+    }
+}
+
 void Box::updateWidthHeight(unsigned width, unsigned height)
 {
     m_width = width;
     m_height = height;
-    m_hdrFBO = Framebuffer(width, height);
-    m_hdrFBO.addColorAttachament(GL_TEXTURE_2D, GL_RGBA16F);
-    m_hdrFBO.addColorAttachament(GL_TEXTURE_2D, GL_RGBA16F);
-    m_hdrFBO.addDepthAttachment(GL_RENDERBUFFER);
-    m_hdrFBO.create();
-    // setup output FBO (after postprocessing)
-    m_outputFBO = Framebuffer(width, height);
-    m_outputFBO.addColorAttachament(GL_TEXTURE_2D, GL_RGB);
-    m_outputFBO.create();
+    m_postprocess.resize(width, height);
+    resizeRenderTargets();
 
     float ratio = 1.0f * m_width / m_height;
     m_projMatrices = {
         glm::infinitePerspective(glm::radians(60.0f), ratio, 0.1f),
         glm::ortho(-3.0f * ratio, 3.0f * ratio, -3.0f, 3.0f, -3.0f, 10.0f)
     };
-    // set new width/height in toon post process shader
-    m_toonPostProcessShader.setFloat("u_textureWidth", m_width);
-    m_toonPostProcessShader.setFloat("u_textureHeight", m_height);
+}
+
+void Box::resizeRenderTargets()
+{
+    float scale = m_dynamicResolution.getScale();
+    unsigned int width = std::max(1u, (unsigned int)(m_width * scale));
+    unsigned int height = std::max(1u, (unsigned int)(m_height * scale));
+    m_taa.resize(width, height, m_width, m_height);
+    if (width == m_renderWidth && height == m_renderHeight) {
+        return;
+    }
+    m_renderWidth = width;
+    m_renderHeight = height;
+    m_hdrFBO = Framebuffer(width, height);
+    m_hdrFBO.addColorAttachament(GL_TEXTURE_2D, GL_RGBA16F);
+    m_hdrFBO.addColorAttachament(GL_TEXTURE_2D, GL_RGBA16F);
+    // sampled by the velocity pass of the temporal anti-aliasing
+    m_hdrFBO.addDepthAttachment(GL_TEXTURE_2D, GL_DEPTH_COMPONENT24);
+    m_hdrFBO.create();
+    m_toonOutlineFBO = Framebuffer(width, height);
+    m_toonOutlineFBO.addColorAttachament(GL_TEXTURE_2D, GL_RGBA16F);
+    m_toonOutlineFBO.create();
+    m_shadowMask.resize(width, height);
+    m_gBuffer.resize(width, height);
+    // set new width/height in the toon shaders
+    m_toonPostProcessShader.setFloat("u_textureWidth", width);
+    m_toonPostProcessShader.setFloat("u_textureHeight", height);
+    m_toonOutlineShader.setFloat("u_textureWidth", width);
+    m_toonOutlineShader.setFloat("u_textureHeight", height);
 }
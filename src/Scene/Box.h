@@ -6,7 +6,6 @@
 #include "VAO.h"
 #include "Buffer/EBO.h"
 #include "glm/gtc/matrix_transform.hpp"
-#include "GLFW/glfw3.h" // for deltaTime(glfwGetTime) in rendering
 #include "Camera.h"
 #include "Event/EventManager.h" // for registering camera
 #include "Mesh.h"
@@ -17,9 +16,17 @@
 #include "Light/DirectionalLight.h"
 #include "Light/PointLight.h"
 #include "Light/SpotLight.h"
+#include "Light/LightUniformBuffer.h"
+#include "Light/ClusteredLights.h"
+#include "Light/ShadowAtlas.h"
+#include "Light/ShadowMask.h"
 #include "Framebuffer.h"
+#include "GBuffer.h"
 #include "Postprocess/PostprocessUI.h"
 #include "Postprocess/ScreenQuadRenderer.h"
+#include "Postprocess/PostprocessPipeline.h"
+#include "Postprocess/DynamicResolution.h"
+#include "Postprocess/TemporalAA.h"
 #include "Model.h"
 
 class Box : public Scene
@@ -30,12 +37,26 @@ private:
 		glm::mat4 modelMatrix;
 		std::unique_ptr<Mesh> mesh;
 		std::string name;
+		// static or dynamic shadow caster
+		ShadowAtlas::Caster caster;
 	};
 
 	Framebuffer m_hdrFBO;
-	Framebuffer m_shadowFBO;
-	// framebuffer used to output after postprocessing
-	Framebuffer m_outputFBO;
+	// shadow maps of all lights
+	ShadowAtlas m_shadowAtlas;
+	// filtered shadows of the first lights at reduced resolution
+	ShadowMask m_shadowMask;
+	// final postprocess pass to the screen (and screenshots)
+	PostprocessPipeline m_postprocess;
+	// scale of the render targets of the scene, from the GPU frame time
+	DynamicResolution m_dynamicResolution;
+	// size of the render targets of the scene (window size * render scale)
+	unsigned int m_renderWidth = 0;
+	unsigned int m_renderHeight = 0;
+	// jitter of the projection and resolve into the history, before the other postprocess passes
+	TemporalAA m_taa;
+	// HDR color with the toon outlines, resolved by the temporal anti-aliasing (render size)
+	Framebuffer m_toonOutlineFBO;
 
 	ScreenQuadRenderer m_screenQuadRenderer;
 	std::vector<MaterialMesh> m_meshes;
@@ -58,13 +79,47 @@ private:
 
 	// all lights in the scene
 	std::vector<std::unique_ptr<Light> > m_lights;
+	// uniform buffer with the data of all lights
+	LightUniformBuffer m_lightBuffer;
+
+	// many small point lights without shadows, lit with clustered forward lighting
+	std::vector<std::unique_ptr<Light> > m_smallLights;
+	ClusteredLights m_clusteredLights;
+	int m_smallLightCount = 0;
+	float m_smallLightIntensity = 1.0f;
+	// quadratic attenuation of the small lights (sets their range)
+	float m_smallLightAttenuation = 250.0f;
 
 	Camera m_camera;
-	std::vector<Shader> m_shaders;
+	Shader m_shaders[4];
+	// drawn while the lighting shaders are compiling
+	Shader m_fallbackShader;
 	Shader m_postprocessShader;
 	Shader m_toonPostProcessShader;
+	// toon outlines drawn before the temporal anti-aliasing
+	Shader m_toonOutlineShader;
+	// downsamples/upsamples the bloom chain
+	Shader m_bloomShader;
+	// log luminance for the auto exposure
+	Shader m_luminanceShader;
+	// velocity buffer and resolve of the temporal anti-aliasing
+	Shader m_taaVelocityShader;
+	Shader m_taaResolveShader;
 	Shader m_shadowShader;
+	// renders the 6 faces of a point light shadow map in one pass
+	Shader m_cubeShadowShader;
+	// writes the shadow mask
+	Shader m_shadowMaskShader;
+	// converts the shadow atlas to blurred moments (VSM/EVSM)
+	Shader m_shadowMomentsShader;
 	Shader m_textureDisplayShader; // simple shader that displays texture
+
+	// deferred shading: the scene is drawn once to the G-buffer, then every pixel is lit once
+	bool m_deferred = false;
+	GBuffer m_gBuffer;
+	Shader m_gBufferShader;
+	// lighting shaders with the DEFERRED keyword (same lighting models as m_shaders)
+	Shader m_deferredShaders[4];
 	
 	std::vector<glm::mat4> m_projMatrices;
 
@@ -73,8 +128,13 @@ private:
 	// enable/disable wireframes, for debug
 	bool m_wireframeEnabled = false;
 
-	int m_shadowMapToDisplay = -1; // index of shadowmap to display
+	bool m_showShadowAtlas = false; // display the shadow atlas instead of the scene
+	bool m_animateSphere = false; // bounce the sphere (dynamic shadow caster)
 	int m_projMatrixIndex = 0; // index of active projection matrix
+	// recreate the small lights at random positions near the walls
+	void createSmallLights();
+	// (re)create the render targets of the scene at the window size * render scale
+	void resizeRenderTargets();
 public:
 	Box(std::unique_ptr<Scene>& scene, unsigned int width, unsigned int height);
 	~Box();
@@ -1,7 +1,7 @@
 #include "ModelTestScene.h"
 
 ModelTestScene::ModelTestScene(std::unique_ptr<Scene>& scene, unsigned int width, unsigned int height)
-    : Scene(scene, width, height), m_shadowFBO(2048, 2048)
+    : Scene(scene, width, height), m_shadowAtlas(2048, 1024)
 {
     updateWidthHeight(width, height);
 
@@ -20,20 +20,31 @@ ModelTestScene::ModelTestScene(std::unique_ptr<Scene>& scene, unsigned int width
     m_lights[2]->disable();
     m_lights[2]->disableDraw();
 
-    // load shaders
+    // load shaders (all programs are submitted together on the first bind and compile in parallel)
+    m_fallbackShader.load("base_shader.vert", "fallback.frag");
     m_shader.load("base_shader.vert", "cook-torrance.frag");
     m_postprocessShader.load("postprocess.vert", "postprocess.frag");
+    m_bloomShader.load("postprocess.vert", "bloom.frag");
+    m_luminanceShader.load("postprocess.vert", "luminance.frag");
+    PostprocessPipeline::bindShader(m_postprocessShader);
     m_shadowShader.load("shadowmap.vert", "shadowmap.frag");
-    m_textureDisplayShader.load("postprocess.vert", "texture_display.frag");
+    m_cubeShadowShader.load("shadowmap_cube.vert", "shadowmap.frag", "shadowmap_cube.geom");
+    m_shadowMaskShader.load("base_shader.vert", "shadow_mask.frag");
+    m_shadowMomentsShader.load("postprocess.vert", "shadow_moments.frag");
+    m_fallbackShader.setUniformBlockBinding("Lights", LightUniformBuffer::BINDING);
+    m_shader.setFallback(&m_fallbackShader);
 
     m_postProcessUI.addShaders({ &m_shader, &m_postprocessShader });
     m_postProcessUI.setUniforms();
     // setting uniforms
     m_shader.setMat4("u_projMatrix", m_projMatrix);
-    m_shader.setInt("u_numLights", m_lights.size());
-    for (auto& light : m_lights) {
-        light->setUniforms(m_shader);
-    }
+    // light data is read from the uniform buffer
+    LightUniformBuffer::bindShader(m_shader);
+    ShadowAtlas::bindShader(m_shader);
+    ShadowMask::bindShader(m_shader);
+    m_shadowMaskShader.bind();
+    LightUniformBuffer::bindShader(m_shadowMaskShader);
+    ShadowAtlas::bindShader(m_shadowMaskShader);
     
     // setup default uniform values
     m_material.setUniforms(m_shader);
@@ -83,26 +94,6 @@ ModelTestScene::ModelTestScene(std::unique_ptr<Scene>& scene, unsigned int width
     m_lights[1]->setShadow(true);
     m_lights[0]->setShadow(true);
 
-    // for every light that casts shadow create a depth buffer
-    for (size_t i = 0; i < m_lights.size(); ++i) {
-        // create cube map for point light
-        if (m_lights[i]->getType() == Light::Type::POINT) {
-            unsigned int id = m_shadowFBO.addDepthAttachment(GL_TEXTURE_CUBE_MAP);
-            // set the depth maps starting from slot 8 
-            glActiveTexture(GL_TEXTURE8 + i);
-            glBindTexture(GL_TEXTURE_CUBE_MAP, id);
-        }
-        else {
-            unsigned int id = m_shadowFBO.addDepthAttachment(GL_TEXTURE_2D);
-            // set the depth maps starting from slot 8 
-            glActiveTexture(GL_TEXTURE8 + i);
-            glBindTexture(GL_TEXTURE_2D, id);
-        }
-        m_lights[i]->setShadowTextureSlot(8 + i);
-    }
-
-    m_shadowFBO.create(); // create the shadow framebuffer
-
     // set view proj parameters for lights
     m_lights[0]->setViewProjectionParameters(Light::ViewProjectionParameters().point(1.0f, 0.02f, 12.0f));
     m_lights[1]->setViewProjectionParameters(Light::ViewProjectionParameters().point(1.0f, 0.02f, 12.0f));
@@ -113,6 +104,7 @@ ModelTestScene::ModelTestScene(std::unique_ptr<Scene>& scene, unsigned int width
     m_models.resize(6);
     m_models[0].load("models/chair/chair.dae");
     m_models[0].m_modelMatrix = glm::translate(glm::vec3(0.5f, -1.52f, -0.1f)) * glm::scale(glm::vec3(0.5f));
+    m_chairMatrix = m_models[0].m_modelMatrix;
     m_models[1].load("models/desk/desk.dae");
     m_models[1].m_modelMatrix = glm::translate(glm::vec3(1.46f, -1.55f, 0.0f)) * glm::rotate(glm::radians(180.0f), glm::vec3(0.0f, 1.0f, 0.0f)) * glm::scale(glm::vec3(1.0f));
     m_models[2].load("models/lamp/lamp.obj");
@@ -126,6 +118,10 @@ ModelTestScene::ModelTestScene(std::unique_ptr<Scene>& scene, unsigned int width
 
     m_models[5].load("models/books/books.gltf");
     m_models[5].m_modelMatrix = glm::translate(glm::vec3(1.6f, -1.1f, 0.0f)) * glm::rotate(glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f)) * glm::scale(glm::vec3(0.1f));
+
+    // walls, desk, lamp, bookshelf and books never move: their shadows are cached in the shadow atlas
+    m_modelCasters.resize(m_models.size());
+    m_modelCasters[0].dynamic = true;
 }
 
 ModelTestScene::~ModelTestScene()
@@ -137,10 +133,11 @@ ModelTestScene::~ModelTestScene()
 
 void ModelTestScene::onRender()
 {
-    static double time = glfwGetTime();
+    m_profiler.beginFrame();
+    static double time = getTime();
     // update camera position and uniforms
-    m_camera.update(glfwGetTime() - time);
-    time = glfwGetTime();
+    m_camera.update(getTime() - time);
+    time = getTime();
     
     m_shader.setMat4("u_viewMatrix", m_camera.getMatrix());
     m_shader.setVec3("u_viewPos", m_camera.getPosition());
@@ -149,66 +146,67 @@ void ModelTestScene::onRender()
     * SHADOW PASS
     ******************/
 
-    // setup viewport and framebuffer
-    glViewport(0, 0, 2048, 2048);
-    m_shadowFBO.bind();
-    // enable depth testing and face culling
-    glEnable(GL_CULL_FACE);
-    glEnable(GL_DEPTH_TEST);
-    m_shadowShader.bind();
-
-    auto renderSceneShadowPass = [this]() {
-        glCullFace(GL_BACK);
-        // draw box
-        for (const auto& wall : m_wallMeshes) {
-            m_shadowShader.setMat4("u_modelMatrix", wall.modelMatrix);
-            wall.mesh->draw(m_shadowShader);
+    PassProfiler::Scope shadowPassTimer = m_profiler.scope("Shadow pass");
+    if (m_animateChair) {
+        m_models[0].m_modelMatrix = m_chairMatrix * glm::rotate(0.5f * std::sin((float)time), glm::vec3(0.0f, 1.0f, 0.0f));
+    }
+    // moved static casters invalidate the cached shadow maps, moved dynamic casters are drawn again
+    // (the bounds used to cull the casters per light follow the model matrix)
+    for (auto& wall : m_wallMeshes) {
+        if (m_shadowAtlas.updateCaster(wall.caster, wall.modelMatrix)) {
+            wall.mesh->getBounds(wall.modelMatrix, wall.caster.boundsMin, wall.caster.boundsMax);
         }
-
-        // draw models
-        for (auto& model : m_models) {
-            m_shadowShader.setMat4("u_modelMatrix", model.m_modelMatrix);
-            model.draw(m_shadowShader);
+    }
+    for (size_t i = 0; i < m_models.size(); ++i) {
+        if (m_shadowAtlas.updateCaster(m_modelCasters[i], m_models[i].m_modelMatrix)) {
+            m_models[i].getBounds(m_modelCasters[i].boundsMin, m_modelCasters[i].boundsMax);
         }
-    };
-
-    for (size_t i = 0, shadowTextureIndex = 0; i < m_lights.size(); ++i) {
-        // if light has no shadows then pass or
-        // if light doesnt need shadow update, then pass but increment shadowTextureIndex
-        if (!m_lights[i]->getShadow() || !m_lights[i]->getShadowNeedsRender()) {
-            shadowTextureIndex++;
-            continue;
+    }
+    // size the tiles of the shadow atlas by the screen coverage of the lights (moved tiles are rendered again)
+    m_shadowAtlas.update(m_lights, m_camera.getMatrix(), m_projMatrix, m_height);
+    // shadow pass of the lights scheduled by the atlas, the walls and the models are the casters
+    m_shadowAtlas.render(m_lights, m_shadowShader, m_cubeShadowShader, [this](Shader& shader, const ShadowAtlas::CasterFilter& filter) {
+        for (const auto& wall : m_wallMeshes) {
+            if (filter(wall.caster, wall.modelMatrix)) wall.mesh->draw(shader);
         }
-
-        // set far plane and light position for this light (used to write distance from light to fragment in texture)
-        m_shadowShader.setVec3("u_lightPos", m_lights[i]->getPosition());
-        m_shadowShader.setFloat("u_farPlane", m_lights[i]->getFarPlane());
-
-
-        // if it is point light render scene for each face
-        if (m_lights[i]->getType() == Light::Type::POINT) {
-            for (int faceIndex = 0; faceIndex < 6; ++faceIndex) {
-                m_shadowShader.setMat4("u_lightSpaceMatrix", m_lights[i]->getLightSpaceMatrix()[faceIndex]);
-                m_shadowFBO.activateDepthAttachment(shadowTextureIndex, GL_TEXTURE_CUBE_MAP_POSITIVE_X + faceIndex);
-                glClear(GL_DEPTH_BUFFER_BIT);
-                renderSceneShadowPass();
-            }
+        for (size_t i = 0; i < m_models.size(); ++i) {
+            if (filter(m_modelCasters[i], m_models[i].m_modelMatrix)) m_models[i].draw(shader);
         }
-        else {
-            m_shadowShader.setMat4("u_lightSpaceMatrix", m_lights[i]->getLightSpaceMatrix()[0]);
-            // activate the depth attachment for this light
-            m_shadowFBO.activateDepthAttachment(shadowTextureIndex);
-            glClear(GL_DEPTH_BUFFER_BIT);
-            renderSceneShadowPass();
+    });
+    // VSM/EVSM: blur the new shadow maps into the moments
+    m_shadowAtlas.resolveMoments(m_shadowMomentsShader, m_screenQuadRenderer);
+    shadowPassTimer.end();
+
+    // lights (upload only the lights that changed)
+    m_lightBuffer.update(m_lights);
+    m_shadowAtlas.bindTexture();
+
+    // filter the shadows of the first lights once per pixel of the mask
+    if (m_shadowMask.isEnabled()) {
+        PassProfiler::Scope shadowMaskTimer = m_profiler.scope("Shadow mask");
+        m_shadowMask.begin();
+        glEnable(GL_CULL_FACE);
+        glEnable(GL_DEPTH_TEST);
+        glCullFace(GL_BACK);
+        m_shadowAtlas.setUniforms(m_shadowMaskShader);
+        m_shadowMaskShader.bind();
+        m_shadowMaskShader.setMat4("u_projMatrix", m_projMatrix);
+        m_shadowMaskShader.setMat4("u_viewMatrix", m_camera.getMatrix());
+        m_shadowMaskShader.setVec3("u_viewPos", m_camera.getPosition());
+        for (const auto& wall : m_wallMeshes) {
+            m_shadowMaskShader.setMat4("u_modelMatrix", wall.modelMatrix);
+            wall.mesh->draw(m_shadowMaskShader);
+        }
+        for (auto& model : m_models) {
+            m_shadowMaskShader.setMat4("u_modelMatrix", model.m_modelMatrix);
+            model.draw(m_shadowMaskShader);
         }
-
-        m_lights[i]->resetShadowNeedsRender();
-        shadowTextureIndex++;
     }
 
     /******************
     * LIGHTING PASS
     ******************/
+    PassProfiler::Scope lightingPassTimer = m_profiler.scope("Lighting pass");
     glViewport(0, 0, m_width, m_height);
     m_hdrFBO.bind();
     glEnable(GL_CULL_FACE);
@@ -219,19 +217,23 @@ void ModelTestScene::onRender()
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     m_shader.setMat4("u_projMatrix", m_projMatrix);
     m_material.setUniforms(m_shader);
+    m_shadowAtlas.setUniforms(m_shader);
+    m_shadowMask.setUniforms(m_shader);
 
     if (m_wireframeEnabled) {
         glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
     }
-    // lights
+    // the light meshes are only emissive
+    m_shader.setInt("u_numLights", 0);
     for (size_t i = 0; i < m_lights.size(); ++i) {
-        m_lights[i]->setUniforms(m_shader);
         m_lights[i]->draw(m_shader);
     }
 
+    // every object is lit by the lights reaching its bounding box
     // draw box
     for (const auto& wall : m_wallMeshes) {
         //wall.materials[m_modelIndex]->setUniforms(m_shader);
+        m_lightBuffer.setObjectLights(m_shader, wall.caster.boundsMin, wall.caster.boundsMax);
         m_shader.setMat4("u_modelMatrix", wall.modelMatrix);
         m_shader.setFloat("u_textureScaleX", wall.textureScaleX);
         m_shader.setFloat("u_textureScaleY", wall.textureScaleY);
@@ -241,26 +243,34 @@ void ModelTestScene::onRender()
     m_shader.setFloat("u_textureScaleY", 1.0f);
 
     // draw models
-    for (auto& model : m_models) {
-        m_shader.setMat4("u_modelMatrix", model.m_modelMatrix);
-        model.draw(m_shader);
+    for (size_t i = 0; i < m_models.size(); ++i) {
+        m_lightBuffer.setObjectLights(m_shader, m_modelCasters[i].boundsMin, m_modelCasters[i].boundsMax);
+        m_shader.setMat4("u_modelMatrix", m_models[i].m_modelMatrix);
+        m_models[i].draw(m_shader);
     }
 
     if (m_wireframeEnabled) {
         glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
     }
-
-    // apply postprocessing and write to another FBO
-    m_outputFBO.bind();
-    glDisable(GL_DEPTH_TEST);
-    glClear(GL_COLOR_BUFFER_BIT);
+    lightingPassTimer.end();
+
+    // bloom of the bright parts of the HDR color
+    PassProfiler::Scope bloomTimer = m_profiler.scope("Bloom");
+    m_postprocess.renderBloom(m_bloomShader, m_screenQuadRenderer, m_hdrFBO.getColorAttachment(0), m_postProcessUI);
+    bloomTimer.end();
+
+    // average luminance for the exposure (read back in a later frame)
+    PassProfiler::Scope exposureTimer = m_profiler.scope("Auto exposure");
+    m_postprocess.measureExposure(m_luminanceShader, m_screenQuadRenderer, m_hdrFBO.getColorAttachment(0), m_postProcessUI);
+    exposureTimer.end();
+
+    // apply postprocessing in one pass to the screen
+    PassProfiler::Scope postprocessTimer = m_profiler.scope("Postprocess");
+    m_postprocess.beginFinalPass();
+    m_postprocess.setUniforms(m_postprocessShader);
     m_screenQuadRenderer.render(m_hdrFBO.getColorAttachment(0), m_postprocessShader);
-
-    // bind default framebuffer
-    m_outputFBO.unbind();
-    glDisable(GL_DEPTH_TEST);
-    glClear(GL_COLOR_BUFFER_BIT);
-    m_screenQuadRenderer.render(m_outputFBO.getColorAttachment(0), m_textureDisplayShader);
+    m_postprocess.endFinalPass();
+    postprocessTimer.end();
 }
 
 void ModelTestScene::onRenderImGui()
@@ -278,14 +288,11 @@ void ModelTestScene::onRenderImGui()
             // render combox for light type
             int type = (int)m_lights[i]->getType();
             bool hadShadow = m_lights[i]->getShadow();
-            // recreate depth buffers for shadowmapping
-            unsigned int textureType = GL_TEXTURE_2D;
             if (ImGui::Combo("Type", &type, "Point\0Directional\0Spotlight\0\0")) {
                 switch (type)
                 {
                 case 0:
                     m_lights[i] = std::move(std::make_unique<PointLight>(i, m_lights[i]->getPosition()));
-                    textureType = GL_TEXTURE_CUBE_MAP;
                     break;
                 case 1:
                     m_lights[i] = std::move(std::make_unique<DirectionalLight>(i, m_lights[i]->getPosition()));
@@ -294,13 +301,8 @@ void ModelTestScene::onRenderImGui()
                     m_lights[i] = std::move(std::make_unique<Spotlight>(i, m_lights[i]->getPosition(), glm::vec3(0.0f)));
                     break;
                 }
+                // the new light gets a tile in the shadow atlas in the next frame
                 m_lights[i]->setShadow(hadShadow);
-                // recreate depth buffers for shadowmapping
-                unsigned int id = m_shadowFBO.addDepthAttachmentAtSlot(i, textureType);
-                // set the depth maps starting from slot 8 
-                glActiveTexture(GL_TEXTURE8 + i);
-                glBindTexture(textureType, id);
-                m_lights[i]->setShadowTextureSlot(8 + i);
             }
             // render the rest of UI
             m_lights[i]->imGuiRender();
@@ -320,14 +322,20 @@ void ModelTestScene::onRenderImGui()
     }
 
     if (ImGui::Button("Screenshot")) {
-        m_outputFBO.saveColorAttachmentToPNG(0);
+        m_postprocess.requestCapture();
     }
 
     m_postProcessUI.onRenderImGui();
+    ImGui::Text("Exposure: %.3f", m_postprocess.getExposure());
 
     // enable/disable wireframes, for debug
     ImGui::Checkbox("Show wireframe", &m_wireframeEnabled);
+    ImGui::Checkbox("Animate chair", &m_animateChair);
+    m_lightBuffer.imGuiRender();
+    m_shadowAtlas.imGuiRender();
+    m_shadowMask.imGuiRender();
 
+    m_profiler.onRenderImGui();
     ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
 }
 
@@ -339,10 +347,8 @@ void ModelTestScene::updateWidthHeight(unsigned int width, unsigned int height)
     m_hdrFBO.addColorAttachament(GL_TEXTURE_2D, GL_RGBA16F);
     m_hdrFBO.addDepthAttachment(GL_RENDERBUFFER);
     m_hdrFBO.create();
-    // setup output FBO (after postprocessing)
-    m_outputFBO = Framebuffer(width, height);
-    m_outputFBO.addColorAttachament(GL_TEXTURE_2D, GL_RGB);
-    m_outputFBO.create();
+    m_postprocess.resize(width, height);
+    m_shadowMask.resize(width, height);
 
 
     m_projMatrix = glm::infinitePerspective(glm::radians(60.0f), 1.0f * m_width / m_height, 0.1f);
@@ -6,7 +6,6 @@
 #include "VAO.h"
 #include "Buffer/EBO.h"
 #include "glm/gtc/matrix_transform.hpp"
-#include "GLFW/glfw3.h" // for deltaTime(glfwGetTime) in rendering
 #include "Camera.h"
 #include "Event/EventManager.h" // for registering camera
 #include "Mesh.h"
@@ -16,9 +15,13 @@
 #include "Light/DirectionalLight.h"
 #include "Light/PointLight.h"
 #include "Light/SpotLight.h"
+#include "Light/LightUniformBuffer.h"
+#include "Light/ShadowAtlas.h"
+#include "Light/ShadowMask.h"
 #include "Framebuffer.h"
 #include "Postprocess/PostprocessUI.h"
 #include "Postprocess/ScreenQuadRenderer.h"
+#include "Postprocess/PostprocessPipeline.h"
 #include "Model.h"
 
 class ModelTestScene : public Scene
@@ -30,12 +33,17 @@ private:
 		std::string name;
 		float textureScaleX = 1.0f;
 		float textureScaleY = 1.0f;
+		// static or dynamic shadow caster
+		ShadowAtlas::Caster caster;
 	};
 
 	Framebuffer m_hdrFBO;
-	// framebuffer used to output after postprocessing
-	Framebuffer m_outputFBO;
-	Framebuffer m_shadowFBO;
+	// final postprocess pass to the screen (and screenshots)
+	PostprocessPipeline m_postprocess;
+	// shadow maps of all lights
+	ShadowAtlas m_shadowAtlas;
+	// filtered shadows of the first lights at reduced resolution
+	ShadowMask m_shadowMask;
 	ScreenQuadRenderer m_screenQuadRenderer;
 	std::vector<MaterialMesh> m_meshes;
 	std::vector<MaterialMesh> m_wallMeshes;
@@ -57,12 +65,25 @@ private:
 
 	// all lights in the scene
 	std::vector<std::unique_ptr<Light> > m_lights;
+	// uniform buffer with the data of all lights
+	LightUniformBuffer m_lightBuffer;
 
 	Camera m_camera;
 	Shader m_shader;
+	// drawn while m_shader is compiling
+	Shader m_fallbackShader;
 	Shader m_postprocessShader;
+	// downsamples/upsamples the bloom chain
+	Shader m_bloomShader;
+	// log luminance for the auto exposure
+	Shader m_luminanceShader;
 	Shader m_shadowShader;
-	Shader m_textureDisplayShader;
+	// renders the 6 faces of a point light shadow map in one pass
+	Shader m_cubeShadowShader;
+	// writes the shadow mask
+	Shader m_shadowMaskShader;
+	// converts the shadow atlas to blurred moments (VSM/EVSM)
+	Shader m_shadowMomentsShader;
 
 	std::vector<glm::mat4> m_modelMatrix;
 	glm::mat4 m_viewMatrix = glm::mat4(1.0f);
@@ -76,6 +97,11 @@ private:
 	bool m_wireframeEnabled = false;
 	
 	std::vector<Model> m_models;
+	// shadow caster state of every model (same order as m_models)
+	std::vector<ShadowAtlas::Caster> m_modelCasters;
+	// turn the chair (the only dynamic shadow caster)
+	bool m_animateChair = false;
+	glm::mat4 m_chairMatrix = glm::mat4(1.0f);
 public:
 	ModelTestScene(std::unique_ptr<Scene>& scene, unsigned int width, unsigned int height);
 	~ModelTestScene();
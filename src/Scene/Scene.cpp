@@ -1,5 +1,6 @@
 #include "Scene.h"
 #include "SceneMenu.h"
+#include <chrono>
 
 bool Scene::renderImGuiBackButton()
 {
@@ -27,3 +28,9 @@ void Scene::helpPoput(const char* text)
         ImGui::EndTooltip();
     }
 }
+
+double Scene::getTime()
+{
+    static const auto start = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
@@ -2,6 +2,7 @@
 #include <memory>
 #include "GL/glew.h"
 #include <imgui.h>
+#include "Profiler/PassProfiler.h"
 
 class Scene
 {
@@ -10,6 +11,8 @@ protected:
 
 	unsigned int m_width = 0;
 	unsigned int m_height = 0;
+	// CPU/GPU time of each render pass
+	PassProfiler m_profiler;
 	void setScene(std::unique_ptr<Scene> newScene) { m_currentScene = std::move(newScene); }
 	bool renderImGuiBackButton();
 public:
@@ -18,6 +21,11 @@ public:
 	virtual void onRenderImGui() {}
 	virtual void updateWidthHeight(unsigned int width, unsigned int height) {}
 	virtual ~Scene() {}
+	PassProfiler& getProfiler() { return m_profiler; }
 	static void helpPoput(const char* text);
+	/// <summary>
+	/// Seconds since the first call (steady clock, also without GLFW in headless EGL runs)
+	/// </summary>
+	static double getTime();
 };
 
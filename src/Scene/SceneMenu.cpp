@@ -1,18 +1,20 @@
 #include "SceneMenu.h"
+#include "ShaderCache.h"
+#include <chrono>
 
 void SceneMenu::onRenderImGui()
 {
 	ImGui::Text("Select a scene from below:");
 	if (ImGui::Button("Box room scene", ImVec2(ImGui::GetWindowSize().x * 0.5f, 30.0f))) {
-		setScene(std::make_unique<Box>(m_currentScene, m_width, m_height));
+		setScene(createScene("box", m_currentScene, m_width, m_height));
 	}
 	ImGui::Spacing();
 	if (ImGui::Button("Texture test scene", ImVec2(ImGui::GetWindowSize().x * 0.5f, 30.0f))) {
-		setScene(std::make_unique<TextureScene>(m_currentScene, m_width, m_height));
+		setScene(createScene("texture", m_currentScene, m_width, m_height));
 	}
 	ImGui::Spacing();
 	if (ImGui::Button("Model test scene", ImVec2(ImGui::GetWindowSize().x * 0.5f, 30.0f))) {
-		setScene(std::make_unique<ModelTestScene>(m_currentScene, m_width, m_height));
+		setScene(createScene("model", m_currentScene, m_width, m_height));
 	}
 }
 
@@ -21,3 +23,29 @@ void SceneMenu::onRender()
 	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 	glClear(GL_COLOR_BUFFER_BIT);
 }
+
+std::unique_ptr<Scene> SceneMenu::createScene(const std::string& name, std::unique_ptr<Scene>& scene, unsigned int width, unsigned int height)
+{
+	auto start = std::chrono::steady_clock::now();
+	ShaderCache::get().resetStats();
+
+	std::unique_ptr<Scene> newScene;
+	if (name == "box") {
+		newScene = std::make_unique<Box>(scene, width, height);
+	}
+	else if (name == "texture") {
+		newScene = std::make_unique<TextureScene>(scene, width, height);
+	}
+	else if (name == "model") {
+		newScene = std::make_unique<ModelTestScene>(scene, width, height);
+	}
+	else {
+		return nullptr;
+	}
+
+	// report scene entry time, it depends on how many programs were loaded from the cache
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	printf("Scene '%s' loaded in %.1f ms (shader cache: %u hits, %u misses)\n",
+		name.c_str(), ms, ShaderCache::get().getHits(), ShaderCache::get().getMisses());
+	return newScene;
+}
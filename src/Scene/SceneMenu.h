@@ -10,5 +10,11 @@ public:
 	SceneMenu(std::unique_ptr<Scene>& scene, unsigned int width, unsigned int height) : Scene(scene, width, height) {}
 	void onRenderImGui() override;
 	void onRender() override;
+
+	/// <summary>
+	/// Create a scene by name: "box", "texture" or "model". Returns nullptr if the name is unknown.
+	/// </summary>
+	/// <param name="scene">: reference to the current scene (used by the scene to switch back to the menu)</param>
+	static std::unique_ptr<Scene> createScene(const std::string& name, std::unique_ptr<Scene>& scene, unsigned int width, unsigned int height);
 };
 
@@ -16,23 +16,27 @@ TextureScene::TextureScene(std::unique_ptr<Scene>& scene, unsigned int width, un
     m_lights.push_back(std::move(std::make_unique<PointLight>(0, glm::vec3(-5.0f, 1.5f, -0.5f))));
     m_lights.push_back(std::move(std::make_unique<PointLight>(1, glm::vec3(0.0f, 1.5f, -0.5f))));
 
-    // load shaders
-    m_shaders.resize(3);
+    // load shaders (all programs are submitted together on the first bind and compile in parallel)
+    m_fallbackShader.load("base_shader.vert", "fallback.frag");
     m_shaders[0].load("base_shader.vert", "phong.frag");
     m_shaders[1].load("base_shader.vert", "blinn.frag");
     m_shaders[2].load("base_shader.vert", "cook-torrance.frag");
     m_postprocessShader.load("postprocess.vert", "postprocess.frag");
-    m_textureDisplayShader.load("postprocess.vert", "texture_display.frag");
+    m_bloomShader.load("postprocess.vert", "bloom.frag");
+    m_luminanceShader.load("postprocess.vert", "luminance.frag");
+    PostprocessPipeline::bindShader(m_postprocessShader);
+    m_fallbackShader.setUniformBlockBinding("Lights", LightUniformBuffer::BINDING);
+    for (auto& shader : m_shaders) {
+        shader.setFallback(&m_fallbackShader);
+    }
     
     m_postProcessUI.addShaders({ &m_shaders[0], &m_shaders[1], &m_shaders[2], &m_postprocessShader });
     m_postProcessUI.setUniforms();
 
     for (auto& shader : m_shaders) {
         shader.bind();
-        shader.setInt("u_numLights", m_lights.size());
-        for (auto& light : m_lights) {
-            light->setUniforms(shader);
-        }
+        // light data is read from the uniform buffer
+        LightUniformBuffer::bindShader(shader);
     }
 
     // load textures
@@ -118,8 +122,10 @@ TextureScene::~TextureScene()
 
 void TextureScene::onRender()
 {
-    static double time = glfwGetTime();
+    m_profiler.beginFrame();
+    static double time = getTime();
     
+    PassProfiler::Scope lightingPassTimer = m_profiler.scope("Lighting pass");
     m_hdrFBO.bind();
     glEnable(GL_DEPTH_TEST);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -128,8 +134,8 @@ void TextureScene::onRender()
     glViewport(0, 0, m_width, m_height);
 
     // update camera position and uniforms
-    m_camera.update(glfwGetTime() - time);
-    time = glfwGetTime();
+    m_camera.update(getTime() - time);
+    time = getTime();
     for (auto& shader : m_shaders) {
         shader.setMat4("u_viewMatrix", m_camera.getMatrix());
         shader.setVec3("u_viewPos", m_camera.getPosition());
@@ -140,18 +146,22 @@ void TextureScene::onRender()
         glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
     }
 
-    // lights
+    // lights (upload only the lights that changed, the buffer is shared by all shaders)
+    m_lightBuffer.update(m_lights);
+    // the light meshes are only emissive
+    m_shaders[0].setInt("u_numLights", 0);
     for (auto& light : m_lights) {
         light->draw(m_shaders[0]);
-        for (auto& shader : m_shaders) {
-            light->setUniforms(shader);
-        }
     }
 
     // draw mesh
     for (auto& mesh : m_materialMeshes) {
         Shader& shader = m_shaders[mesh.modelIndex];
         mesh.materials[mesh.modelIndex]->setUniforms(shader);
+        // lights reaching the bounding box of the mesh
+        glm::vec3 min, max;
+        mesh.mesh->getBounds(mesh.modelMatrix, min, max);
+        m_lightBuffer.setObjectLights(shader, min, max);
         shader.setMat4("u_modelMatrix", mesh.modelMatrix);
         if (mesh.currentMesh == 1) {
             // if sphere scale X axis by PI
@@ -169,18 +179,25 @@ void TextureScene::onRender()
     if (m_wireframeEnabled) {
         glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
     }
+    lightingPassTimer.end();
 
-    // apply postprocessing and write to another FBO
-    m_outputFBO.bind();
-    glDisable(GL_DEPTH_TEST);
-    glClear(GL_COLOR_BUFFER_BIT);
-    m_screenQuadRenderer.render(m_hdrFBO.getColorAttachment(0), m_postprocessShader);
+    // bloom of the bright parts of the HDR color
+    PassProfiler::Scope bloomTimer = m_profiler.scope("Bloom");
+    m_postprocess.renderBloom(m_bloomShader, m_screenQuadRenderer, m_hdrFBO.getColorAttachment(0), m_postProcessUI);
+    bloomTimer.end();
 
-    // bind default framebuffer
-    m_outputFBO.unbind(); 
-    glDisable(GL_DEPTH_TEST);
-    glClear(GL_COLOR_BUFFER_BIT);
-    m_screenQuadRenderer.render(m_outputFBO.getColorAttachment(0), m_textureDisplayShader);
+    // average luminance for the exposure (read back in a later frame)
+    PassProfiler::Scope exposureTimer = m_profiler.scope("Auto exposure");
+    m_postprocess.measureExposure(m_luminanceShader, m_screenQuadRenderer, m_hdrFBO.getColorAttachment(0), m_postProcessUI);
+    exposureTimer.end();
+
+    // apply postprocessing in one pass to the screen
+    PassProfiler::Scope postprocessTimer = m_profiler.scope("Postprocess");
+    m_postprocess.beginFinalPass();
+    m_postprocess.setUniforms(m_postprocessShader);
+    m_screenQuadRenderer.render(m_hdrFBO.getColorAttachment(0), m_postprocessShader);
+    m_postprocess.endFinalPass();
+    postprocessTimer.end();
 }
 
 void TextureScene::onRenderImGui()
@@ -218,6 +235,7 @@ void TextureScene::onRenderImGui()
         ImGui::PopID();
         ImGui::NewLine();
     }
+    m_lightBuffer.imGuiRender();
  
     ImGui::NewLine();
 
@@ -262,14 +280,16 @@ void TextureScene::onRenderImGui()
     }
 
     if (ImGui::Button("Screenshot")) {
-        m_outputFBO.saveColorAttachmentToPNG(0);
+        m_postprocess.requestCapture();
     }
 
     m_postProcessUI.onRenderImGui();
+    ImGui::Text("Exposure: %.3f", m_postprocess.getExposure());
 
     // enable/disable wireframes, for debug
     ImGui::Checkbox("Show wireframe", &m_wireframeEnabled);
 
+    m_profiler.onRenderImGui();
     ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
 }
 
@@ -281,9 +301,6 @@ void TextureScene::updateWidthHeight(unsigned int width, unsigned int height)
     m_hdrFBO.addColorAttachament(GL_TEXTURE_2D, GL_RGB16F);
     m_hdrFBO.addDepthAttachment(GL_TEXTURE_2D);
     m_hdrFBO.create();
-    // setup output FBO (after postprocessing)
-    m_outputFBO = Framebuffer(width, height);
-    m_outputFBO.addColorAttachament(GL_TEXTURE_2D, GL_RGB);
-    m_outputFBO.create();
+    m_postprocess.resize(width, height);
     m_projMatrix = glm::infinitePerspective(glm::radians(60.0f), 1.0f * m_width / m_height, 0.1f);
 }
@@ -6,7 +6,6 @@
 #include "VAO.h"
 #include "Buffer/EBO.h"
 #include "glm/gtc/matrix_transform.hpp"
-#include "GLFW/glfw3.h" // for deltaTime(glfwGetTime) in rendering
 #include "Camera.h"
 #include "Event/EventManager.h" // for registering camera
 #include "Mesh.h"
@@ -16,7 +15,9 @@
 #include "Light/DirectionalLight.h"
 #include "Light/PointLight.h"
 #include "Light/SpotLight.h"
+#include "Light/LightUniformBuffer.h"
 #include "Postprocess/ScreenQuadRenderer.h"
+#include "Postprocess/PostprocessPipeline.h"
 #include "Framebuffer.h"
 #include "Postprocess/PostprocessUI.h"
 
@@ -39,8 +40,8 @@ private:
 
 	// framebuffer to use lighting with hdr
 	Framebuffer m_hdrFBO;
-	// framebuffer used to output after postprocessing
-	Framebuffer m_outputFBO;
+	// final postprocess pass to the screen (and screenshots)
+	PostprocessPipeline m_postprocess;
 
 	// helper to render texture to screen
 	ScreenQuadRenderer m_screenQuadRenderer;
@@ -50,11 +51,18 @@ private:
 
 	// all lights in the scene
 	std::vector<std::unique_ptr<Light> > m_lights;
+	// uniform buffer with the data of all lights
+	LightUniformBuffer m_lightBuffer;
 
 	Camera m_camera;
-	std::vector<Shader> m_shaders;
+	Shader m_shaders[3];
+	// drawn while the lighting shaders are compiling
+	Shader m_fallbackShader;
 	Shader m_postprocessShader;
-	Shader m_textureDisplayShader;
+	// downsamples/upsamples the bloom chain
+	Shader m_bloomShader;
+	// log luminance for the auto exposure
+	Shader m_luminanceShader;
 
 	glm::mat4 m_viewMatrix = glm::mat4(1.0f);
 	glm::mat4 m_projMatrix = glm::mat4(1.0f);
@@ -1,6 +1,14 @@
 #include "Shader.h"
+#include "ShaderCache.h"
+#include <algorithm>
+#include <climits>
 
 unsigned int Shader::s_currentBoundShader = 0;
+std::unordered_map<std::string, std::shared_future<Shader::Source>> Shader::s_sources;
+std::mutex Shader::s_sourcesMutex;
+std::vector<Shader*> Shader::s_pending;
+bool Shader::s_parallelCompile = false;
+const Shader* Shader::s_fallbackOwner = nullptr;
 
 Shader::Shader(
 	const std::string& vertexPath, 
@@ -12,49 +20,272 @@ Shader::Shader(
 
 Shader::~Shader()
 {
-	glDeleteProgram(m_id);
+	if (m_pending) {
+		s_pending.erase(std::find(s_pending.begin(), s_pending.end(), this));
+	}
+	if (s_fallbackOwner == this) {
+		s_fallbackOwner = nullptr;
+	}
+	for (auto& variant : m_variants) {
+		glDeleteShader(variant.second.vertexShaderId);
+		glDeleteShader(variant.second.fragmentShaderId);
+		glDeleteShader(variant.second.geometryShaderId);
+		glDeleteProgram(variant.second.id);
+	}
 	s_currentBoundShader = 0;
 }
 
 void Shader::load(const std::string& vertexPath, const std::string& fragmentPath, const std::string& geometryPath)
+{
+	// delete the programs if the shader is loaded again
+	for (auto& variant : m_variants) {
+		glDeleteShader(variant.second.vertexShaderId);
+		glDeleteShader(variant.second.fragmentShaderId);
+		glDeleteShader(variant.second.geometryShaderId);
+		glDeleteProgram(variant.second.id);
+	}
+	m_variants.clear();
+	m_variant = nullptr;
+	m_id = 0;
+	m_uniformValues.clear();
+
+	m_name = vertexPath + ", " + fragmentPath + (geometryPath.empty() ? "" : ", " + geometryPath);
+	m_vertexPath = vertexPath;
+	m_fragmentPath = fragmentPath;
+	m_geometryPath = geometryPath;
+
+	// expand the templates on worker threads, the program is submitted with the other pending shaders
+	requestSource(vertexPath);
+	requestSource(fragmentPath);
+	if (!geometryPath.empty()) {
+		requestSource(geometryPath);
+	}
+	if (!m_pending) {
+		s_pending.push_back(this);
+		m_pending = true;
+	}
+}
+
+void Shader::submitPending()
+{
+	if (s_pending.empty()) return;
+
+	// let the driver compile on its own threads, the status is checked later with GL_COMPLETION_STATUS_KHR
+	static bool initialized = false;
+	if (!initialized) {
+		initialized = true;
+		s_parallelCompile = GLEW_KHR_parallel_shader_compile;
+		if (s_parallelCompile) {
+			glMaxShaderCompilerThreadsKHR(0xFFFFFFFF); // as many threads as the driver wants
+		}
+	}
+
+	// submit everything first, nothing is queried here
+	std::vector<Shader*> pending;
+	pending.swap(s_pending);
+	for (Shader* shader : pending) {
+		shader->m_pending = false;
+		// missing files were replaced by nothing, the compile errors follow
+		for (const std::string* path : { &shader->m_vertexPath, &shader->m_fragmentPath, &shader->m_geometryPath }) {
+			if (path->empty()) continue;
+			const std::string& error = getSource(*path).error;
+			if (!error.empty()) {
+				printf("ERROR %s (%s)\n", error.c_str(), shader->m_name.c_str());
+			}
+		}
+		shader->submit();
+	}
+}
+
+void Shader::submit()
+{
+	// keywords of all stages, the bit of a keyword is its index
+	m_keywords.clear();
+	m_keywordHashes.clear();
+	for (const std::string* path : { &m_vertexPath, &m_fragmentPath, &m_geometryPath }) {
+		if (path->empty()) continue;
+		for (const std::string& keyword : getSource(*path).keywords) {
+			if (std::find(m_keywords.begin(), m_keywords.end(), keyword) != m_keywords.end()) continue;
+			if (m_keywords.size() == MAX_KEYWORDS) {
+				printf("ERROR too many keywords, '%s' is ignored (%s)\n", keyword.c_str(), m_name.c_str());
+				continue;
+			}
+			m_keywords.push_back(keyword);
+			m_keywordHashes.push_back(Uniform(keyword).hash);
+		}
+	}
+
+	// compile the variant without keywords now, the others when they are used
+	uint32_t requestedKey = m_requestedKey;
+	m_requestedKey = 0;
+	selectVariant();
+	m_requestedKey = requestedKey;
+}
+
+void Shader::createVariant(uint32_t key, Variant& variant)
 {
 	// create a new program
-	m_id = glCreateProgram();
+	variant.id = glCreateProgram();
+	std::string vertexSource = addDefines(getSource(m_vertexPath).code, key);
+	std::string fragmentSource = addDefines(getSource(m_fragmentPath).code, key);
+	std::string geometrySource = m_geometryPath.empty() ? "" : addDefines(getSource(m_geometryPath).code, key);
 
-	unsigned int vertexShaderId = load(vertexPath, GL_VERTEX_SHADER);
-	unsigned int fragmentShaderId = load(fragmentPath, GL_FRAGMENT_SHADER);
-	// TODO: check for geometry shader 
-	glAttachShader(m_id, vertexShaderId);
-	glAttachShader(m_id, fragmentShaderId);
+	// load the program binary if the same sources were already compiled with this driver
+	// (the defines are part of the sources => every variant has its own key)
+	ShaderCache& cache = ShaderCache::get();
+	std::string sources = vertexSource + '\0' + fragmentSource;
+	if (!geometrySource.empty()) {
+		sources += '\0' + geometrySource;
+	}
+	variant.cacheKey = cache.getKey(sources);
+	if (cache.loadProgram(variant.id, variant.cacheKey)) {
+		return;
+	}
 
-	// link and check for linking errors
-	glLinkProgram(m_id);
-	int ok;
-	char log[1024];
-	glGetProgramiv(m_id, GL_LINK_STATUS, &ok);
-	if (!ok)
-	{
-		glGetProgramInfoLog(m_id, 1024, NULL, log);
-		printf("ERROR Shader linking failed\n%s\n", log);
+	variant.vertexShaderId = compile(vertexSource, GL_VERTEX_SHADER);
+	variant.fragmentShaderId = compile(fragmentSource, GL_FRAGMENT_SHADER);
+	glAttachShader(variant.id, variant.vertexShaderId);
+	glAttachShader(variant.id, variant.fragmentShaderId);
+	// the geometry stage is optional
+	if (!geometrySource.empty()) {
+		variant.geometryShaderId = compile(geometrySource, GL_GEOMETRY_SHADER);
+		glAttachShader(variant.id, variant.geometryShaderId);
+	}
+
+	// link, errors are checked in finishVariant
+	cache.prepareProgram(variant.id);
+	glLinkProgram(variant.id);
+}
+
+bool Shader::finishVariant(Variant& variant, bool wait)
+{
+	if (variant.ready) return true;
+
+	// any other query would block until the program is linked
+	if (!wait && s_parallelCompile) {
+		int completed = 0;
+		glGetProgramiv(variant.id, GL_COMPLETION_STATUS_KHR, &completed);
+		if (!completed) return false;
+	}
+	variant.ready = true;
+
+	// check for linking errors (programs from the cache have no shaders)
+	if (variant.vertexShaderId != 0) {
+		int ok;
+		char log[1024];
+		glGetProgramiv(variant.id, GL_LINK_STATUS, &ok);
+		if (!ok)
+		{
+			checkCompileStatus(variant.vertexShaderId, GL_VERTEX_SHADER);
+			checkCompileStatus(variant.fragmentShaderId, GL_FRAGMENT_SHADER);
+			if (variant.geometryShaderId != 0) {
+				checkCompileStatus(variant.geometryShaderId, GL_GEOMETRY_SHADER);
+			}
+			glGetProgramInfoLog(variant.id, 1024, NULL, log);
+			printf("ERROR Shader linking failed (%s)\n%s\n", m_name.c_str(), log);
+		}
+		else {
+			ShaderCache::get().storeProgram(variant.id, variant.cacheKey);
+		}
+
+		// delete shaders after linking 
+		glDeleteShader(variant.vertexShaderId);
+		glDeleteShader(variant.fragmentShaderId);
+		glDeleteShader(variant.geometryShaderId);
+		variant.vertexShaderId = variant.fragmentShaderId = variant.geometryShaderId = 0;
+	}
+	reflectUniforms(variant);
+	for (const auto& binding : m_blockBindings) {
+		unsigned int index = glGetUniformBlockIndex(variant.id, binding.first.c_str());
+		if (index != GL_INVALID_INDEX) {
+			glUniformBlockBinding(variant.id, index, binding.second);
+		}
 	}
 
-	// delete shaders after linking 
-	glDeleteShader(vertexShaderId);
-	glDeleteShader(fragmentShaderId);
+	// set the uniforms that were set while it was compiling
+	glUseProgram(variant.id);
+	s_currentBoundShader = variant.id;
+	uploadUniforms(variant, variant.uniformVersion);
+	variant.uniformVersion = m_uniformVersion;
+	if (s_fallbackOwner == this) {
+		s_fallbackOwner = nullptr;
+	}
+	// only variants need the values later
+	if (m_keywords.empty()) {
+		m_uniformValues.clear();
+	}
+	return true;
 }
 
-unsigned int Shader::load(const std::string& path, unsigned int type)
+void Shader::selectVariant()
 {
-	std::string contents = readFile(path);
-	contents = processInclude(processExtends(contents));
-	const char* shaderCode = contents.c_str(); // get the whole shader as string
+	auto it = m_variants.find(m_requestedKey);
+	if (it == m_variants.end()) {
+		it = m_variants.emplace(m_requestedKey, Variant()).first;
+		it->second.key = m_requestedKey;
+		createVariant(m_requestedKey, it->second);
+	}
+	m_variant = &it->second;
+	m_id = m_variant->id;
+	if (!m_variant->ready || m_uniformVersion == m_variant->uniformVersion) return;
+
+	// set the uniforms that changed since this variant was last active
+	glUseProgram(m_id);
+	s_currentBoundShader = m_id;
+	uploadUniforms(*m_variant, m_variant->uniformVersion);
+	m_variant->uniformVersion = m_uniformVersion;
+}
+
+void Shader::uploadUniforms(const Variant& variant, uint32_t version) const
+{
+	for (const auto& value : m_uniformValues) {
+		if (value.second.version <= version) continue;
+		// uniforms used only by other variants are skipped silently
+		int location = findLocation(variant, value.first);
+		if (location != -1) {
+			uploadUniform(value.second, location);
+		}
+	}
+}
+
+int Shader::findLocation(const Variant& variant, uint32_t hash)
+{
+	auto it = std::lower_bound(variant.uniformLocations.begin(), variant.uniformLocations.end(), std::make_pair(hash, INT_MIN));
+	if (it != variant.uniformLocations.end() && it->first == hash) {
+		return it->second;
+	}
+	return -1;
+}
+
+std::string Shader::addDefines(const std::string& source, uint32_t key) const
+{
+	if (key == 0) return source;
+	std::string defines;
+	for (size_t i = 0; i < m_keywords.size(); ++i) {
+		if (key & (1u << i)) {
+			defines += "#define " + m_keywords[i] + "\n";
+		}
+	}
+	// #version must stay the first line
+	size_t version = source.find("#version");
+	size_t lineEnd = version == std::string::npos ? std::string::npos : source.find('\n', version);
+	if (lineEnd == std::string::npos) return defines + source;
+	return source.substr(0, lineEnd + 1) + defines + source.substr(lineEnd + 1);
+}
+
+unsigned int Shader::compile(const std::string& source, unsigned int type)
+{
+	const char* shaderCode = source.c_str(); // get the whole shader as string
 	unsigned int id = glCreateShader(type);
 
-	// compile 
+	// compile (the status is checked after linking, querying it here would wait for the compiler)
 	glShaderSource(id, 1, &shaderCode, NULL);
 	glCompileShader(id);
-	
-	// check errors
+	return id;
+}
+
+void Shader::checkCompileStatus(unsigned int id, unsigned int type) const
+{
 	int ok;
 	char log[1024];
 	glGetShaderiv(id, GL_COMPILE_STATUS, &ok);
@@ -75,21 +306,171 @@ unsigned int Shader::load(const std::string& path, unsigned int type)
 			break;
 		}
 
-		printf("ERROR %s shader compilation failed\n%s\n", shaderType, log);
+		printf("ERROR %s shader compilation failed (%s)\n%s\n", shaderType, m_name.c_str(), log);
 	}
-	return id;
 }
 
-unsigned int Shader::getLocation(const std::string& name)
+void Shader::reflectUniforms(Variant& variant)
+{
+	variant.uniformLocations.clear();
+	variant.missingUniforms.clear();
+
+	int count = 0, maxLength = 0;
+	glGetProgramiv(variant.id, GL_ACTIVE_UNIFORMS, &count);
+	glGetProgramiv(variant.id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+	std::vector<char> buffer(maxLength + 1);
+	// name of every stored uniform, used to detect hash collisions
+	std::unordered_map<uint32_t, std::string> names;
+
+	auto add = [&](const std::string& name, int location) {
+		uint32_t hash = Uniform(name).hash;
+		auto it = names.find(hash);
+		if (it != names.end() && it->second != name) {
+			printf("ERROR uniforms '%s' and '%s' have the same hash (%s)\n", it->second.c_str(), name.c_str(), m_name.c_str());
+			return;
+		}
+		names[hash] = name;
+		variant.uniformLocations.push_back({ hash, location });
+	};
+
+	for (int i = 0; i < count; ++i) {
+		int size = 0, length = 0;
+		unsigned int type = 0;
+		glGetActiveUniform(variant.id, i, maxLength + 1, &length, &size, &type, buffer.data());
+		std::string name(buffer.data(), length);
+		int location = glGetUniformLocation(variant.id, name.c_str());
+		// uniforms in uniform blocks have no location
+		if (location == -1) continue;
+
+		// arrays are reported as "name[0]"
+		size_t bracket = name.rfind("[0]");
+		if (bracket == std::string::npos || bracket + 3 != name.size()) {
+			add(name, location);
+			continue;
+		}
+		std::string base = name.substr(0, bracket);
+		add(base, location);
+		for (int element = 0; element < size; ++element) {
+			std::string elementName = base + "[" + std::to_string(element) + "]";
+			add(elementName, glGetUniformLocation(variant.id, elementName.c_str()));
+		}
+	}
+	// sort for binary search
+	std::sort(variant.uniformLocations.begin(), variant.uniformLocations.end());
+}
+
+int Shader::getLocation(Uniform uniform)
 {
-	if (m_uniformLocations.find(name) == m_uniformLocations.end()) {
-		m_uniformLocations[name] = glGetUniformLocation(m_id, name.c_str());
+	if (m_variant == nullptr) {
+		if (uniform.name != nullptr) {
+			printf("Warning: uniform '%s' set before the shader was loaded\n", uniform.name);
+		}
+		return -1;
+	}
+	if (!m_variant->ready) {
+		// still compiling: the value is recorded, set it on the fallback if that is drawn instead
+		return s_fallbackOwner == this ? findLocation(*m_fallback->m_variant, uniform.hash) : -1;
+	}
+	int location = findLocation(*m_variant, uniform.hash);
+	if (location != -1) {
+		return location;
+	}
+	// not active (unused or optimized out), report only once
+	// (for shaders with keywords the uniform may be used only by other variants)
+	if (m_keywords.empty() && m_variant->missingUniforms.insert(uniform.hash).second) {
+		if (uniform.name != nullptr) {
+			printf("Warning: uniform '%s' is not active (%s)\n", uniform.name, m_name.c_str());
+		}
+		else {
+			printf("Warning: uniform with hash %08x is not active (%s)\n", uniform.hash, m_name.c_str());
+		}
 	}
-	return m_uniformLocations[name];
+	return -1;
 }
 
-void Shader::bind() const
+void Shader::recordUniform(uint32_t hash, UniformValue::Type type, unsigned int count, const float* floats, const int* ints)
 {
+	// shaders without keywords have only one program, nothing to replay once it is linked
+	if (m_variant == nullptr || (m_keywords.empty() && m_variant->ready)) return;
+
+	UniformValue& value = m_uniformValues[hash];
+	value.type = type;
+	value.count = count;
+	// assign reuses the storage => no allocation after the first time
+	if (floats != nullptr) {
+		unsigned int components = 1;
+		switch (type)
+		{
+		case UniformValue::Type::VEC2: components = 2; break;
+		case UniformValue::Type::VEC3: components = 3; break;
+		case UniformValue::Type::VEC4: components = 4; break;
+		case UniformValue::Type::MAT3: components = 9; break;
+		case UniformValue::Type::MAT4: components = 16; break;
+		default: break;
+		}
+		value.floats.assign(floats, floats + count * components);
+	}
+	else {
+		value.ints.assign(ints, ints + count);
+	}
+	value.version = ++m_uniformVersion;
+	// the active program already has the value (if it is linked)
+	if (m_variant->ready) {
+		m_variant->uniformVersion = m_uniformVersion;
+	}
+}
+
+void Shader::uploadUniform(const UniformValue& value, int location)
+{
+	switch (value.type)
+	{
+	case UniformValue::Type::FLOAT:
+		glUniform1fv(location, value.count, value.floats.data());
+		break;
+	case UniformValue::Type::INT:
+		glUniform1iv(location, value.count, value.ints.data());
+		break;
+	case UniformValue::Type::VEC2:
+		glUniform2fv(location, value.count, value.floats.data());
+		break;
+	case UniformValue::Type::VEC3:
+		glUniform3fv(location, value.count, value.floats.data());
+		break;
+	case UniformValue::Type::VEC4:
+		glUniform4fv(location, value.count, value.floats.data());
+		break;
+	case UniformValue::Type::MAT3:
+		glUniformMatrix3fv(location, value.count, GL_FALSE, value.floats.data());
+		break;
+	case UniformValue::Type::MAT4:
+		glUniformMatrix4fv(location, value.count, GL_FALSE, value.floats.data());
+		break;
+	}
+}
+
+void Shader::bind()
+{
+	// programs are submitted together the first time one of them is used
+	if (m_pending) {
+		submitPending();
+	}
+	// switch variant if keywords changed (not loaded => bind 0 like before)
+	if (m_variant != nullptr && m_variant->key != m_requestedKey) {
+		selectVariant();
+	}
+	if (m_variant != nullptr && !finishVariant(*m_variant, m_fallback == nullptr)) {
+		// still compiling => draw with the fallback, using the uniforms of this shader
+		m_fallback->bind();
+		if (m_fallback->m_variant != nullptr) {
+			if (s_fallbackOwner != this) {
+				uploadUniforms(*m_fallback->m_variant, 0);
+				s_fallbackOwner = this;
+			}
+			return;
+		}
+		// fallback not loaded => wait for this program
+		finishVariant(*m_variant, true);
+	}
 	if (m_id != s_currentBoundShader) {
 		glUseProgram(m_id);
 		s_currentBoundShader = m_id;
@@ -104,51 +485,105 @@ void Shader::unbind() const
 	}
 }
 
-void Shader::setFloat(const std::string& name, float val)
+bool Shader::isReady()
+{
+	if (m_pending) {
+		submitPending();
+	}
+	return m_variant != nullptr && finishVariant(*m_variant, false);
+}
+
+void Shader::setKeyword(Keyword keyword, bool enabled)
+{
+	// the keywords are known after the sources are expanded
+	if (m_pending) {
+		submitPending();
+	}
+	for (size_t i = 0; i < m_keywordHashes.size(); ++i) {
+		if (m_keywordHashes[i] != keyword.hash) continue;
+		if (enabled) m_requestedKey |= 1u << i;
+		else m_requestedKey &= ~(1u << i);
+		return;
+	}
+}
+
+void Shader::setFloat(Uniform name, float val)
 {
 	bind();
 	glUniform1f(getLocation(name), val);
+	recordUniform(name.hash, UniformValue::Type::FLOAT, 1, &val, nullptr);
 }
 
-void Shader::setInt(const std::string& name, int val)
+void Shader::setInt(Uniform name, int val)
 {
 	bind();
 	glUniform1i(getLocation(name), val);
+	recordUniform(name.hash, UniformValue::Type::INT, 1, nullptr, &val);
 }
 
-void Shader::setBool(const std::string& name, bool val)
+void Shader::setBool(Uniform name, bool val)
 {
-	bind();
 	setInt(name, val ? 1 : 0);
 }
 
-void Shader::setVec4(const std::string& name, const glm::vec4& val)
+void Shader::setVec4(Uniform name, const glm::vec4& val)
 {
 	bind();
 	glUniform4fv(getLocation(name), 1, &val[0]);
+	recordUniform(name.hash, UniformValue::Type::VEC4, 1, &val[0], nullptr);
 }
 
-void Shader::setVec3(const std::string& name, const glm::vec3& val)
+void Shader::setVec3(Uniform name, const glm::vec3& val)
 {
 	bind();
 	glUniform3fv(getLocation(name), 1, &val[0]);
+	recordUniform(name.hash, UniformValue::Type::VEC3, 1, &val[0], nullptr);
+}
+
+void Shader::setVec2(Uniform name, const glm::vec2& val)
+{
+	bind();
+	glUniform2fv(getLocation(name), 1, &val[0]);
+	recordUniform(name.hash, UniformValue::Type::VEC2, 1, &val[0], nullptr);
 }
 
-void Shader::setMat4(const std::string& name, const glm::mat4& val)
+void Shader::setMat4(Uniform name, const glm::mat4& val)
 {
 	bind();
 	glUniformMatrix4fv(getLocation(name), 1, GL_FALSE, &val[0][0]);
+	recordUniform(name.hash, UniformValue::Type::MAT4, 1, &val[0][0], nullptr);
 }
 
-void Shader::setMat3(const std::string& name, const glm::mat3& val)
+void Shader::setMat3(Uniform name, const glm::mat3& val)
 {
 	bind();
 	glUniformMatrix3fv(getLocation(name), 1, GL_FALSE, &val[0][0]);
+	recordUniform(name.hash, UniformValue::Type::MAT3, 1, &val[0][0], nullptr);
 }
 
-void Shader::setIntArray(const std::string& name, unsigned int count, int* data) {
+void Shader::setIntArray(Uniform name, unsigned int count, int* data) {
 	bind();
 	glUniform1iv(getLocation(name), count, data);
+	recordUniform(name.hash, UniformValue::Type::INT, count, nullptr, data);
+}
+
+void Shader::setVec4Array(Uniform name, unsigned int count, const glm::vec4* data) {
+	bind();
+	glUniform4fv(getLocation(name), count, &data[0][0]);
+	recordUniform(name.hash, UniformValue::Type::VEC4, count, &data[0][0], nullptr);
+}
+
+void Shader::setUniformBlockBinding(const std::string& name, unsigned int binding)
+{
+	// remembered for the variants that are still compiling or compiled later
+	m_blockBindings.push_back({ name, binding });
+	for (auto& variant : m_variants) {
+		if (!variant.second.ready) continue;
+		unsigned int index = glGetUniformBlockIndex(variant.second.id, name.c_str());
+		if (index != GL_INVALID_INDEX) {
+			glUniformBlockBinding(variant.second.id, index, binding);
+		}
+	}
 }
 
 Shader::TemplateInfo Shader::extractName(const std::string& str, size_t offset) {
@@ -159,20 +594,43 @@ Shader::TemplateInfo Shader::extractName(const std::string& str, size_t offset)
 	return { begin + 1, end - 1 }; // go back one
 }
 
-std::string Shader::readFile(const std::string& path) {
+std::shared_future<Shader::Source> Shader::requestSource(const std::string& path) {
+	std::lock_guard<std::mutex> lock(s_sourcesMutex);
+	auto it = s_sources.find(path);
+	if (it == s_sources.end()) {
+		// std::launch::async starts a thread per file, the expansion only reads files and does not touch GL
+		it = s_sources.emplace(path, std::async(std::launch::async, &Shader::expandSource, path).share()).first;
+	}
+	return it->second;
+}
+
+const Shader::Source& Shader::getSource(const std::string& path) {
+	// the shared state is kept alive by s_sources => the reference stays valid
+	return requestSource(path).get();
+}
+
+Shader::Source Shader::expandSource(const std::string& path) {
+	Source source;
+	source.code = processInclude(processExtends(readFile(path, source.error), source.error), source.error);
+	source.keywords = processKeywords(source.code);
+	return source;
+}
+
+std::string Shader::readFile(const std::string& path, std::string& error) {
 	std::stringstream p;
 	p << "shaders/" << path;
 	std::ifstream file(p.str());
 	if (!file) {
-		printf("Error file '%s' not loaded", p.str().c_str());
-		exit(0); 
+		// runs on a worker thread => the error is reported later by submitPending
+		error += (error.empty() ? "file '" : ", file '") + p.str() + "' not loaded";
+		return "";
 	}
 	std::stringstream buffer;
 	buffer << file.rdbuf(); // read whole file in buffer
 	return buffer.str();
 }
 
-std::string Shader::processExtends(std::string shader) {
+std::string Shader::processExtends(std::string shader, std::string& error) {
 	size_t begin = shader.find("@extends");
 	if (begin == std::string::npos) return shader;
 
@@ -180,7 +638,7 @@ std::string Shader::processExtends(std::string shader) {
 	TemplateInfo file_pos = extractName(shader, 0);
 	std::string file = shader.substr(file_pos.start, file_pos.end - file_pos.start + 1);
 	// load base template shader
-	std::string base_shader = readFile(file);
+	std::string base_shader = readFile(file, error);
 
 	std::unordered_map<std::string, std::string> sections;
 	// extract all sections
@@ -211,7 +669,7 @@ std::string Shader::processExtends(std::string shader) {
 	return base_shader;
 }
 
-std::string Shader::processInclude(std::string shader) {
+std::string Shader::processInclude(std::string shader, std::string& error) {
 	size_t pos = shader.find("@include");       // find the index where @include starts
 	while (pos != std::string::npos) {            // while there are includes
 		TemplateInfo file_pos = extractName(shader, pos);
@@ -219,9 +677,22 @@ std::string Shader::processInclude(std::string shader) {
 		// extract the <file> from @include "<file>"
 		std::string file = shader.substr(file_pos.start, file_pos.end - file_pos.start + 1);
 		// replace <@include "file"> with content
-		shader.replace(pos, file_pos.end - pos + 2, readFile(file));
+		shader.replace(pos, file_pos.end - pos + 2, readFile(file, error));
 
 		pos = shader.find("@include"); // search for another @include
 	}
 	return shader;
+}
+
+std::vector<std::string> Shader::processKeywords(std::string& shader) {
+	std::vector<std::string> keywords;
+	size_t pos = shader.find("@keyword");
+	while (pos != std::string::npos) {
+		TemplateInfo name_pos = extractName(shader, pos);
+		keywords.push_back(shader.substr(name_pos.start, name_pos.end - name_pos.start + 1));
+		// remove <@keyword "NAME">, the rest of the line is kept
+		shader.erase(pos, name_pos.end - pos + 2);
+		pos = shader.find("@keyword", pos);
+	}
+	return keywords;
 }
\ No newline at end of file
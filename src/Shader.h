@@ -4,73 +4,310 @@
 #include <sstream>
 #include <fstream>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <cstdint>
+#include <future>
+#include <mutex>
 #include "glm/glm.hpp"
 
 /// <summary>
-/// Class for loading shaders and setting uniforms
+/// Handle of a uniform: FNV-1a hash of the uniform name.
+/// For string literals the hash is computed at compile time, so setting a uniform does not allocate.
+/// </summary>
+struct Uniform {
+	uint32_t hash;
+	// name used for error messages (nullptr if the handle was made from a std::string)
+	const char* name;
+
+	template<size_t N>
+	constexpr Uniform(const char (&literal)[N]) : hash(fnv1a(literal, N - 1)), name(literal) {}
+	Uniform(const std::string& str) : hash(fnv1a(str.c_str(), str.size())), name(nullptr) {}
+
+	// hash of the first length characters (stops at '\0', for char buffers)
+	static constexpr uint32_t fnv1a(const char* str, size_t length) {
+		uint32_t hash = 2166136261u;
+		for (size_t i = 0; i < length && str[i] != '\0'; ++i) {
+			hash = (hash ^ (uint8_t)str[i]) * 16777619u;
+		}
+		return hash;
+	}
+};
+
+/// <summary>
+/// Handle of a shader keyword (hashed like uniforms)
+/// </summary>
+typedef Uniform Keyword;
+
+/// <summary>
+/// Class for loading shaders and setting uniforms.
+/// Shaders can declare keywords with @keyword "NAME". Every combination of enabled keywords is a separate
+/// program (variant) compiled with "#define NAME" the first time it is bound.
+/// Loading is asynchronous: load() expands the templates on worker threads, the programs of all loaded shaders
+/// are submitted to the driver together (on the first bind) and their status is checked only when they are used.
+/// Uniforms set before a program is ready are applied when it finishes linking.
 /// </summary>
 class Shader
 {
 private:
+	// maximum number of keywords of a program (bits of the variant key)
+	static const unsigned int MAX_KEYWORDS = 32;
+
+	// expanded source of a shader file and the keywords it declares
+	struct Source {
+		std::string code;
+		std::vector<std::string> keywords;
+		// files that could not be read (reported by submitPending on the main thread), empty if none
+		std::string error;
+	};
+
+	// one compiled program for a set of enabled keywords
+	struct Variant {
+		unsigned int id = 0;
+		// enabled keywords (bit i = m_keywords[i])
+		uint32_t key = 0;
+
+		// false while the program is compiling/linking
+		bool ready = false;
+		// shaders attached to the program (deleted after linking)
+		unsigned int vertexShaderId = 0;
+		unsigned int fragmentShaderId = 0;
+		unsigned int geometryShaderId = 0; // 0 if there is no geometry stage
+		// shader cache key, the binary is stored after linking
+		uint64_t cacheKey = 0;
+
+		// locations of all active uniforms (reflected after linking), sorted by name hash
+		std::vector<std::pair<uint32_t, int>> uniformLocations;
+
+		// uniforms that were set but are not active in this program (each is reported once)
+		std::unordered_set<uint32_t> missingUniforms;
+
+		// version of the last recorded uniform value uploaded to this program
+		uint32_t uniformVersion = 0;
+	};
+
+	// last value set for a uniform, uploaded again when another variant is bound
+	struct UniformValue {
+		enum class Type { FLOAT, INT, VEC2, VEC3, VEC4, MAT3, MAT4 };
+		Type type;
+		uint32_t version = 0;
+		// number of elements (for arrays)
+		unsigned int count = 1;
+		std::vector<float> floats;
+		std::vector<int> ints;
+	};
+
 	// the id of the currently bound shader
 	static unsigned int s_currentBoundShader;
+
+	// expanded sources (after @extends and @include) of every file loaded so far, expanded on worker threads
+	static std::unordered_map<std::string, std::shared_future<Source>> s_sources;
+	static std::mutex s_sourcesMutex;
+
+	// shaders loaded but not submitted to the driver yet
+	static std::vector<Shader*> s_pending;
+
+	// true if GL_KHR_parallel_shader_compile is used (program status can be checked without waiting)
+	static bool s_parallelCompile;
+
+	// shader whose uniforms are currently set in its fallback program
+	static const Shader* s_fallbackOwner;
+
+	// id of the program of the active variant
 	unsigned int m_id = 0;
 
-	// cache uniforms locations
-	std::unordered_map<std::string, int> m_uniformLocations;
+	// files used for this program (for error messages)
+	std::string m_name;
+	std::string m_vertexPath;
+	std::string m_fragmentPath;
+	std::string m_geometryPath; // empty if there is no geometry stage
+
+	// keywords declared by the vertex and fragment shader, the index is the bit in the variant key
+	std::vector<std::string> m_keywords;
+	std::vector<uint32_t> m_keywordHashes;
+
+	// compiled variants by key (bit i set = keyword i defined)
+	std::unordered_map<uint32_t, Variant> m_variants;
+	Variant* m_variant = nullptr;
+	// key requested by setKeyword(), the variant is switched on the next bind()
+	uint32_t m_requestedKey = 0;
+
+	// uniform values by name hash (only recorded if the shader has keywords)
+	std::unordered_map<uint32_t, UniformValue> m_uniformValues;
+	uint32_t m_uniformVersion = 0;
+
+	// uniform block bindings, applied to every variant
+	std::vector<std::pair<std::string, unsigned int>> m_blockBindings;
+
+	// true while in s_pending
+	bool m_pending = false;
+
+	// program drawn while the active variant is still compiling (nullptr = wait for it)
+	Shader* m_fallback = nullptr;
 
 	/// <summary>
-	/// Load shader from filepath
+	/// Start compiling shader from source (the status is checked in finishVariant)
 	/// </summary>
 	/// <param name="type">Type of shader, GL_VERTEX_SHADER, GL_FRAGMENT_SHADER, GL_GEOMETRY_SHADER</param>
 	/// <returns>id of the shader</returns>
-	unsigned int load(const std::string& path, unsigned int type);
+	unsigned int compile(const std::string& source, unsigned int type);
+
+	/// <summary>
+	/// Print the log if the shader failed to compile
+	/// </summary>
+	void checkCompileStatus(unsigned int id, unsigned int type) const;
+
+	/// <summary>
+	/// Wait for the sources and submit the variant without keywords
+	/// </summary>
+	void submit();
+
+	/// <summary>
+	/// Submit the program of a variant for compiling and linking (or load it from the shader cache)
+	/// </summary>
+	void createVariant(uint32_t key, Variant& variant);
+
+	/// <summary>
+	/// Check the link status of a variant, reflect its uniforms and set the recorded values.
+	/// Returns false if the program is still compiling (only if wait is false and parallel compiling is supported).
+	/// </summary>
+	bool finishVariant(Variant& variant, bool wait);
 
 	/// <summary>
-	/// Get location of an uniform
+	/// Make the variant for m_requestedKey active (created the first time) and upload the uniforms it missed
 	/// </summary>
-	unsigned int getLocation(const std::string& name);
+	void selectVariant();
 
+	/// <summary>
+	/// Get location of an uniform, -1 (and a message the first time) if it is not active
+	/// </summary>
+	int getLocation(Uniform uniform);
+
+	/// <summary>
+	/// Store the locations of all active uniforms (array elements are stored as "name[i]", the first also as "name")
+	/// </summary>
+	void reflectUniforms(Variant& variant);
+
+	/// <summary>
+	/// Remember the value of a uniform so it can be set on the other variants (and on programs that are not ready)
+	/// </summary>
+	void recordUniform(uint32_t hash, UniformValue::Type type, unsigned int count, const float* floats, const int* ints);
+
+	/// <summary>
+	/// Upload the values recorded after version to the program of variant (the program must be bound)
+	/// </summary>
+	void uploadUniforms(const Variant& variant, uint32_t version) const;
+
+	// upload a recorded value to the active program
+	static void uploadUniform(const UniformValue& value, int location);
+
+	// location of a uniform in a variant, -1 if it is not active
+	static int findLocation(const Variant& variant, uint32_t hash);
+
+	// add "#define" for every keyword in the key after the #version line
+	std::string addDefines(const std::string& source, uint32_t key) const;
 
 	struct TemplateInfo {
 		size_t start;
 		size_t end;
 	};
-	// read a file content in a string
-	std::string readFile(const std::string& path);
+	// read a file content in a string (empty if it can't be read, the error is appended to error)
+	static std::string readFile(const std::string& path, std::string& error);
+
+	// start expanding a shader file on a worker thread (only the first time)
+	static std::shared_future<Source> requestSource(const std::string& path);
+
+	// get the expanded source of a shader file (waits for the worker)
+	static const Source& getSource(const std::string& path);
+
+	// expand a shader file: @extends, @include and @keyword (runs on a worker thread)
+	static Source expandSource(const std::string& path);
 
 	// process the "@extends", load main template and replace sections
-	std::string processExtends(std::string shader);
+	static std::string processExtends(std::string shader, std::string& error);
 
 	// replace the "@include" with the mentioned file
-	std::string processInclude(std::string shader);
+	static std::string processInclude(std::string shader, std::string& error);
+
+	// remove the "@keyword" lines and return the names
+	static std::vector<std::string> processKeywords(std::string& shader);
 
 	// get the start / end of the first "name" strings starting from offset
-	TemplateInfo extractName(const std::string& str, size_t offset);
+	static TemplateInfo extractName(const std::string& str, size_t offset);
 public:
 	Shader(const std::string& vertexPath,
 		const std::string& fragmentPath,
 		const std::string& geometryPath = "");
 	Shader() = default;
 	~Shader();
+	// not movable, pending shaders are referenced by address
+	Shader(const Shader& o) = delete;
+	Shader& operator=(const Shader& o) = delete;
 
 	/// <summary>
-	/// Load shader program from file.
+	/// Load shader program from file. The sources are expanded on a worker thread and the program is
+	/// submitted with all other loaded shaders on the first bind (or submitPending()).
+	/// Only the variant without keywords is compiled, the others are compiled when they are first used.
 	/// </summary>
 	/// <param name="vertexPath">: path to vertex shader</param>
 	/// <param name="fragmentPath">: path to fragment shader</param>
+	/// <param name="geometryPath">: path to geometry shader (optional)</param>
 	void load(const std::string& vertexPath,
 		const std::string& fragmentPath,
 		const std::string& geometryPath = "");
-	void bind() const;
+
+	/// <summary>
+	/// Submit the programs of all loaded shaders to the driver (does not wait for them)
+	/// </summary>
+	static void submitPending();
+
+	/// <summary>
+	/// Bind the program, switching to the variant of the enabled keywords if they changed.
+	/// If the program is still compiling the fallback shader is bound instead (or it waits if there is none).
+	/// </summary>
+	void bind();
+
+	/// <summary>
+	/// Set the shader drawn while this one is compiling. It must use the same vertex inputs and uniforms are
+	/// matched by name. The fallback itself is always waited for.
+	/// </summary>
+	void setFallback(Shader* fallback) { m_fallback = fallback; }
+
+	/// <summary>
+	/// True if the active variant finished linking (does not wait)
+	/// </summary>
+	bool isReady();
 	void unbind() const;
 
-	void setFloat(const std::string& name, float val);
-	void setInt(const std::string& name, int val);
-	void setBool(const std::string& name, bool val);
-	void setVec4(const std::string& name, const glm::vec4& val);
-	void setVec3(const std::string& name, const glm::vec3& val);
-	void setMat4(const std::string& name, const glm::mat4& val);
-	void setMat3(const std::string& name, const glm::mat3& val);
-	void setIntArray(const std::string& name, unsigned int count, int* data);
+	/// <summary>
+	/// Enable/disable a keyword. Takes effect on the next bind() (every setter binds the shader).
+	/// Keywords not declared by the shader are ignored.
+	/// </summary>
+	void setKeyword(Keyword keyword, bool enabled);
+
+	/// <summary>
+	/// Disable all keywords
+	/// </summary>
+	void clearKeywords() { m_requestedKey = 0; }
+
+	/// <summary>
+	/// Number of variants compiled so far
+	/// </summary>
+	size_t getVariantCount() const { return m_variants.size(); }
+
+	void setFloat(Uniform name, float val);
+	void setInt(Uniform name, int val);
+	void setBool(Uniform name, bool val);
+	void setVec4(Uniform name, const glm::vec4& val);
+	void setVec3(Uniform name, const glm::vec3& val);
+	void setVec2(Uniform name, const glm::vec2& val);
+	void setMat4(Uniform name, const glm::mat4& val);
+	void setMat3(Uniform name, const glm::mat3& val);
+	void setIntArray(Uniform name, unsigned int count, int* data);
+	void setVec4Array(Uniform name, unsigned int count, const glm::vec4* data);
+
+	/// <summary>
+	/// Bind a uniform block to a binding point (does nothing if the block is not used by the shader)
+	/// </summary>
+	void setUniformBlockBinding(const std::string& name, unsigned int binding);
 };
\ No newline at end of file
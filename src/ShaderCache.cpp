@@ -0,0 +1,134 @@
+#include "ShaderCache.h"
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <cstdio>
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+namespace {
+	// header stored before the binary
+	struct BinaryHeader {
+		uint32_t magic = 0x43534c44; // "DLSC"
+		uint32_t version = 1;
+		uint64_t key = 0;
+		uint32_t format = 0;
+		uint32_t length = 0;
+	};
+
+	// 64 bit FNV-1a
+	uint64_t hash64(const std::string& str, uint64_t hash = 14695981039346656037ull) {
+		for (char c : str) {
+			hash = (hash ^ (uint8_t)c) * 1099511628211ull;
+		}
+		return hash;
+	}
+}
+
+ShaderCache& ShaderCache::get()
+{
+	static ShaderCache instance;
+	return instance;
+}
+
+bool ShaderCache::isSupported()
+{
+	if (m_supported == -1) {
+		int formats = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+		m_supported = formats > 0 ? 1 : 0;
+
+		std::stringstream ss;
+		ss << glGetString(GL_VENDOR) << "|" << glGetString(GL_RENDERER) << "|" << glGetString(GL_VERSION);
+		m_driver = ss.str();
+
+		if (m_supported) {
+#ifdef _WIN32
+			_mkdir(m_directory.c_str());
+#else
+			mkdir(m_directory.c_str(), 0755);
+#endif
+		}
+	}
+	return m_supported == 1;
+}
+
+std::string ShaderCache::getPath(uint64_t key) const
+{
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+	return m_directory + "/" + name;
+}
+
+uint64_t ShaderCache::getKey(const std::string& sources)
+{
+	isSupported(); // reads the driver string
+	return hash64(m_driver, hash64(sources));
+}
+
+bool ShaderCache::loadProgram(unsigned int program, uint64_t key)
+{
+	if (!isSupported()) {
+		return false;
+	}
+	std::ifstream file(getPath(key), std::ios::binary);
+	BinaryHeader header, expected;
+	if (!file || !file.read((char*)&header, sizeof(header)) ||
+		header.magic != expected.magic || header.version != expected.version || header.key != key) {
+		m_misses++;
+		return false;
+	}
+	std::vector<char> binary(header.length);
+	if (!file.read(binary.data(), header.length)) {
+		m_misses++;
+		return false;
+	}
+
+	// the driver can reject the binary (e.g. after a driver update)
+	glProgramBinary(program, header.format, binary.data(), header.length);
+	int ok = 0;
+	glGetProgramiv(program, GL_LINK_STATUS, &ok);
+	if (!ok) {
+		m_misses++;
+		return false;
+	}
+	m_hits++;
+	return true;
+}
+
+void ShaderCache::prepareProgram(unsigned int program)
+{
+	if (isSupported()) {
+		glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+}
+
+void ShaderCache::storeProgram(unsigned int program, uint64_t key)
+{
+	if (!isSupported()) {
+		return;
+	}
+	int length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0) {
+		return;
+	}
+	std::vector<char> binary(length);
+	BinaryHeader header;
+	header.key = key;
+	GLenum format = 0;
+	glGetProgramBinary(program, length, &length, &format, binary.data());
+	header.format = format;
+	header.length = length;
+
+	std::ofstream file(getPath(key), std::ios::binary);
+	if (!file) {
+		printf("Warning: could not write shader cache file '%s'\n", getPath(key).c_str());
+		return;
+	}
+	file.write((const char*)&header, sizeof(header));
+	file.write(binary.data(), length);
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include "GL/glew.h"
+#include <string>
+#include <cstdint>
+
+/// <summary>
+/// Singleton class that stores linked shader programs on disk (glGetProgramBinary) and loads them
+/// back with glProgramBinary, so programs don't have to be compiled again when a scene is loaded.
+/// Programs are identified by a hash of the fully expanded sources and the driver (vendor, renderer, version).
+/// </summary>
+class ShaderCache
+{
+private:
+	// make constructors private
+	ShaderCache() = default;
+	ShaderCache(const ShaderCache& o) = delete;
+	ShaderCache& operator=(const ShaderCache& o) = delete;
+
+	// directory where binaries are stored
+	const std::string m_directory = "shader_cache";
+
+	// vendor, renderer and version of the driver (binaries are only valid for the same driver)
+	std::string m_driver;
+
+	// -1 = not checked yet, 0 = program binaries not supported, 1 = supported
+	int m_supported = -1;
+
+	unsigned int m_hits = 0;
+	unsigned int m_misses = 0;
+
+	bool isSupported();
+
+	// path of the binary for a key
+	std::string getPath(uint64_t key) const;
+public:
+	static ShaderCache& get();
+
+	/// <summary>
+	/// Get the cache key for the expanded sources of a program (includes the driver)
+	/// </summary>
+	uint64_t getKey(const std::string& sources);
+
+	/// <summary>
+	/// Load the program binary for this key into program. Returns false if the binary is missing or was rejected by the driver.
+	/// </summary>
+	bool loadProgram(unsigned int program, uint64_t key);
+
+	/// <summary>
+	/// Call before linking so the driver keeps the program binary
+	/// </summary>
+	void prepareProgram(unsigned int program);
+
+	/// <summary>
+	/// Store the binary of a linked program
+	/// </summary>
+	void storeProgram(unsigned int program, uint64_t key);
+
+	unsigned int getHits() const { return m_hits; }
+	unsigned int getMisses() const { return m_misses; }
+
+	/// <summary>
+	/// Reset hit/miss counters (e.g. before loading a scene)
+	/// </summary>
+	void resetStats() { m_hits = m_misses = 0; }
+};
@@ -1,6 +1,17 @@
 #include "App.h"
 
-int main() {
+int main(int argc, char** argv) {
+	Benchmark::Options options;
+	if (!Benchmark::parseArgs(argc, argv, options)) {
+		return 1;
+	}
+
+	// run a fixed number of frames and save the timings
+	if (options.enabled) {
+		App app(options.width, options.height, options.headless, options.context);
+		return app.runBenchmark(options);
+	}
+
 	App app;
 	app.run();
-}
\ No newline at end of file
+}